@@ -0,0 +1,770 @@
+/* SPDX-License-Identifier: GPL-2.0 or MIT                               */
+/* Copyright(c) 2026 Ross K.Snider. All rights reserved.                 */
+/*-------------------------------------------------------------------------
+ * Description:  Linux Platform Device Driver for the
+ *               combFilterProcessor component
+ * ------------------------------------------------------------------------
+ * Authors : Ross K. Snider and Trevor Vannoy
+ * Company : Montana State University
+ * Create Date : October 17, 2026
+ * Revision : 1.0
+ * License : GPL-2.0 or MIT (opensource.org / licenses / MIT, GPL-2.0)
+-------------------------------------------------------------------------*/
+#include <linux/module.h>
+#include <linux/platform_device.h>
+#include <linux/mod_devicetable.h>
+#include <linux/types.h>
+#include <linux/io.h>
+#include <linux/mutex.h>
+#include <linux/miscdevice.h>
+#include <linux/fs.h>
+#include <linux/kernel.h>
+#include <linux/uaccess.h>
+#include <linux/compat.h>
+#include <linux/iopoll.h>
+#include "fixed_point.h"
+#include "combFilterProcessor.h"
+
+/*-----------------------------------------------------------------------*/
+/* DEFINE STATEMENTS                                                     */
+/*-----------------------------------------------------------------------*/
+/* Memory span of all registers (used or not) in the                     */
+/* component combFilterProcessor                                         */
+#define SPAN 0x20
+
+/* Number of 32-bit registers in SPAN                                    */
+#define NUM_REGS (SPAN / sizeof(u32))
+
+/* Fractional digits shown for the gains and the mix; enough to parse    */
+/* back the same register value                                          */
+#define COMB_FILTER_DIGITS FP_ROUNDTRIP_DIGITS(16)
+
+/* How long staging waits for an earlier commit to take effect. A commit */
+/* waits for at most one frame (21 us at 48 kHz); when it takes longer,  */
+/* no audio is streaming and staging fails rather than race the commit.  */
+#define COMB_FILTER_COMMIT_TIMEOUT_US 2000
+
+
+/*-----------------------------------------------------------------------*/
+/* combFilterProcessor device structure                                  */
+/*-----------------------------------------------------------------------*/
+/*
+ * struct comb_filter_dev - Private combFilterProcessor device struct.
+ * @miscdev: miscdevice used to create a char device
+ *           for the combFilterProcessor component
+ * @base_addr: Base address of the combFilterProcessor component
+ * @lock: mutex used to prevent concurrent writes
+ *        to the combFilterProcessor component
+ *
+ * A comb_filter_dev struct gets created for each combFilterProcessor
+ * component in the system.
+ */
+struct comb_filter_dev {
+	struct miscdevice miscdev;
+	void __iomem *base_addr;
+	struct mutex lock;
+};
+
+/*-----------------------------------------------------------------------*/
+/* Staging and committing parameters                                     */
+/*-----------------------------------------------------------------------*/
+/*
+ * comb_filter_wait_committed() - Wait for a pending commit to take effect.
+ * @priv: The combFilterProcessor device; its lock must be held.
+ *
+ * The staged registers must not be written while a commit is pending, or
+ * the commit could pick up a half-written set. The commit happens at the
+ * next left-channel sample. If none arrives in time, the commit stays
+ * latched and would take whatever is staged once the audio starts, so
+ * nothing may be staged until then.
+ *
+ * Return: 0 once no commit is pending, or -ETIMEDOUT.
+ */
+static int comb_filter_wait_committed(struct comb_filter_dev *priv)
+{
+	u32 control;
+	int ret;
+
+	ret = readx_poll_timeout(ioread32, priv->base_addr + REG4_CONTROL_OFFSET,
+	                         control, !(control & COMB_FILTER_CONTROL_COMMIT),
+	                         20, COMB_FILTER_COMMIT_TIMEOUT_US);
+	if (ret) {
+		dev_dbg(priv->miscdev.parent, "commit pending without audio samples\n");
+	}
+
+	return ret;
+}
+/*
+ * comb_filter_commit() - Commit the staged parameters.
+ * @priv: The combFilterProcessor device; its lock must be held.
+ *
+ * All four staged parameters take effect together at the next
+ * left-channel sample.
+ */
+static void comb_filter_commit(struct comb_filter_dev *priv)
+{
+	iowrite32(COMB_FILTER_CONTROL_COMMIT, priv->base_addr + REG4_CONTROL_OFFSET);
+}
+
+/*-----------------------------------------------------------------------*/
+/* Fixed-point register show() and store() helpers                       */
+/*-----------------------------------------------------------------------*/
+/*
+ * comb_filter_param_show() - Return a register as a decimal number.
+ * @dev: Device structure for the combFilterProcessor component.
+ * @buf: Buffer that gets returned to user-space.
+ * @offset: Byte offset of the register.
+ * @format: name_format() function of the register's fixed-point format.
+ * @digits: Number of fractional digits to print.
+ *
+ * Return: The number of bytes read, or a negative error value.
+ */
+static ssize_t comb_filter_param_show(struct device *dev, char *buf,
+	unsigned int offset,
+	int (*format)(char *, size_t, uint32_t, unsigned int),
+	unsigned int digits)
+{
+	u32 val;
+	int len;
+	struct comb_filter_dev *priv = dev_get_drvdata(dev);
+
+	val = ioread32(priv->base_addr + offset);
+
+	len = format(buf, PAGE_SIZE - 1, val, digits);
+	if (len < 0) {
+		return len;
+	}
+	buf[len++] = '\n';
+
+	return len;
+}
+/*
+ * comb_filter_param_store() - Store a decimal number in a register.
+ * @dev: Device structure for the combFilterProcessor component.
+ * @buf: Buffer that contains the number being written.
+ * @size: The number of bytes being written.
+ * @offset: Byte offset of the register.
+ * @parse: name_parse() function of the register's fixed-point format.
+ *
+ * The number is rounded to the nearest value of the register's format;
+ * numbers outside the format's range are rejected. The value is staged
+ * and committed, so it takes effect at the next left-channel sample
+ * together with whatever else was staged.
+ *
+ * Return: The number of bytes stored, or a negative error value.
+ */
+static ssize_t comb_filter_param_store(struct device *dev,
+	const char *buf, size_t size, unsigned int offset,
+	int (*parse)(const char *, size_t, uint32_t *))
+{
+	u32 val;
+	int ret;
+	struct comb_filter_dev *priv = dev_get_drvdata(dev);
+
+	ret = parse(buf, size, &val);
+	if (ret < 0) {
+		return ret;
+	}
+
+	mutex_lock(&priv->lock);
+	ret = comb_filter_wait_committed(priv);
+	if (!ret) {
+		iowrite32(val, priv->base_addr + offset);
+		comb_filter_commit(priv);
+	}
+	mutex_unlock(&priv->lock);
+
+	if (ret) {
+		return ret;
+	}
+
+	// Write was succesful, so we return the number of bytes we wrote.
+	return size;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/* REG0: delayM register show() and store()                              */
+/*-----------------------------------------------------------------------*/
+/*
+ * delay_m_show() - Return the delay in samples to user-space via sysfs.
+ * @dev: Device structure for the combFilterProcessor component.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t delay_m_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	return comb_filter_param_show(dev, buf, REG0_DELAY_M_OFFSET,
+	                              fixed_comb_delay_format, 0);
+}
+/*
+ * delay_m_store() - Store the delay in samples (0..65535).
+ * @dev: Device structure for the combFilterProcessor component.
+ * @attr: Unused.
+ * @buf: Buffer that contains the delay being written.
+ * @size: The number of bytes being written.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t delay_m_store(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t size)
+{
+	return comb_filter_param_store(dev, buf, size, REG0_DELAY_M_OFFSET,
+	                               fixed_comb_delay_parse);
+}
+
+/*-----------------------------------------------------------------------*/
+/* REG1: b0 register show() and store()                                  */
+/*-----------------------------------------------------------------------*/
+/*
+ * b0_show() - Return the direct path gain b0 to user-space via sysfs.
+ * @dev: Device structure for the combFilterProcessor component.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t b0_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	return comb_filter_param_show(dev, buf, REG1_B0_OFFSET,
+	                              fixed_comb_gain_format, COMB_FILTER_DIGITS);
+}
+/*
+ * b0_store() - Store the direct path gain b0 (-0.5 up to 0.5).
+ * @dev: Device structure for the combFilterProcessor component.
+ * @attr: Unused.
+ * @buf: Buffer that contains the gain being written.
+ * @size: The number of bytes being written.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t b0_store(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t size)
+{
+	return comb_filter_param_store(dev, buf, size, REG1_B0_OFFSET,
+	                               fixed_comb_gain_parse);
+}
+
+/*-----------------------------------------------------------------------*/
+/* REG2: bM register show() and store()                                  */
+/*-----------------------------------------------------------------------*/
+/*
+ * bm_show() - Return the delayed path gain bM to user-space via sysfs.
+ * @dev: Device structure for the combFilterProcessor component.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t bm_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	return comb_filter_param_show(dev, buf, REG2_BM_OFFSET,
+	                              fixed_comb_gain_format, COMB_FILTER_DIGITS);
+}
+/*
+ * bm_store() - Store the delayed path gain bM (-0.5 up to 0.5).
+ * @dev: Device structure for the combFilterProcessor component.
+ * @attr: Unused.
+ * @buf: Buffer that contains the gain being written.
+ * @size: The number of bytes being written.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t bm_store(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t size)
+{
+	return comb_filter_param_store(dev, buf, size, REG2_BM_OFFSET,
+	                               fixed_comb_gain_parse);
+}
+
+/*-----------------------------------------------------------------------*/
+/* REG3: wetDryMix register show() and store()                           */
+/*-----------------------------------------------------------------------*/
+/*
+ * wet_dry_mix_show() - Return the wet/dry mix to user-space via sysfs.
+ * @dev: Device structure for the combFilterProcessor component.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t wet_dry_mix_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	return comb_filter_param_show(dev, buf, REG3_WET_DRY_MIX_OFFSET,
+	                              fixed_comb_mix_format, COMB_FILTER_DIGITS);
+}
+/*
+ * wet_dry_mix_store() - Store the wet/dry mix (0 is dry, up to 1 is wet).
+ * @dev: Device structure for the combFilterProcessor component.
+ * @attr: Unused.
+ * @buf: Buffer that contains the mix being written.
+ * @size: The number of bytes being written.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t wet_dry_mix_store(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t size)
+{
+	return comb_filter_param_store(dev, buf, size, REG3_WET_DRY_MIX_OFFSET,
+	                               fixed_comb_mix_parse);
+}
+
+
+/*-----------------------------------------------------------------------*/
+/* sysfs Attributes                                                      */
+/*-----------------------------------------------------------------------*/
+// Define sysfs attributes
+static DEVICE_ATTR_RW(delay_m);        // Attribute for REG0
+static DEVICE_ATTR_RW(b0);             // Attribute for REG1
+static DEVICE_ATTR_RW(bm);             // Attribute for REG2
+static DEVICE_ATTR_RW(wet_dry_mix);    // Attribute for REG3
+
+// Create an atribute group so the device core can
+// export the attributes for us.
+static struct attribute *comb_filter_attrs[] = {
+	&dev_attr_delay_m.attr,
+	&dev_attr_b0.attr,
+	&dev_attr_bm.attr,
+	&dev_attr_wet_dry_mix.attr,
+	NULL,
+};
+ATTRIBUTE_GROUPS(comb_filter);
+
+
+/*-----------------------------------------------------------------------*/
+/* File Operations read()                                                */
+/*-----------------------------------------------------------------------*/
+/*
+ * comb_filter_read() - Read method for the combFilterProcessor char device
+ * @file: Pointer to the char device file struct.
+ * @buf: User-space buffer to read the values into.
+ * @count: The number of bytes being requested.
+ * @offset: The byte offset in the file being read from.
+ *
+ * The file is the raw register file: the file offset is the register
+ * offset and every register is a 32-bit word. Any number of whole
+ * registers can be read at once, so all parameters can be read with a
+ * single pread(fd, regs, SPAN, 0).
+ *
+ * Return: On success, the number of bytes read is returned and the
+ * offset @offset is advanced by this number. On error, a negative error
+ * value is returned.
+ */
+static ssize_t comb_filter_read(struct file *file, char __user *buf,
+	size_t count, loff_t *offset)
+{
+	u32 vals[NUM_REGS];
+	unsigned int i;
+	unsigned int n;
+
+	loff_t pos = *offset;
+
+	/*
+	 * Get the device's private data from the file struct's private_data
+	 * field. The private_data field is equal to the miscdev field in the
+	 * comb_filter_dev struct. container_of returns the
+	 * comb_filter_dev struct that contains the miscdev in private_data.
+	 */
+	struct comb_filter_dev *priv = container_of(file->private_data,
+	                            struct comb_filter_dev, miscdev);
+
+	// Check file offset to make sure we are reading to a valid location.
+	if (pos < 0) {
+		// We can't read from a negative file position.
+		return -EINVAL;
+	}
+	if (pos >= SPAN) {
+		// We can't read from a position past the end of our device.
+		return 0;
+	}
+	if ((pos % 0x4) != 0 || (count % 0x4) != 0) {
+		// Our registers are 32-bit-aligned; only whole ones can be read.
+		pr_warn("comb_filter_read: unaligned access\n");
+		return -EINVAL;
+	}
+
+	n = min_t(size_t, count, SPAN - pos) / sizeof(u32);
+
+	// If the user didn't request any bytes, don't return any bytes :)
+	if (n == 0) {
+		return 0;
+	}
+
+	// Read all registers while writers are kept out, so the values
+	// belong to the same parameter set.
+	mutex_lock(&priv->lock);
+	for (i = 0; i < n; i++) {
+		vals[i] = ioread32(priv->base_addr + pos + i * sizeof(u32));
+	}
+	mutex_unlock(&priv->lock);
+
+	if (copy_to_user(buf, vals, n * sizeof(u32))) {
+		pr_warn("comb_filter_read: nothing copied\n");
+		return -EFAULT;
+	}
+
+	// Increment the file offset by the number of bytes we read.
+	*offset = pos + n * sizeof(u32);
+
+	return n * sizeof(u32);
+}
+/*-----------------------------------------------------------------------*/
+/* File Operations write()                                               */
+/*-----------------------------------------------------------------------*/
+/*
+ * comb_filter_write() - Write method for the combFilterProcessor char device
+ * @file: Pointer to the char device file struct.
+ * @buf: User-space buffer to read the values from.
+ * @count: The number of bytes being written.
+ * @offset: The byte offset in the file being written to.
+ *
+ * Any number of whole registers can be written at once; all of them are
+ * written under a single acquisition of the device lock, after an
+ * earlier commit took effect; if it doesn't take effect in time, the
+ * write fails with -ETIMEDOUT. Writes past the last register are cut
+ * short. Parameters written here are only staged; writing
+ * COMB_FILTER_CONTROL_COMMIT to the control register commits them.
+ *
+ * Return: On success, the number of bytes written is returned and the
+ * offset @offset is advanced by this number. On error, a negative error
+ * value is returned.
+ */
+static ssize_t comb_filter_write(struct file *file, const char __user *buf,
+	size_t count, loff_t *offset)
+{
+	u32 vals[NUM_REGS];
+	unsigned int i;
+	unsigned int n;
+	int ret;
+
+	loff_t pos = *offset;
+
+	struct comb_filter_dev *priv = container_of(file->private_data,
+	                              struct comb_filter_dev, miscdev);
+
+	// Check file offset to make sure we are writing to a valid location.
+	if (pos < 0) {
+		// We can't write to a negative file position.
+		return -EINVAL;
+	}
+	if (pos >= SPAN) {
+		// We can't write to a position past the end of our device.
+		return 0;
+	}
+	if ((pos % 0x4) != 0 || (count % 0x4) != 0) {
+		// Our registers are 32-bit-aligned; only whole ones can be written.
+		pr_warn("comb_filter_write: unaligned access\n");
+		return -EINVAL;
+	}
+
+	n = min_t(size_t, count, SPAN - pos) / sizeof(u32);
+
+	// If the user didn't request to write anything, return 0.
+	if (n == 0) {
+		return 0;
+	}
+
+	// Copy everything before taking the lock, so a page fault can't
+	// stall the other writers.
+	if (copy_from_user(vals, buf, n * sizeof(u32))) {
+		pr_warn("comb_filter_write: nothing copied from user space\n");
+		return -EFAULT;
+	}
+
+	mutex_lock(&priv->lock);
+	ret = comb_filter_wait_committed(priv);
+	if (!ret) {
+		for (i = 0; i < n; i++) {
+			iowrite32(vals[i], priv->base_addr + pos + i * sizeof(u32));
+		}
+	}
+	mutex_unlock(&priv->lock);
+
+	if (ret) {
+		return ret;
+	}
+
+	// Increment the file offset by the number of bytes we wrote.
+	*offset = pos + n * sizeof(u32);
+
+	// Return the number of bytes we wrote.
+	return n * sizeof(u32);
+}
+
+
+/*-----------------------------------------------------------------------*/
+/* ioctl: Stage/commit/get all filter parameters                         */
+/*-----------------------------------------------------------------------*/
+/*
+ * comb_filter_stage_params() - Stage all four filter parameters.
+ * @priv: The combFilterProcessor device.
+ * @arg: User-space pointer to a struct comb_filter_params.
+ * @commit: Commit the parameters once they are staged.
+ *
+ * Every value is checked against its register's format first, so either
+ * all registers are staged or none is. Nothing is staged if an earlier
+ * commit is still pending.
+ *
+ * Return: 0 on success, or a negative error value.
+ */
+static long comb_filter_stage_params(struct comb_filter_dev *priv,
+	void __user *arg, bool commit)
+{
+	struct comb_filter_params params;
+	int ret;
+
+	if (copy_from_user(&params, arg, sizeof(params))) {
+		return -EFAULT;
+	}
+
+	if (params.delay_m > FIXED_POINT_MAX_OF(fixed_comb_delay) ||
+	    params.b0 < FIXED_POINT_MIN_OF(fixed_comb_gain) ||
+	    params.b0 > FIXED_POINT_MAX_OF(fixed_comb_gain) ||
+	    params.bm < FIXED_POINT_MIN_OF(fixed_comb_gain) ||
+	    params.bm > FIXED_POINT_MAX_OF(fixed_comb_gain) ||
+	    params.wet_dry_mix > FIXED_POINT_MAX_OF(fixed_comb_mix)) {
+		return -EINVAL;
+	}
+
+	mutex_lock(&priv->lock);
+	ret = comb_filter_wait_committed(priv);
+	if (!ret) {
+		iowrite32(params.delay_m, priv->base_addr + REG0_DELAY_M_OFFSET);
+		iowrite32(params.b0, priv->base_addr + REG1_B0_OFFSET);
+		iowrite32(params.bm, priv->base_addr + REG2_BM_OFFSET);
+		iowrite32(params.wet_dry_mix, priv->base_addr + REG3_WET_DRY_MIX_OFFSET);
+		if (commit) {
+			comb_filter_commit(priv);
+		}
+	}
+	mutex_unlock(&priv->lock);
+
+	return ret;
+}
+/*
+ * comb_filter_get_params() - Read all four filter parameters.
+ * @priv: The combFilterProcessor device.
+ * @arg: User-space pointer to a struct comb_filter_params.
+ *
+ * Returns the staged values, which are the active ones unless parameters
+ * were staged without a commit. The registers sign-extend b0 and bM on
+ * reads, so the raw register values can be returned as they are.
+ *
+ * Return: 0 on success, or a negative error value.
+ */
+static long comb_filter_get_params(struct comb_filter_dev *priv,
+	void __user *arg)
+{
+	struct comb_filter_params params;
+
+	mutex_lock(&priv->lock);
+	params.delay_m = ioread32(priv->base_addr + REG0_DELAY_M_OFFSET);
+	params.b0 = ioread32(priv->base_addr + REG1_B0_OFFSET);
+	params.bm = ioread32(priv->base_addr + REG2_BM_OFFSET);
+	params.wet_dry_mix = ioread32(priv->base_addr + REG3_WET_DRY_MIX_OFFSET);
+	mutex_unlock(&priv->lock);
+
+	if (copy_to_user(arg, &params, sizeof(params))) {
+		return -EFAULT;
+	}
+
+	return 0;
+}
+
+/*-----------------------------------------------------------------------*/
+/* File Operations ioctl()                                               */
+/*-----------------------------------------------------------------------*/
+/*
+ * comb_filter_ioctl() - ioctl method for the combFilterProcessor char device
+ * @file: Pointer to the char device file struct.
+ * @cmd: The ioctl command (see combFilterProcessor.h).
+ * @arg: The ioctl argument; a user-space pointer for all our commands.
+ *
+ * Return: 0 on success, or a negative error value.
+ */
+static long comb_filter_ioctl(struct file *file, unsigned int cmd,
+	unsigned long arg)
+{
+	struct comb_filter_dev *priv = container_of(file->private_data,
+	                              struct comb_filter_dev, miscdev);
+
+	switch (cmd) {
+	case COMB_FILTER_IOC_SET_PARAMS:
+		return comb_filter_stage_params(priv, (void __user *)arg, true);
+	case COMB_FILTER_IOC_GET_PARAMS:
+		return comb_filter_get_params(priv, (void __user *)arg);
+	case COMB_FILTER_IOC_STAGE_PARAMS:
+		return comb_filter_stage_params(priv, (void __user *)arg, false);
+	case COMB_FILTER_IOC_COMMIT:
+		mutex_lock(&priv->lock);
+		comb_filter_commit(priv);
+		mutex_unlock(&priv->lock);
+		return 0;
+	default:
+		return -ENOTTY;
+	}
+}
+
+
+/*-----------------------------------------------------------------------*/
+/* File Operations Supported                                             */
+/*-----------------------------------------------------------------------*/
+/*
+ *  comb_filter_fops - File operations supported by the
+ *                     combFilterProcessor driver
+ * @owner: The combFilterProcessor driver owns the file operations; this
+ *         ensures that the driver can't be removed while the
+ *         character device is still in use.
+ * @read: The read function.
+ * @write: The write function.
+ * @llseek: We use the kernel's default_llseek() function; this allows
+ *          users to change what position they are writing/reading to/from.
+ * @unlocked_ioctl: The ioctl function; see combFilterProcessor.h.
+ * @compat_ioctl: Our ioctl arguments are pointers to fixed-size structs,
+ *                so 32-bit callers only need their pointer converted.
+ */
+static const struct file_operations comb_filter_fops = {
+	.owner = THIS_MODULE,
+	.read = comb_filter_read,
+	.write = comb_filter_write,
+	.llseek = default_llseek,
+	.unlocked_ioctl = comb_filter_ioctl,
+	.compat_ioctl = compat_ptr_ioctl,
+};
+
+
+/*-----------------------------------------------------------------------*/
+/* Platform Driver Probe (Initialization) Function                       */
+/*-----------------------------------------------------------------------*/
+/*
+ * comb_filter_probe() - Initialize device when a match is found
+ * @pdev: Platform device structure associated with our
+ *        combFilterProcessor device; pdev is automatically created by
+ *        the driver core based upon our combFilterProcessor device tree
+ *        node.
+ *
+ * When a device that is compatible with this combFilterProcessor driver
+ * is found, the driver's probe function is called.
+ */
+static int comb_filter_probe(struct platform_device *pdev)
+{
+	struct comb_filter_dev *priv;
+	int ret;
+
+	priv = devm_kzalloc(&pdev->dev, sizeof(struct comb_filter_dev), GFP_KERNEL);
+	if (!priv) {
+		pr_err("Failed to allocate kernel memory for combFilterProcessor\n");
+		return -ENOMEM;
+	}
+
+	priv->base_addr = devm_platform_ioremap_resource(pdev, 0);
+	if (IS_ERR(priv->base_addr)) {
+		pr_err("Failed to request/remap platform device resource (combFilterProcessor)\n");
+		return PTR_ERR(priv->base_addr);
+	}
+
+	mutex_init(&priv->lock);
+
+	// Initialize the misc device parameters
+	priv->miscdev.minor = MISC_DYNAMIC_MINOR;
+	priv->miscdev.name = "combFilterProcessor";
+	priv->miscdev.fops = &comb_filter_fops;
+	priv->miscdev.parent = &pdev->dev;
+
+	// Attach the combFilterProcessor's private data to the
+	// platform device's struct; the sysfs attributes look it up there.
+	platform_set_drvdata(pdev, priv);
+
+	// Register the misc device; this creates a char dev at
+	// /dev/combFilterProcessor
+	ret = misc_register(&priv->miscdev);
+	if (ret) {
+		pr_err("Failed to register misc device for combFilterProcessor\n");
+		return ret;
+	}
+
+	pr_info("comb_filter_probe successful\n");
+
+	return 0;
+}
+
+/*-----------------------------------------------------------------------*/
+/* Platform Driver Remove Function                                       */
+/*-----------------------------------------------------------------------*/
+/*
+ * comb_filter_remove() - Remove a combFilterProcessor device.
+ * @pdev: Platform device structure associated with our
+ *        combFilterProcessor device.
+ *
+ * This function is called when a combFilterProcessor device is removed
+ * or the driver is removed.
+ */
+static int comb_filter_remove(struct platform_device *pdev)
+{
+	struct comb_filter_dev *priv = platform_get_drvdata(pdev);
+
+	// Deregister the misc device and remove the /dev/combFilterProcessor file.
+	misc_deregister(&priv->miscdev);
+
+	pr_info("comb_filter_remove successful\n");
+
+	return 0;
+}
+
+/*-----------------------------------------------------------------------*/
+/* Compatible Match String                                               */
+/*-----------------------------------------------------------------------*/
+/*
+ * For a device to be matched with this driver, its device tree node must
+ * use the same compatible string as defined here.
+ */
+static const struct of_device_id comb_filter_of_match[] = {
+	// ****Note:**** This .compatible string must be identical to the
+	// .compatible string in the Device Tree Node for combFilterProcessor
+	{ .compatible = "adsd,combFilterProcessor", },
+	{ }
+};
+MODULE_DEVICE_TABLE(of, comb_filter_of_match);
+
+/*-----------------------------------------------------------------------*/
+/* Platform Driver Structure                                             */
+/*-----------------------------------------------------------------------*/
+/*
+ * struct comb_filter_driver - Platform driver struct for the
+ *                             combFilterProcessor driver
+ * @probe: Function that's called when a device is found
+ * @remove: Function that's called when a device is removed
+ * @driver.owner: Which module owns this driver
+ * @driver.name: Name of the combFilterProcessor driver
+ * @driver.of_match_table: Device tree match table
+ * @driver.dev_groups: combFilterProcessor sysfs attribute group; this
+ *                     allows the driver core to create the
+ *                     attribute(s) without race conditions.
+ */
+static struct platform_driver comb_filter_driver = {
+	.probe = comb_filter_probe,
+	.remove = comb_filter_remove,
+	.driver = {
+		.owner = THIS_MODULE,
+		.name = "combFilterProcessor",
+		.of_match_table = comb_filter_of_match,
+		.dev_groups = comb_filter_groups,
+	},
+};
+
+/*
+ * We don't need to do anything special in module init/exit.
+ * This macro automatically handles module init/exit.
+ */
+module_platform_driver(comb_filter_driver);
+
+MODULE_LICENSE("Dual MIT/GPL");
+MODULE_AUTHOR("Ross Snider");
+MODULE_DESCRIPTION("combFilterProcessor driver");
+MODULE_VERSION("1.0");
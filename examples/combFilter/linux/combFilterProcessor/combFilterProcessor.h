@@ -0,0 +1,91 @@
+/* SPDX-License-Identifier: GPL-2.0 or MIT                               */
+/* Copyright(c) 2026 Ross K.Snider. All rights reserved.                 */
+/*-------------------------------------------------------------------------
+ * Description:  User-space interface of the combFilterProcessor
+ *               Linux Platform Device Driver (register offsets and
+ *               ioctl definitions). Included by both the driver and
+ *               user-space programs.
+ * ------------------------------------------------------------------------
+ * Authors : Ross K. Snider and Trevor Vannoy
+ * Company : Montana State University
+ * Create Date : October 17, 2026
+ * Revision : 1.0
+ * License : GPL-2.0 or MIT (opensource.org / licenses / MIT, GPL-2.0)
+-------------------------------------------------------------------------*/
+#ifndef COMB_FILTER_PROCESSOR_H
+#define COMB_FILTER_PROCESSOR_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/*-----------------------------------------------------------------------*/
+/* Component Register Offsets                                            */
+/*-----------------------------------------------------------------------*/
+/*
+ * The parameter registers hold raw fixed-point values in the formats of
+ * fixed_point.h (the names in parentheses):
+ *   delayM     uint16        delay in samples    (fixed_comb_delay)
+ *   b0, bM     sfix16_En16   feedforward gains   (fixed_comb_gain)
+ *   wetDryMix  ufix16_En16   1.0 is all wet      (fixed_comb_mix)
+ *
+ * They are double-buffered: writes only stage a value, and reads return
+ * the staged value. Setting COMB_FILTER_CONTROL_COMMIT in the control
+ * register makes all four staged values take effect together at the
+ * next left-channel sample; the bit reads 1 until that happened.
+ */
+#define REG0_DELAY_M_OFFSET 0x0
+#define REG1_B0_OFFSET 0x04
+#define REG2_BM_OFFSET 0x08
+#define REG3_WET_DRY_MIX_OFFSET 0x0C
+#define REG4_CONTROL_OFFSET 0x10
+
+/* Control register bits                                                 */
+#define COMB_FILTER_CONTROL_COMMIT 0x1  /* Commit the staged parameters  */
+
+/*-----------------------------------------------------------------------*/
+/* Filter Parameters                                                     */
+/*-----------------------------------------------------------------------*/
+/*
+ * struct comb_filter_params - All comb filter parameters
+ * @delay_m: Raw delayM register value (0..0xFFFF).
+ * @b0: Raw b0 register value (-0x8000..0x7FFF).
+ * @bm: Raw bM register value (-0x8000..0x7FFF).
+ * @wet_dry_mix: Raw wetDryMix register value (0..0xFFFF).
+ *
+ * All four values are checked before any register is written, so a bad
+ * value never leaves a half-staged set behind.
+ */
+struct comb_filter_params {
+	__u32 delay_m;
+	__s32 b0;
+	__s32 bm;
+	__u32 wet_dry_mix;
+};
+
+/*-----------------------------------------------------------------------*/
+/* ioctl Commands                                                        */
+/*-----------------------------------------------------------------------*/
+/*
+ * COMB_FILTER_IOC_SET_PARAMS     stage all four parameters and commit them
+ * COMB_FILTER_IOC_GET_PARAMS     read the staged parameters
+ * COMB_FILTER_IOC_STAGE_PARAMS   stage all four parameters, don't commit
+ * COMB_FILTER_IOC_COMMIT         commit what was staged
+ *
+ * The commit ioctls return once the commit is requested; the parameters
+ * take effect at the next left-channel sample. Staging waits for an
+ * earlier commit to take effect first, so a commit never picks up a
+ * half-staged set. If no audio is streaming, the earlier commit stays
+ * pending, and staging fails with ETIMEDOUT without touching a register.
+ */
+#define COMB_FILTER_IOC_MAGIC 'c'
+
+#define COMB_FILTER_IOC_SET_PARAMS \
+	_IOW(COMB_FILTER_IOC_MAGIC, 0x01, struct comb_filter_params)
+#define COMB_FILTER_IOC_GET_PARAMS \
+	_IOR(COMB_FILTER_IOC_MAGIC, 0x02, struct comb_filter_params)
+#define COMB_FILTER_IOC_STAGE_PARAMS \
+	_IOW(COMB_FILTER_IOC_MAGIC, 0x03, struct comb_filter_params)
+#define COMB_FILTER_IOC_COMMIT \
+	_IO(COMB_FILTER_IOC_MAGIC, 0x04)
+
+#endif
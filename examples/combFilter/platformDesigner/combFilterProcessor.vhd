@@ -26,6 +26,10 @@
 --                   This file is a wrapper for the VHDL code
 --                   combFilterSystem.vhd that was created by HDL Coder
 --                   from the Simulink model combFilterFeedforward.slx
+--                   The parameter registers are double-buffered, see
+--                   combFilterRegisters.vhd: writes are staged and take
+--                   effect together when committed through the control
+--                   register (address 4).
 --
 ---------------------------------------------------------------------------
 library ieee;
@@ -42,7 +46,7 @@ entity combfilterprocessor is
     avalon_st_source_valid   : out   std_logic;
     avalon_st_source_data    : out   std_logic_vector(23 downto 0);
     avalon_st_source_channel : out   std_logic_vector(0 downto 0);
-    avalon_mm_address        : in    std_logic_vector(1 downto 0);
+    avalon_mm_address        : in    std_logic_vector(2 downto 0);
     avalon_mm_read           : in    std_logic;
     avalon_mm_readdata       : out   std_logic_vector(31 downto 0);
     avalon_mm_write          : in    std_logic;
@@ -94,6 +98,25 @@ architecture behavioral of combfilterprocessor is
     );
   end component lr2ast;
 
+  -- Double-buffered parameter registers
+  component combfilterregisters is
+    port (
+      clk                    : in    std_logic;
+      reset                  : in    std_logic;
+      avalon_st_sink_valid   : in    std_logic;
+      avalon_st_sink_channel : in    std_logic_vector(0 downto 0);
+      avalon_mm_address      : in    std_logic_vector(2 downto 0);
+      avalon_mm_read         : in    std_logic;
+      avalon_mm_readdata     : out   std_logic_vector(31 downto 0);
+      avalon_mm_write        : in    std_logic;
+      avalon_mm_writedata    : in    std_logic_vector(31 downto 0);
+      delaym                 : out   std_logic_vector(15 downto 0);
+      b0                     : out   std_logic_vector(15 downto 0);
+      bm                     : out   std_logic_vector(15 downto 0);
+      wetdrymix              : out   std_logic_vector(15 downto 0)
+    );
+  end component combfilterregisters;
+
   -- streaming internal signals
   signal left_data_sink    : std_logic_vector(23 downto 0);
   signal right_data_sink   : std_logic_vector(23 downto 0);
@@ -106,14 +129,12 @@ architecture behavioral of combfilterprocessor is
   --       and prefix with left_ and right_
   --       This will require twice as many entries in the
   --       associated linux device driver
-  -- delayM - uint16 - default value = "0001001011000000" = 24000 (0.5 sec)
-  signal delaym    : std_logic_vector(15 downto 0) := "0101110111000000";
-  -- b0 - sfix16_En16 - default value = "0111111111111111" = ~0.5
-  signal b0        : std_logic_vector(15 downto 0) := "0111111111111111";
-  -- bm - sfix16_En16 - default value = "0111111111111111" = ~0.5
-  signal bm        : std_logic_vector(15 downto 0) := "0111111111111111";
-  -- wetDryMix - ufix16_En16 - default value = "1111111111111111" = ~1
-  signal wetdrymix : std_logic_vector(15 downto 0) := "1111111111111111";
+  -- These are the active parameters; combFilterRegisters holds the
+  -- staged copies the CPU writes and commits them on a sample boundary.
+  signal delaym    : std_logic_vector(15 downto 0);
+  signal b0        : std_logic_vector(15 downto 0);
+  signal bm        : std_logic_vector(15 downto 0);
+  signal wetdrymix : std_logic_vector(15 downto 0);
 
 begin
 
@@ -171,68 +192,23 @@ begin
       audioout   => right_data_source
     );
 
-  -- Avalon Memory Mapped interface (CPU reading from registers)
-  bus_read : process (clk) is
-  begin
-
-    if rising_edge(clk) and avalon_mm_read = '1' then
-
-      case avalon_mm_address is
-
-        when "00" =>
-          avalon_mm_readdata <= std_logic_vector(resize(unsigned(delaym), 32));
-
-        when "01" =>
-          avalon_mm_readdata <= std_logic_vector(resize(signed(b0), 32));
-
-        when "10" =>
-          avalon_mm_readdata <= std_logic_vector(resize(signed(bm), 32));
-
-        when "11" =>
-          avalon_mm_readdata <= std_logic_vector(resize(unsigned(wetdrymix), 32));
-
-        when others =>
-          avalon_mm_readdata <= (others => '0');
-
-      end case;
-
-    end if;
-
-  end process bus_read;
-
-  -- Avalon Memory Mapped interface (CPU writing to registers)
-  bus_write : process (clk, reset) is
-  begin
-
-    if reset = '1' then
-      delaym    <= "0101110111000000"; -- 24000
-      b0        <= "0111111111111111"; -- ~0.5
-      bm        <= "0111111111111111"; -- ~0.5
-      wetdrymix <= "1111111111111111"; -- ~1
-    elsif rising_edge(clk) and avalon_mm_write = '1' then
-
-      case avalon_mm_address is
-
-        when "00" =>
-          delaym <= std_logic_vector(resize(unsigned(avalon_mm_writedata), 16));
-
-        when "01" =>
-          b0 <= std_logic_vector(resize(signed(avalon_mm_writedata), 16));
-
-        when "10" =>
-          bm <= std_logic_vector(resize(signed(avalon_mm_writedata), 16));
-
-        when "11" =>
-          wetdrymix <= std_logic_vector(resize(unsigned(avalon_mm_writedata), 16));
-
-        when others =>
-          null;
-
-      end case;
-
-    end if;
-
-  end process bus_write;
+  -- Staged and active parameter registers
+  u_combfilterregisters : component combfilterregisters
+    port map (
+      clk                    => clk,
+      reset                  => reset,
+      avalon_st_sink_valid   => avalon_st_sink_valid,
+      avalon_st_sink_channel => avalon_st_sink_channel,
+      avalon_mm_address      => avalon_mm_address,
+      avalon_mm_read         => avalon_mm_read,
+      avalon_mm_readdata     => avalon_mm_readdata,
+      avalon_mm_write        => avalon_mm_write,
+      avalon_mm_writedata    => avalon_mm_writedata,
+      delaym                 => delaym,
+      b0                     => b0,
+      bm                     => bm,
+      wetdrymix              => wetdrymix
+    );
 
 end architecture behavioral;
 
@@ -40,6 +40,7 @@ set_fileset_property QUARTUS_SYNTH TOP_LEVEL combFilterProcessor
 set_fileset_property QUARTUS_SYNTH ENABLE_RELATIVE_INCLUDE_PATHS false
 set_fileset_property QUARTUS_SYNTH ENABLE_FILE_OVERWRITE_MODE false
 add_fileset_file combFilterProcessor.vhd VHDL PATH combFilterProcessor.vhd TOP_LEVEL_FILE
+add_fileset_file combFilterRegisters.vhd VHDL PATH combFilterRegisters.vhd
 
 
 # 
@@ -107,7 +108,7 @@ set_interface_property avalon_mm PORT_NAME_MAP ""
 set_interface_property avalon_mm CMSIS_SVD_VARIABLES ""
 set_interface_property avalon_mm SVD_ADDRESS_GROUP ""
 
-add_interface_port avalon_mm avalon_mm_address address Input 2
+add_interface_port avalon_mm avalon_mm_address address Input 3
 add_interface_port avalon_mm avalon_mm_read read Input 1
 add_interface_port avalon_mm avalon_mm_readdata readdata Output 32
 add_interface_port avalon_mm avalon_mm_write write Input 1
@@ -0,0 +1,192 @@
+-- SPDX-License-Identifier: MIT
+-- Copyright (c) 2026 Ross K. Snider.  All rights reserved.
+---------------------------------------------------------------------------
+-- This file is used in the book: Advanced Digital System Design using
+-- System-on-Chip Field Programmable Gate Arrays
+-- An Integrated Hardware/Software Approach
+-- by Ross K. Snider
+---------------------------------------------------------------------------
+-- Authors:          Ross K. Snider
+-- Company:          Montana State University
+-- Create Date:      October 17, 2026
+-- Revision:         1.0
+-- License: MIT      (opensource.org/licenses/MIT)
+-- Target Device(s): Terasic D1E0-Nano Board
+-- Tool versions:    Quartus Prime 20.1
+---------------------------------------------------------------------------
+--
+-- Design Name:      combFilterRegisters.vhd
+--
+-- Description:      Double-buffered parameter registers of the
+--                   combFilterProcessor component.
+--                   The CPU writes the staged (shadow) registers; the
+--                   filter only sees the active registers. Writing a 1
+--                   to bit 0 of the control register requests a commit:
+--                   at the next sample boundary (avalon_st_sink_valid
+--                   with channel 0) all four staged registers are copied
+--                   to the active registers in the same clock cycle, so
+--                   the filter never runs with a mix of old and new
+--                   parameters.
+--
+--                   Register map (32-bit words)
+--                     0  delayM     uint16       staged
+--                     1  b0         sfix16_En16  staged
+--                     2  bM         sfix16_En16  staged
+--                     3  wetDryMix  ufix16_En16  staged
+--                     4  control    bit 0: write 1 to commit,
+--                                          reads 1 until the commit is done
+--                     5..7          reserved, read as 0
+--                   Reads of registers 0..3 return the staged values.
+--
+---------------------------------------------------------------------------
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+entity combfilterregisters is
+  port (
+    clk                    : in    std_logic;
+    reset                  : in    std_logic;
+    avalon_st_sink_valid   : in    std_logic;
+    avalon_st_sink_channel : in    std_logic_vector(0 downto 0);
+    avalon_mm_address      : in    std_logic_vector(2 downto 0);
+    avalon_mm_read         : in    std_logic;
+    avalon_mm_readdata     : out   std_logic_vector(31 downto 0);
+    avalon_mm_write        : in    std_logic;
+    avalon_mm_writedata    : in    std_logic_vector(31 downto 0);
+    delaym                 : out   std_logic_vector(15 downto 0);
+    b0                     : out   std_logic_vector(15 downto 0);
+    bm                     : out   std_logic_vector(15 downto 0);
+    wetdrymix              : out   std_logic_vector(15 downto 0)
+  );
+end entity combfilterregisters;
+
+architecture behavioral of combfilterregisters is
+
+  -- Register defaults
+  -- delayM - uint16 - "0101110111000000" = 24000 (0.5 sec)
+  constant delaym_default    : std_logic_vector(15 downto 0) := "0101110111000000";
+  -- b0 - sfix16_En16 - "0111111111111111" = ~0.5
+  constant b0_default        : std_logic_vector(15 downto 0) := "0111111111111111";
+  -- bm - sfix16_En16 - "0111111111111111" = ~0.5
+  constant bm_default        : std_logic_vector(15 downto 0) := "0111111111111111";
+  -- wetDryMix - ufix16_En16 - "1111111111111111" = ~1
+  constant wetdrymix_default : std_logic_vector(15 downto 0) := "1111111111111111";
+
+  -- staged (shadow) registers written by the CPU
+  signal delaym_staged    : std_logic_vector(15 downto 0) := delaym_default;
+  signal b0_staged        : std_logic_vector(15 downto 0) := b0_default;
+  signal bm_staged        : std_logic_vector(15 downto 0) := bm_default;
+  signal wetdrymix_staged : std_logic_vector(15 downto 0) := wetdrymix_default;
+
+  -- active registers seen by the filter
+  signal delaym_active    : std_logic_vector(15 downto 0) := delaym_default;
+  signal b0_active        : std_logic_vector(15 downto 0) := b0_default;
+  signal bm_active        : std_logic_vector(15 downto 0) := bm_default;
+  signal wetdrymix_active : std_logic_vector(15 downto 0) := wetdrymix_default;
+
+  -- a commit was requested and waits for the next sample boundary
+  signal commit_pending : std_logic := '0';
+
+begin
+
+  delaym    <= delaym_active;
+  b0        <= b0_active;
+  bm        <= bm_active;
+  wetdrymix <= wetdrymix_active;
+
+  -- Avalon Memory Mapped interface (CPU reading from registers)
+  bus_read : process (clk) is
+  begin
+
+    if rising_edge(clk) and avalon_mm_read = '1' then
+
+      case avalon_mm_address is
+
+        when "000" =>
+          avalon_mm_readdata <= std_logic_vector(resize(unsigned(delaym_staged), 32));
+
+        when "001" =>
+          avalon_mm_readdata <= std_logic_vector(resize(signed(b0_staged), 32));
+
+        when "010" =>
+          avalon_mm_readdata <= std_logic_vector(resize(signed(bm_staged), 32));
+
+        when "011" =>
+          avalon_mm_readdata <= std_logic_vector(resize(unsigned(wetdrymix_staged), 32));
+
+        when "100" =>
+          avalon_mm_readdata <= (0 => commit_pending, others => '0');
+
+        when others =>
+          avalon_mm_readdata <= (others => '0');
+
+      end case;
+
+    end if;
+
+  end process bus_read;
+
+  -- Avalon Memory Mapped interface (CPU writing to registers) and the
+  -- commit of the staged registers on a sample boundary
+  bus_write : process (clk, reset) is
+  begin
+
+    if reset = '1' then
+      delaym_staged    <= delaym_default;
+      b0_staged        <= b0_default;
+      bm_staged        <= bm_default;
+      wetdrymix_staged <= wetdrymix_default;
+      delaym_active    <= delaym_default;
+      b0_active        <= b0_default;
+      bm_active        <= bm_default;
+      wetdrymix_active <= wetdrymix_default;
+      commit_pending   <= '0';
+    elsif rising_edge(clk) then
+
+      -- A left sample starts a new frame; both channels switch to the
+      -- new parameters together. A staged register written in this same
+      -- cycle is copied with its old value and waits for the next commit.
+      if commit_pending = '1' and avalon_st_sink_valid = '1' and avalon_st_sink_channel = "0" then
+        delaym_active    <= delaym_staged;
+        b0_active        <= b0_staged;
+        bm_active        <= bm_staged;
+        wetdrymix_active <= wetdrymix_staged;
+        commit_pending   <= '0';
+      end if;
+
+      if avalon_mm_write = '1' then
+
+        case avalon_mm_address is
+
+          when "000" =>
+            delaym_staged <= std_logic_vector(resize(unsigned(avalon_mm_writedata), 16));
+
+          when "001" =>
+            b0_staged <= std_logic_vector(resize(signed(avalon_mm_writedata), 16));
+
+          when "010" =>
+            bm_staged <= std_logic_vector(resize(signed(avalon_mm_writedata), 16));
+
+          when "011" =>
+            wetdrymix_staged <= std_logic_vector(resize(unsigned(avalon_mm_writedata), 16));
+
+          when "100" =>
+            -- A commit requested on a boundary cycle stays pending
+            -- for the next boundary
+            if avalon_mm_writedata(0) = '1' then
+              commit_pending <= '1';
+            end if;
+
+          when others =>
+            null;
+
+        end case;
+
+      end if;
+
+    end if;
+
+  end process bus_write;
+
+end architecture behavioral;
@@ -0,0 +1,300 @@
+-- SPDX-License-Identifier: MIT
+-- Copyright (c) 2026 Ross K. Snider.  All rights reserved.
+---------------------------------------------------------------------------
+-- This file is used in the book: Advanced Digital System Design using
+-- System-on-Chip Field Programmable Gate Arrays
+-- An Integrated Hardware/Software Approach
+-- by Ross K. Snider
+---------------------------------------------------------------------------
+-- Authors:          Ross K. Snider
+-- Company:          Montana State University
+-- Create Date:      October 17, 2026
+-- Revision:         1.0
+-- License: MIT      (opensource.org/licenses/MIT)
+---------------------------------------------------------------------------
+--
+-- Design Name:      combFilterRegisters_tb.vhd
+--
+-- Description:      Self-checking test bench for combFilterRegisters.
+--                   Checks that
+--                     1. writes only change the staged registers, and read
+--                        back with the right sign/zero extension,
+--                     2. a commit waits for a sample with channel 0;
+--                        right channel samples don't commit,
+--                     3. all four active registers change in the same
+--                        clock cycle, and only on a channel 0 sample,
+--                     4. a commit requested on a sample boundary waits
+--                        for the next one, and reset restores the defaults.
+--                   A monitor process checks 3. on every clock cycle.
+--
+--                   Run with GHDL:
+--                     ghdl -a combFilterRegisters.vhd combFilterRegisters_tb.vhd
+--                     ghdl -e combfilterregisters_tb
+--                     ghdl -r combfilterregisters_tb
+--                   The simulation stops on its own; a failed check ends it
+--                   with an error.
+--
+---------------------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+entity combfilterregisters_tb is
+  -- nothing here to see, i.e. no signal i/o
+end entity combfilterregisters_tb;
+
+architecture behavioral of combfilterregisters_tb is
+
+  constant clk_half_period : time := 10 ns;
+
+  -- Register addresses
+  constant addr_delaym    : std_logic_vector(2 downto 0) := "000";
+  constant addr_b0        : std_logic_vector(2 downto 0) := "001";
+  constant addr_bm        : std_logic_vector(2 downto 0) := "010";
+  constant addr_wetdrymix : std_logic_vector(2 downto 0) := "011";
+  constant addr_control   : std_logic_vector(2 downto 0) := "100";
+
+  -- Parameter sets: delayM & b0 & bM & wetDryMix. Every field differs
+  -- between consecutive sets, so a partial update is always visible.
+  subtype param_set is std_logic_vector(63 downto 0);
+  constant set_default : param_set := x"5DC0" & x"7FFF" & x"7FFF" & x"FFFF";
+  constant set_a       : param_set := x"03E8" & x"4000" & x"E000" & x"8000";
+  constant set_b       : param_set := x"0010" & x"C000" & x"1000" & x"0001";
+
+  signal clk      : std_logic := '0';
+  signal reset    : std_logic := '1';
+  signal sim_done : boolean   := false;
+
+  signal sink_valid   : std_logic                    := '0';
+  signal sink_channel : std_logic_vector(0 downto 0) := "0";
+  signal mm_address   : std_logic_vector(2 downto 0) := (others => '0');
+  signal mm_read      : std_logic                    := '0';
+  signal mm_readdata  : std_logic_vector(31 downto 0);
+  signal mm_write     : std_logic                    := '0';
+  signal mm_writedata : std_logic_vector(31 downto 0) := (others => '0');
+  signal delaym       : std_logic_vector(15 downto 0);
+  signal b0           : std_logic_vector(15 downto 0);
+  signal bm           : std_logic_vector(15 downto 0);
+  signal wetdrymix    : std_logic_vector(15 downto 0);
+
+  signal active         : param_set;
+  signal monitor_errors : natural := 0;
+
+  component combfilterregisters is
+    port (
+      clk                    : in    std_logic;
+      reset                  : in    std_logic;
+      avalon_st_sink_valid   : in    std_logic;
+      avalon_st_sink_channel : in    std_logic_vector(0 downto 0);
+      avalon_mm_address      : in    std_logic_vector(2 downto 0);
+      avalon_mm_read         : in    std_logic;
+      avalon_mm_readdata     : out   std_logic_vector(31 downto 0);
+      avalon_mm_write        : in    std_logic;
+      avalon_mm_writedata    : in    std_logic_vector(31 downto 0);
+      delaym                 : out   std_logic_vector(15 downto 0);
+      b0                     : out   std_logic_vector(15 downto 0);
+      bm                     : out   std_logic_vector(15 downto 0);
+      wetdrymix              : out   std_logic_vector(15 downto 0)
+    );
+  end component combfilterregisters;
+
+begin
+
+  dut : component combfilterregisters
+    port map (
+      clk                    => clk,
+      reset                  => reset,
+      avalon_st_sink_valid   => sink_valid,
+      avalon_st_sink_channel => sink_channel,
+      avalon_mm_address      => mm_address,
+      avalon_mm_read         => mm_read,
+      avalon_mm_readdata     => mm_readdata,
+      avalon_mm_write        => mm_write,
+      avalon_mm_writedata    => mm_writedata,
+      delaym                 => delaym,
+      b0                     => b0,
+      bm                     => bm,
+      wetdrymix              => wetdrymix
+    );
+
+  active <= delaym & b0 & bm & wetdrymix;
+
+  -- The clock stops when the test is done, which ends the simulation
+  clk <= not clk after clk_half_period when not sim_done else '0';
+
+  ---------------------------------------------------------------------------
+  -- 3. On every rising edge: if the active registers changed since the
+  --    last edge, all four changed, and the last edge saw a left sample.
+  --    Changes caused by the (asynchronous) reset are not checked.
+  ---------------------------------------------------------------------------
+  monitor : process is
+    variable last_active   : param_set;
+    variable last_boundary : boolean := false;
+    variable last_reset    : boolean := true;
+  begin
+
+    wait until rising_edge(clk);
+
+    if active /= last_active and not last_reset and reset = '0' then
+      if not last_boundary then
+        report "active registers changed without a left sample" severity error;
+        monitor_errors <= monitor_errors + 1;
+      end if;
+      for k in 0 to 3 loop
+        if active(63 - 16 * k downto 48 - 16 * k) = last_active(63 - 16 * k downto 48 - 16 * k) then
+          report "active register " & integer'image(k) & " missed a commit" severity error;
+          monitor_errors <= monitor_errors + 1;
+        end if;
+      end loop;
+    end if;
+
+    last_active   := active;
+    last_boundary := sink_valid = '1' and sink_channel = "0";
+    last_reset    := reset = '1';
+
+  end process monitor;
+
+  ---------------------------------------------------------------------------
+  -- Drive the inputs on the falling edge, like a bus master and a
+  -- streaming source would, and check the results
+  ---------------------------------------------------------------------------
+  stimulus_and_check : process is
+
+    variable errors : natural := 0;
+    variable data   : std_logic_vector(31 downto 0);
+
+    procedure bus_write (address : std_logic_vector(2 downto 0); value : std_logic_vector(31 downto 0)) is
+    begin
+      mm_address   <= address;
+      mm_writedata <= value;
+      mm_write     <= '1';
+      wait until falling_edge(clk);
+      mm_write     <= '0';
+    end procedure bus_write;
+
+    procedure bus_read (address : std_logic_vector(2 downto 0); value : out std_logic_vector(31 downto 0)) is
+    begin
+      mm_address <= address;
+      mm_read    <= '1';
+      wait until falling_edge(clk);
+      mm_read    <= '0';
+      value      := mm_readdata;
+    end procedure bus_read;
+
+    procedure send_sample (channel : std_logic) is
+    begin
+      sink_channel <= (0 => channel);
+      sink_valid   <= '1';
+      wait until falling_edge(clk);
+      sink_valid   <= '0';
+      -- idle cycles between samples, as on the real audio stream
+      wait until falling_edge(clk);
+      wait until falling_edge(clk);
+    end procedure send_sample;
+
+    procedure stage (set : param_set) is
+    begin
+      bus_write(addr_delaym, std_logic_vector(resize(unsigned(set(63 downto 48)), 32)));
+      bus_write(addr_b0, std_logic_vector(resize(signed(set(47 downto 32)), 32)));
+      bus_write(addr_bm, std_logic_vector(resize(signed(set(31 downto 16)), 32)));
+      bus_write(addr_wetdrymix, std_logic_vector(resize(unsigned(set(15 downto 0)), 32)));
+    end procedure stage;
+
+    procedure check (condition : boolean; message : string) is
+    begin
+      if not condition then
+        report message severity error;
+        errors := errors + 1;
+      end if;
+    end procedure check;
+
+  begin
+
+    wait until falling_edge(clk);
+    wait until falling_edge(clk);
+    reset <= '0';
+    wait until falling_edge(clk);
+
+    check(active = set_default, "active registers don't hold the defaults after reset");
+    bus_read(addr_control, data);
+    check(data = x"00000000", "commit pending after reset");
+
+    -- 1. Staging changes nothing the filter sees, even across samples
+    bus_write(addr_delaym, x"000003E8");
+    send_sample('0');
+    bus_write(addr_b0, x"00004000");
+    send_sample('1');
+    bus_write(addr_bm, x"FFFFE000");
+    send_sample('0');
+    bus_write(addr_wetdrymix, x"00008000");
+    send_sample('1');
+    check(active = set_default, "staged registers reached the filter without a commit");
+
+    bus_read(addr_delaym, data);
+    check(data = x"000003E8", "delayM doesn't read back the staged value");
+    bus_read(addr_b0, data);
+    check(data = x"00004000", "b0 doesn't read back the staged value");
+    bus_read(addr_bm, data);
+    check(data = x"FFFFE000", "bM doesn't read back sign-extended");
+    bus_read(addr_wetdrymix, data);
+    check(data = x"00008000", "wetDryMix doesn't read back zero-extended");
+
+    -- Writing 0 to the control register doesn't commit
+    bus_write(addr_control, x"00000000");
+    send_sample('0');
+    check(active = set_default, "writing 0 to the control register committed");
+
+    -- 2. The commit waits for a left sample
+    bus_write(addr_control, x"00000001");
+    bus_read(addr_control, data);
+    check(data = x"00000001", "commit not pending after it was requested");
+    send_sample('1');
+    send_sample('1');
+    check(active = set_default, "a right sample committed");
+    bus_read(addr_control, data);
+    check(data = x"00000001", "commit not pending before a left sample");
+    send_sample('0');
+    check(active = set_a, "left sample didn't commit the staged set");
+    bus_read(addr_control, data);
+    check(data = x"00000000", "commit still pending after a left sample");
+
+    -- 4. A commit requested on a boundary cycle waits for the next one
+    stage(set_b);
+    mm_address   <= addr_control;
+    mm_writedata <= x"00000001";
+    mm_write     <= '1';
+    sink_channel <= "0";
+    sink_valid   <= '1';
+    wait until falling_edge(clk);
+    mm_write     <= '0';
+    sink_valid   <= '0';
+    check(active = set_a, "commit on a boundary cycle took effect on that cycle");
+    send_sample('0');
+    check(active = set_b, "commit on a boundary cycle was lost");
+
+    -- A reset restores the defaults and drops a pending commit
+    stage(set_a);
+    bus_write(addr_control, x"00000001");
+    reset <= '1';
+    wait until falling_edge(clk);
+    reset <= '0';
+    wait until falling_edge(clk);
+    send_sample('0');
+    check(active = set_default, "reset didn't restore the defaults");
+    bus_read(addr_delaym, data);
+    check(data = x"00005DC0", "reset didn't restore the staged delayM");
+
+    wait until falling_edge(clk);
+
+    errors := errors + monitor_errors;
+    assert errors = 0
+      report integer'image(errors) & " errors" severity failure;
+    report "combfilterregisters_tb passed";
+
+    sim_done <= true;
+    wait;
+
+  end process stimulus_and_check;
+
+end architecture behavioral;
@@ -2,6 +2,11 @@
 /*
  * *Very minimal* SPI driver for the AD1939 audio codec on the Audio Mini.
  *
+ * The control registers are kept in a regmap cache, and sysfs attributes on the
+ * SPI device change the sample rate, the PLL source, stereo or TDM framing,
+ * the DAC and ADC mutes and the DAC channel volumes at run time, e.g.
+ *   echo 96000 > /sys/bus/spi/devices/spi0.0/sample_rate
+ *
  * Original platform driver by Tyler Davis, Copyright (c) 2018 AudioLogic Inc, Bozeman MT.
  * Rewritten as a SPI driver by Trevor Vannoy, Copyright (c) 2024 Trevor Vannoy.
  */
@@ -9,55 +14,551 @@
 #include <linux/module.h>
 #include <linux/spi/spi.h>
 #include <linux/of.h>
+#include <linux/slab.h>
+#include <linux/completion.h>
+#include <linux/mutex.h>
+#include <linux/ktime.h>
+#include <linux/workqueue.h>
+#include <linux/regmap.h>
+#include <linux/sysfs.h>
+#include <linux/pm.h>
+
+// Every AD1939 SPI word is 3 bytes: the chip address with the read/write bit,
+// the register address and the value. We send them as three 8-bit words.
+#define AD1939_WORD_LEN 3
+#define AD1939_WRITE 0x08
+#define AD1939_READ 0x09
+
+// Attempts to write the init values again after the init message fails
+#define AD1939_INIT_RETRIES 3
+#define AD1939_INIT_RETRY_MS 100
+
+// AD1939 control registers, see the datasheet Table 12 (all reset to 0)
+#define AD1939_PLL_CLK_CTRL0    0
+#define AD1939_PLL_CLK_CTRL1    1
+#define AD1939_DAC_CTRL0        2
+#define AD1939_DAC_CTRL1        3
+#define AD1939_DAC_CTRL2        4
+#define AD1939_DAC_CHNL_MUTE    5
+#define AD1939_DAC_VOL(ch)      (6 + (ch))  // DAC1L, DAC1R, ... DAC4R
+#define AD1939_ADC_CTRL0        14
+#define AD1939_ADC_CTRL1        15
+#define AD1939_ADC_CTRL2        16
+#define AD1939_NUM_REGS         17
+
+#define AD1939_PLL_INPUT_MASK   0x60        // PLL_CLK_CTRL0: PLL input
+#define AD1939_PLL_INPUT_SHIFT  5
+#define AD1939_DAC_FS_MASK      0x06        // DAC_CTRL0: sample rate
+#define AD1939_DAC_FS_SHIFT     1
+#define AD1939_DAC_FMT_MASK     0xC0        // DAC_CTRL0: serial format
+#define AD1939_DAC_FMT_TDM      0x40
+#define AD1939_DAC_BCLKS_MASK   0x06        // DAC_CTRL1: BCLKs per frame
+#define AD1939_DAC_BCLKS_256    0x04
+#define AD1939_DAC_MASTER_MUTE  0x01        // DAC_CTRL2: mute all DACs
+#define AD1939_ADC_MUTE_MASK    0x3C        // ADC_CTRL0: ADC1L..ADC2R mutes
+#define AD1939_ADC_FS_MASK      0xC0        // ADC_CTRL0: output sample rate
+#define AD1939_ADC_FS_SHIFT     6
+#define AD1939_ADC_FMT_MASK     0x60        // ADC_CTRL1: serial format
+#define AD1939_ADC_FMT_TDM      0x20
+#define AD1939_ADC_BCLKS_MASK   0x30        // ADC_CTRL2: BCLKs per frame
+#define AD1939_ADC_BCLKS_256    0x20
+
+/** The init sequence, in the order it's sent */
+static const u8 ad1939_init_words[][AD1939_WORD_LEN] =
+{
+    // Unmute the channels
+    { AD1939_WRITE, AD1939_PLL_CLK_CTRL0, 0x80 },
+    // PLL mode
+    { AD1939_WRITE, AD1939_PLL_CLK_CTRL1, 0x00 },
+    { AD1939_WRITE, AD1939_ADC_CTRL2,     0xC8 },
+    // Sampling frequency of 48 kHz (ADC control register 0)
+    { AD1939_WRITE, AD1939_DAC_CTRL0,     0x00 },
+    { AD1939_WRITE, AD1939_ADC_CTRL0,     0x00 },
+};
+
+#define AD1939_INIT_WORDS ARRAY_SIZE(ad1939_init_words)
+
+/** Per-device state: the register map, and the init message with its DMA-safe buffer */
+struct ad1939_audiomini
+{
+    struct spi_device *spidev;
+    struct regmap *regmap;      // Cached copy of all the control registers
+    struct mutex lock;          // Held across the stores that update several registers
+    struct spi_message msg;
+    struct spi_transfer xfers[AD1939_INIT_WORDS];
+    u8 *tx;                     // kmalloc'ed copy of ad1939_init_words; SPI DMA can't use .rodata
+    struct completion done;     // Completed when the init message has been sent
+    ktime_t start;
+    int init_status;            // -EINPROGRESS until the codec holds the init values, then 0 or the error
+    unsigned int init_retries;
+    struct delayed_work init_work; // Writes the cached init values again after a failed init message
+    bool tdm_routed;            // The board routes DSDATA1 and ASDATA1 to the FPGA; see serial_mode
+};
+
+/** Completion callback of the init message; runs in the SPI controller's context */
+static void ad1939_init_complete(void *context)
+{
+    struct ad1939_audiomini *codec = context;
+    struct device *dev = &codec->spidev->dev;
+    unsigned int failed;
+
+    if (codec->msg.status)
+    {
+        // The controller stops at the first failing transfer; everything before it went out
+        failed = codec->msg.actual_length / AD1939_WORD_LEN;
+        dev_err(dev, "Init write %u of %zu (register 0x%02x) failed: %d\n",
+                failed + 1, AD1939_INIT_WORDS,
+                failed < AD1939_INIT_WORDS ? ad1939_init_words[failed][1] : 0, codec->msg.status);
+
+        // The cache already holds the init values; the retry writes them from there
+        schedule_delayed_work(&codec->init_work, msecs_to_jiffies(AD1939_INIT_RETRY_MS));
+    }
+    else
+    {
+        dev_info(dev, "AD1939 codec initialized: %zu writes in %lld us\n",
+                 AD1939_INIT_WORDS, ktime_us_delta(ktime_get(), codec->start));
+        WRITE_ONCE(codec->init_status, 0);
+    }
+
+    complete(&codec->done);
+}
+
+/** Retry a failed init by writing every cached register that differs from its reset value */
+static void ad1939_init_work(struct work_struct *work)
+{
+    struct ad1939_audiomini *codec = container_of(to_delayed_work(work), struct ad1939_audiomini, init_work);
+    struct device *dev = &codec->spidev->dev;
+    int ret;
+
+    regcache_mark_dirty(codec->regmap);
+    ret = regcache_sync(codec->regmap);
+    if (!ret)
+    {
+        dev_info(dev, "AD1939 codec initialized on retry %u\n", codec->init_retries + 1);
+        WRITE_ONCE(codec->init_status, 0);
+    }
+    else if (++codec->init_retries < AD1939_INIT_RETRIES)
+    {
+        schedule_delayed_work(&codec->init_work, msecs_to_jiffies(AD1939_INIT_RETRY_MS));
+    }
+    else
+    {
+        dev_err(dev, "Giving up on the codec init after %u retries: %d\n", codec->init_retries, ret);
+        WRITE_ONCE(codec->init_status, ret);
+    }
+}
+
+/** Sample rates of the DAC_CTRL0 and ADC_CTRL0 sample rate fields */
+static const unsigned int ad1939_sample_rates[] = { 48000, 96000, 192000 };
+
+/** PLL inputs of the PLL_CLK_CTRL0 PLL input field */
+static const char * const ad1939_pll_sources[] = { "mclk", "dlrclk", "alrclk" };
+
+/** All registers reset to 0; the lock bit in PLL_CLK_CTRL1 isn't used */
+static const struct reg_default ad1939_reg_defaults[] = {
+    { AD1939_PLL_CLK_CTRL0, 0 }, { AD1939_PLL_CLK_CTRL1, 0 },
+    { AD1939_DAC_CTRL0, 0 }, { AD1939_DAC_CTRL1, 0 }, { AD1939_DAC_CTRL2, 0 },
+    { AD1939_DAC_CHNL_MUTE, 0 },
+    { AD1939_DAC_VOL(0), 0 }, { AD1939_DAC_VOL(1), 0 }, { AD1939_DAC_VOL(2), 0 }, { AD1939_DAC_VOL(3), 0 },
+    { AD1939_DAC_VOL(4), 0 }, { AD1939_DAC_VOL(5), 0 }, { AD1939_DAC_VOL(6), 0 }, { AD1939_DAC_VOL(7), 0 },
+    { AD1939_ADC_CTRL0, 0 }, { AD1939_ADC_CTRL1, 0 }, { AD1939_ADC_CTRL2, 0 },
+};
+
+/** 16-bit register field (chip address with the read/write bit, then the register) and 8-bit values.
+
+    Every register is cached, so reads never go over SPI and regmap_update_bits()
+    only writes a register whose value actually changes.
+*/
+static const struct regmap_config ad1939_regmap_config = {
+    .reg_bits = 16,
+    .val_bits = 8,
+    .read_flag_mask = AD1939_READ,
+    .write_flag_mask = AD1939_WRITE,
+    .max_register = AD1939_NUM_REGS - 1,
+    .reg_defaults = ad1939_reg_defaults,
+    .num_reg_defaults = ARRAY_SIZE(ad1939_reg_defaults),
+    .cache_type = REGCACHE_FLAT,
+};
+
+/** 0 once the codec holds the init values; -EAGAIN while the init is in flight or retrying */
+static int ad1939_init_status(struct ad1939_audiomini *codec)
+{
+    int status = READ_ONCE(codec->init_status);
+
+    return status == -EINPROGRESS ? -EAGAIN : status;
+}
+
+/** Update a register field from the cache, writing the codec only if it changes */
+static int ad1939_update(struct device *dev, unsigned int reg, unsigned int mask, unsigned int val)
+{
+    struct ad1939_audiomini *codec = dev_get_drvdata(dev);
+    int ret;
+
+    ret = ad1939_init_status(codec);
+    if (ret)
+        return ret;
+
+    return regmap_update_bits(codec->regmap, reg, mask, val);
+}
+
+/** Read a register from the cache */
+static int ad1939_read(struct device *dev, unsigned int reg, unsigned int *val)
+{
+    struct ad1939_audiomini *codec = dev_get_drvdata(dev);
+    int ret;
+
+    ret = ad1939_init_status(codec);
+    if (ret)
+        return ret;
+
+    return regmap_read(codec->regmap, reg, val);
+}
+
+/** sample_rate: 48000, 96000 or 192000 Hz, for the DACs and the ADCs together */
+static ssize_t sample_rate_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    unsigned int val;
+    unsigned int fs;
+    int ret;
+
+    ret = ad1939_read(dev, AD1939_DAC_CTRL0, &val);
+    if (ret)
+        return ret;
+
+    fs = (val & AD1939_DAC_FS_MASK) >> AD1939_DAC_FS_SHIFT;
+    if (fs >= ARRAY_SIZE(ad1939_sample_rates))
+        return -EIO;
+
+    return sysfs_emit(buf, "%u\n", ad1939_sample_rates[fs]);
+}
+
+static ssize_t sample_rate_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct ad1939_audiomini *codec = dev_get_drvdata(dev);
+    unsigned int rate;
+    unsigned int fs;
+    int ret;
+
+    ret = kstrtouint(buf, 10, &rate);
+    if (ret)
+        return ret;
+
+    for (fs = 0; fs < ARRAY_SIZE(ad1939_sample_rates); fs++)
+    {
+        if (ad1939_sample_rates[fs] == rate)
+            break;
+    }
+    if (fs == ARRAY_SIZE(ad1939_sample_rates))
+        return -EINVAL;
+
+    // The DACs and the ADCs change together, so a concurrent store can't leave them apart
+    mutex_lock(&codec->lock);
+    ret = ad1939_update(dev, AD1939_DAC_CTRL0, AD1939_DAC_FS_MASK, fs << AD1939_DAC_FS_SHIFT);
+    if (!ret)
+        ret = ad1939_update(dev, AD1939_ADC_CTRL0, AD1939_ADC_FS_MASK, fs << AD1939_ADC_FS_SHIFT);
+    mutex_unlock(&codec->lock);
+
+    return ret ? ret : count;
+}
+static DEVICE_ATTR_RW(sample_rate);
+
+/** pll_source: the PLL input, "mclk", "dlrclk" or "alrclk" */
+static ssize_t pll_source_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    unsigned int val;
+    unsigned int src;
+    int ret;
+
+    ret = ad1939_read(dev, AD1939_PLL_CLK_CTRL0, &val);
+    if (ret)
+        return ret;
+
+    src = (val & AD1939_PLL_INPUT_MASK) >> AD1939_PLL_INPUT_SHIFT;
+    if (src >= ARRAY_SIZE(ad1939_pll_sources))
+        return -EIO;
+
+    return sysfs_emit(buf, "%s\n", ad1939_pll_sources[src]);
+}
+
+static ssize_t pll_source_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    int src;
+    int ret;
+
+    src = sysfs_match_string(ad1939_pll_sources, buf);
+    if (src < 0)
+        return src;
+
+    ret = ad1939_update(dev, AD1939_PLL_CLK_CTRL0, AD1939_PLL_INPUT_MASK, src << AD1939_PLL_INPUT_SHIFT);
+
+    return ret ? ret : count;
+}
+static DEVICE_ATTR_RW(pll_source);
+
+/** dac_mute: 1 mutes all the DACs (the master mute), 0 unmutes them */
+static ssize_t dac_mute_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    unsigned int val;
+    int ret;
+
+    ret = ad1939_read(dev, AD1939_DAC_CTRL2, &val);
+    if (ret)
+        return ret;
+
+    return sysfs_emit(buf, "%d\n", !!(val & AD1939_DAC_MASTER_MUTE));
+}
+
+static ssize_t dac_mute_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    bool mute;
+    int ret;
+
+    ret = kstrtobool(buf, &mute);
+    if (ret)
+        return ret;
+
+    ret = ad1939_update(dev, AD1939_DAC_CTRL2, AD1939_DAC_MASTER_MUTE, mute ? AD1939_DAC_MASTER_MUTE : 0);
+
+    return ret ? ret : count;
+}
+static DEVICE_ATTR_RW(dac_mute);
+
+/** adc_mute: 1 mutes all four ADC channels, 0 unmutes them */
+static ssize_t adc_mute_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    unsigned int val;
+    int ret;
+
+    ret = ad1939_read(dev, AD1939_ADC_CTRL0, &val);
+    if (ret)
+        return ret;
+
+    return sysfs_emit(buf, "%d\n", (val & AD1939_ADC_MUTE_MASK) == AD1939_ADC_MUTE_MASK);
+}
+
+static ssize_t adc_mute_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    bool mute;
+    int ret;
+
+    ret = kstrtobool(buf, &mute);
+    if (ret)
+        return ret;
+
+    ret = ad1939_update(dev, AD1939_ADC_CTRL0, AD1939_ADC_MUTE_MASK, mute ? AD1939_ADC_MUTE_MASK : 0);
+
+    return ret ? ret : count;
+}
+static DEVICE_ATTR_RW(adc_mute);
+
+/** serial_mode: "stereo" (I2S pairs, 64 BCLKs per frame) or "tdm"
+
+    TDM puts all eight DAC channels on DSDATA1 and all four ADC channels on
+    ASDATA1, in 256-BCLK frames of 32-bit slots. The FPGA side has to match; the
+    channels of a frame map onto an Avalon-ST channel number with ast2channels
+    and channels2ast in lib/vhdl.
+
+    The Audio Mini only wires ASDATA2 and DSDATA1 to the FPGA, so TDM would leave
+    it with no ADC data. "tdm" is refused with -EOPNOTSUPP unless the device tree
+    node has the boolean "dev,tdm-routed" property, for boards that route ASDATA1.
+*/
+static ssize_t serial_mode_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    unsigned int val;
+    int ret;
+
+    ret = ad1939_read(dev, AD1939_DAC_CTRL0, &val);
+    if (ret)
+        return ret;
+
+    return sysfs_emit(buf, "%s\n", (val & AD1939_DAC_FMT_MASK) == AD1939_DAC_FMT_TDM ? "tdm" : "stereo");
+}
+
+static ssize_t serial_mode_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct ad1939_audiomini *codec = dev_get_drvdata(dev);
+    bool tdm;
+    int ret;
+
+    if (sysfs_streq(buf, "tdm"))
+        tdm = true;
+    else if (sysfs_streq(buf, "stereo"))
+        tdm = false;
+    else
+        return -EINVAL;
+
+    if (tdm && !codec->tdm_routed)
+        return -EOPNOTSUPP;
+
+    mutex_lock(&codec->lock);
+    ret = ad1939_update(dev, AD1939_DAC_CTRL0, AD1939_DAC_FMT_MASK, tdm ? AD1939_DAC_FMT_TDM : 0);
+    if (!ret)
+        ret = ad1939_update(dev, AD1939_DAC_CTRL1, AD1939_DAC_BCLKS_MASK, tdm ? AD1939_DAC_BCLKS_256 : 0);
+    if (!ret)
+        ret = ad1939_update(dev, AD1939_ADC_CTRL1, AD1939_ADC_FMT_MASK, tdm ? AD1939_ADC_FMT_TDM : 0);
+    if (!ret)
+        ret = ad1939_update(dev, AD1939_ADC_CTRL2, AD1939_ADC_BCLKS_MASK, tdm ? AD1939_ADC_BCLKS_256 : 0);
+    mutex_unlock(&codec->lock);
+
+    return ret ? ret : count;
+}
+static DEVICE_ATTR_RW(serial_mode);
+
+/** DAC volume of one channel: the attenuation in 3/8 dB steps, 0 (0 dB) to 255 (mute) */
+static ssize_t dac_volume_show(struct device *dev, unsigned int ch, char *buf)
+{
+    unsigned int val;
+    int ret;
+
+    ret = ad1939_read(dev, AD1939_DAC_VOL(ch), &val);
+    if (ret)
+        return ret;
+
+    return sysfs_emit(buf, "%u\n", val);
+}
+
+static ssize_t dac_volume_store(struct device *dev, unsigned int ch, const char *buf, size_t count)
+{
+    u8 val;
+    int ret;
+
+    ret = kstrtou8(buf, 0, &val);
+    if (ret)
+        return ret;
+
+    ret = ad1939_update(dev, AD1939_DAC_VOL(ch), 0xFF, val);
+
+    return ret ? ret : count;
+}
+
+#define AD1939_DAC_VOLUME_ATTR(name, ch)                                                    \
+static ssize_t name##_show(struct device *dev, struct device_attribute *attr, char *buf)     \
+{                                                                                           \
+    return dac_volume_show(dev, ch, buf);                                                   \
+}                                                                                           \
+static ssize_t name##_store(struct device *dev, struct device_attribute *attr,              \
+                            const char *buf, size_t count)                                  \
+{                                                                                           \
+    return dac_volume_store(dev, ch, buf, count);                                           \
+}                                                                                           \
+static DEVICE_ATTR_RW(name)
+
+AD1939_DAC_VOLUME_ATTR(dac1l_volume, 0);
+AD1939_DAC_VOLUME_ATTR(dac1r_volume, 1);
+AD1939_DAC_VOLUME_ATTR(dac2l_volume, 2);
+AD1939_DAC_VOLUME_ATTR(dac2r_volume, 3);
+AD1939_DAC_VOLUME_ATTR(dac3l_volume, 4);
+AD1939_DAC_VOLUME_ATTR(dac3r_volume, 5);
+AD1939_DAC_VOLUME_ATTR(dac4l_volume, 6);
+AD1939_DAC_VOLUME_ATTR(dac4r_volume, 7);
+
+static struct attribute *ad1939_attrs[] = {
+    &dev_attr_sample_rate.attr,
+    &dev_attr_pll_source.attr,
+    &dev_attr_serial_mode.attr,
+    &dev_attr_dac_mute.attr,
+    &dev_attr_adc_mute.attr,
+    &dev_attr_dac1l_volume.attr,
+    &dev_attr_dac1r_volume.attr,
+    &dev_attr_dac2l_volume.attr,
+    &dev_attr_dac2r_volume.attr,
+    &dev_attr_dac3l_volume.attr,
+    &dev_attr_dac3r_volume.attr,
+    &dev_attr_dac4l_volume.attr,
+    &dev_attr_dac4r_volume.attr,
+    NULL,
+};
+ATTRIBUTE_GROUPS(ad1939);
+
+/** The codec may lose power while suspended; stop touching it and mark the cache dirty */
+static int __maybe_unused ad1939_suspend(struct device *dev)
+{
+    struct ad1939_audiomini *codec = dev_get_drvdata(dev);
+
+    regcache_cache_only(codec->regmap, true);
+    regcache_mark_dirty(codec->regmap);
+    return 0;
+}
+
+/** Write the cached (non-default) register values back to the codec */
+static int __maybe_unused ad1939_resume(struct device *dev)
+{
+    struct ad1939_audiomini *codec = dev_get_drvdata(dev);
+
+    regcache_cache_only(codec->regmap, false);
+    return regcache_sync(codec->regmap);
+}
+
+static SIMPLE_DEV_PM_OPS(ad1939_pm_ops, ad1939_suspend, ad1939_resume);
 
 static int ad1939_audiomini_probe(struct spi_device *spidev)
 {
+    struct ad1939_audiomini *codec;
+    unsigned int i;
     int ret;
-    char cmd[3];
-    cmd[0] = 0x08;
 
     // NOTE: we could set bits_per_word to 24, since that's what the AD1939
     // uses, but for now we are just sending 3 8-bit words.
     // printk("Set the bits per word\n");
     // spidev->bits_per_word = BITS_PER_WORD;
 
-    printk("Initializing AD1939 codec...\n");
+    codec = devm_kzalloc(&spidev->dev, sizeof(*codec), GFP_KERNEL);
+    if (!codec)
+        return -ENOMEM;
 
-    // Set the unmute commands
-    printk("\tUnmuting the channels\n");
-    // cmd = { 0x08,0x00,0x80 };
-    cmd[1] = 0x00;
-    cmd[2] = 0x80;
-    ret = spi_write(spidev, &cmd, sizeof(cmd));
+    codec->tx = devm_kmemdup(&spidev->dev, ad1939_init_words, sizeof(ad1939_init_words), GFP_KERNEL);
+    if (!codec->tx)
+        return -ENOMEM;
 
-    // Send the pll mode command
-    printk("\tSetting PLL mode\n");
-    cmd[1] = 0x01;
-    cmd[2] = 0x00;
-    ret = spi_write(spidev, &cmd, sizeof(cmd));
+    codec->spidev = spidev;
+    codec->tdm_routed = of_property_read_bool(spidev->dev.of_node, "dev,tdm-routed");
+    mutex_init(&codec->lock);
+    init_completion(&codec->done);
+    codec->init_status = -EINPROGRESS;
+    INIT_DELAYED_WORK(&codec->init_work, ad1939_init_work);
+    spi_set_drvdata(spidev, codec);
 
-    cmd[1] = 0x10;
-    cmd[2] = 0xC8;
-    ret = spi_write(spidev, &cmd, sizeof(cmd));
+    codec->regmap = devm_regmap_init_spi(spidev, &ad1939_regmap_config);
+    if (IS_ERR(codec->regmap))
+        return dev_err_probe(&spidev->dev, PTR_ERR(codec->regmap), "Failed to set up the register map\n");
 
-    // Set the sampling frequency (ADC control register 0)
-    printk("\tSetting sampling frequency to 48 kHz\n");
-    cmd[1] = 0x02;
-    cmd[2] = 0x00;
-    ret = spi_write(spidev, &cmd, sizeof(cmd));
+    // Put the init values in the cache without sending them again. The cache is left
+    // dirty, so a resume restores them along with everything changed through sysfs,
+    // and a failed init message is retried from it. The sysfs attributes return
+    // -EAGAIN until the codec holds these values.
+    regcache_cache_only(codec->regmap, true);
+    for (i = 0; i < AD1939_INIT_WORDS; i++)
+        regmap_write(codec->regmap, ad1939_init_words[i][1], ad1939_init_words[i][2]);
+    regcache_cache_only(codec->regmap, false);
 
-    cmd[1] = 14;
-    cmd[2] = 0x00;
-    ret = spi_write(spidev, &cmd, sizeof(cmd));
+    // One transfer per register write, all in a single message. The codec latches a
+    // word when chip select goes high, so chip select toggles between the transfers.
+    for (i = 0; i < AD1939_INIT_WORDS; i++)
+    {
+        codec->xfers[i].tx_buf = codec->tx + i * AD1939_WORD_LEN;
+        codec->xfers[i].len = AD1939_WORD_LEN;
+        codec->xfers[i].cs_change = i < AD1939_INIT_WORDS - 1;
+    }
+    spi_message_init_with_transfers(&codec->msg, codec->xfers, AD1939_INIT_WORDS);
+    codec->msg.complete = ad1939_init_complete;
+    codec->msg.context = codec;
 
-    return ret;
+    // Submit and return; the controller sends the message while the boot carries on
+    codec->start = ktime_get();
+    ret = spi_async(spidev, &codec->msg);
+    if (ret)
+        return dev_err_probe(&spidev->dev, ret, "Failed to submit the init sequence\n");
+
+    return 0;
 }
 
 static void ad1939_audiomini_remove(struct spi_device *spidev)
 {
-    // NOTE: spidev currently doesn't have any device driver data, but if it
-    // eventually does, we should clear the data.
-    // spi_set_drvdata(spidev, NULL);
+    struct ad1939_audiomini *codec = spi_get_drvdata(spidev);
+
+    // The init message and its buffer are devm memory; don't free them under the controller
+    wait_for_completion(&codec->done);
+    cancel_delayed_work_sync(&codec->init_work);
 }
 
 /** Id matching structure for use in driver/device matching */
@@ -82,6 +583,9 @@ static struct spi_driver ad1939_audiomini_driver = {
     .driver.name = "ad1939 audiomini",
     .driver.owner = THIS_MODULE,
     .driver.of_match_table = of_match_ptr(al_ad1939_dt_ids),
+    .driver.probe_type = PROBE_PREFER_ASYNCHRONOUS,
+    .driver.dev_groups = ad1939_groups,
+    .driver.pm = &ad1939_pm_ops,
 };
 
 // We don't need to do anything special in init or exit,
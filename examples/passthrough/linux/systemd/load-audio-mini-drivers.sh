@@ -1,5 +1,8 @@
+# The drivers don't depend on each other and probe asynchronously, so load them in parallel
 echo "Loading ad1939" 
-insmod /lib/modules/ad1939.ko
+insmod /lib/modules/ad1939.ko &
 
 echo "Loading tpa613a2" 
-insmod /lib/modules/tpa613a2.ko
+insmod /lib/modules/tpa613a2.ko &
+
+wait
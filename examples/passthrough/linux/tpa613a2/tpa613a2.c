@@ -5,7 +5,6 @@
 */
 
 #include <linux/module.h>
-#include <linux/platform_device.h>
 #include <linux/io.h>
 #include <linux/fs.h>
 #include <linux/types.h>
@@ -15,6 +14,18 @@
 #include <linux/regmap.h>
 #include <linux/i2c.h>
 #include <linux/version.h>
+#include <linux/spinlock.h>
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/sysfs.h>
+#include <linux/slab.h>
+#include <linux/kref.h>
+
+#include "tpa613a2.h"           // TPA6130A2 registers and the /dev ioctls
+#include "tpa613a2_volume.h"    // Volume code <-> millibel <-> dB conversions
 
 
 // Define information about this kernel module
@@ -23,112 +34,49 @@ MODULE_AUTHOR("Tyler Davis");
 MODULE_DESCRIPTION("Loadable kernel module for the tpa613a2");
 MODULE_VERSION("1.0");
 
-// Index of the first negative value in the look up table below
-#define PN_INDEX 54
+static_assert(TPA_VOLUME_NUM_CODES == TPA6130A2_VOLUME_MASK + 1, "one table entry per volume code");
+
+#define TPA6130A2_CHANNELS_MASK     0xC0    ///< Left and right bits, the same in the control and volume registers
+
+/** Most volume codes per second a ramp sends over I2C */
+static unsigned int ramp_rate_hz = 200;
+module_param(ramp_rate_hz, uint, 0644);
+MODULE_PARM_DESC(ramp_rate_hz, "Most volume changes per second during a ramp (default 200)");
 
-struct fixed_num
+/** Shape of a volume ramp, in dB over time */
+enum tpa_ramp_curve
 {
-    int integer;
-    int fraction;
-    int fraction_len;
+    TPA_RAMP_LINEAR,    ///< Constant dB per second
+    TPA_RAMP_SMOOTH,    ///< Smoothstep: eases in and out of the fade
 };
 
-// Volume levels defined in Raymond Weber's userspace code (multiplied by ten to elimiate the
-// decimal and with the negative values multiplied by negative one)
-/** Typedef for a single volume level to hold the db volume level and the matching register value */
-typedef struct
+/** State of the volume ramp, as read from the ramp attribute */
+enum tpa_ramp_state
 {
-    uint16_t value;
-    uint8_t code;
-} volumeLevel;
-
-/** Structure with all possible volume level codes to use in TPA6130_register0.volume 
-    See the TPA6130A2 datasheet, pg 17 Table 2 in section 8.4.9 Volume Control.
-    The value comes from column 2 in the table.  These volume levels are the absolute 
-    value of the table values multipled by 10  The code field is the register control word*/
-static volumeLevel VolumeLevels[] =
-{
-    {.value = 1000,  .code = 0xFF},
-    {.value = 595, .code = 0x00},
-    {.value = 535, .code = 0x01},
-    {.value = 500, .code = 0x02},
-    {.value = 475, .code = 0x03},
-    {.value = 455, .code = 0x04},
-    {.value = 439, .code = 0x05},
-    {.value = 414, .code = 0x06},
-    {.value = 395, .code = 0x07},
-    {.value = 365, .code = 0x08},
-    {.value = 353, .code = 0x09},
-    {.value = 333, .code = 0x0A},
-    {.value = 317, .code = 0x0B},
-    {.value = 304, .code = 0x0C},
-    {.value = 286, .code = 0x0D},
-    {.value = 271, .code = 0x0E},
-    {.value = 263, .code = 0x0F},
-    {.value = 247, .code = 0x10},
-    {.value = 237, .code = 0x11},
-    {.value = 225, .code = 0x12},
-    {.value = 217, .code = 0x13},
-    {.value = 205, .code = 0x14},
-    {.value = 196, .code = 0x15},
-    {.value = 188, .code = 0x16},
-    {.value = 178, .code = 0x17},
-    {.value = 170, .code = 0x18},
-    {.value = 162, .code = 0x19},
-    {.value = 152, .code = 0x1A},
-    {.value = 145, .code = 0x1B},
-    {.value = 137, .code = 0x1C},
-    {.value = 130, .code = 0x1D},
-    {.value = 123, .code = 0x1E},
-    {.value = 116, .code = 0x1F},
-    {.value = 109, .code = 0x20},
-    {.value = 103, .code = 0x21},
-    {.value = 97,  .code = 0x22},
-    {.value = 90,  .code = 0x23},
-    {.value = 85,  .code = 0x24},
-    {.value = 78,  .code = 0x25},
-    {.value = 72,  .code = 0x26},
-    {.value = 67,  .code = 0x27},
-    {.value = 61,  .code = 0x28},
-    {.value = 56,  .code = 0x29},
-    {.value = 51,  .code = 0x2A},
-    {.value = 45,  .code = 0x2B},
-    {.value = 41,  .code = 0x2C},
-    {.value = 35,  .code = 0x2D},
-    {.value = 31,  .code = 0x1E},
-    {.value = 26,  .code = 0x1F},
-    {.value = 21,  .code = 0x30},
-    {.value = 17,  .code = 0x31},
-    {.value = 12,  .code = 0x32},
-    {.value = 8,   .code = 0x33},
-    {.value = 3,   .code = 0x34},
-    {.value = 1,   .code = 0x35},
-    {.value = 5,   .code = 0x36},
-    {.value = 9,   .code = 0x37},
-    {.value = 14,  .code = 0x38},
-    {.value = 17,  .code = 0x39},
-    {.value = 21,  .code = 0x3A},
-    {.value = 25,  .code = 0x3B},
-    {.value = 29,  .code = 0x3C},
-    {.value = 33,  .code = 0x3D},
-    {.value = 36,  .code = 0x3E},
-    {.value = 40,  .code = 0x3F}
+    TPA_RAMP_IDLE,
+    TPA_RAMP_RUNNING,
+    TPA_RAMP_DONE,
+    TPA_RAMP_CANCELLED,
 };
 
+static const char * const tpa_ramp_state_names[] = { "idle", "running", "done", "cancelled" };
+
+/** Channel sets of the enable, mute and channels attributes, indexed by (left << 1 | right) */
+static const char * const tpa_channel_names[] = { "none", "right", "left", "both" };
+
 static struct class *cl; // Global variable for the device class
 static dev_t dev_num;
 
-// Define some I2C stuff
-struct i2c_driver tpa_i2c_driver;
-struct i2c_client *tpa_i2c_client;
-static const unsigned short normal_i2c[]=
-  { 0x35, I2C_CLIENT_END }; // remove?
-
 // Function Prototypes
-static int tpa613a2_probe(struct platform_device *pdev);
-static void tpa613a2_remove(struct platform_device *pdev);
-static ssize_t tpa613a2_read(struct file *file, char *buffer, size_t len, loff_t *offset);
-static ssize_t tpa613a2_write(struct file *file, const char *buffer, size_t len, loff_t *offset);
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6,3,0)
+static int tpa613a2_probe(struct i2c_client *client, const struct i2c_device_id *id);
+#else
+static int tpa613a2_probe(struct i2c_client *client);
+#endif
+static void tpa613a2_remove(struct i2c_client *client);
+static ssize_t tpa613a2_read(struct file *file, char __user *buffer, size_t len, loff_t *offset);
+static ssize_t tpa613a2_write(struct file *file, const char __user *buffer, size_t len, loff_t *offset);
+static long tpa613a2_ioctl(struct file *file, unsigned int cmd, unsigned long arg);
 static int tpa613a2_open(struct inode *inode, struct file *file);
 static int tpa613a2_release(struct inode *inode, struct file *file);
 static ssize_t name_show(struct device *dev, struct device_attribute *attr, char *buf);
@@ -136,16 +84,33 @@ static ssize_t name_show(struct device *dev, struct device_attribute *attr, char
 // I2C operation prototypes
 static ssize_t volume_write(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
 static ssize_t volume_read(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t volume_submitted_read(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t volume_coalesced_read(struct device *dev, struct device_attribute *attr, char *buf);
+static void volume_work_func(struct work_struct *work);
+static ssize_t volume_mb_read(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t volume_mb_write(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t mute_read(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t mute_write(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t enable_read(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t enable_write(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t channels_read(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t channels_write(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t ramp_read(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t ramp_write(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static enum hrtimer_restart ramp_timer_func(struct hrtimer *timer);
 
 // Custom function declarations
 char *strcat2(char *dst, char *src);
-uint32_t set_fixed_num(const char *s);
-int fp_to_string(char *buf, uint32_t fp28_num);
-uint8_t find_volume_level(uint32_t fp28_num, uint8_t pn);
-uint32_t decode_volume(uint8_t code);
 
 //Create the attributes that show up in /sys/class
 static DEVICE_ATTR(volume,          0664, volume_read,          volume_write);
+static DEVICE_ATTR(volume_mb,        0664, volume_mb_read,        volume_mb_write);
+static DEVICE_ATTR(volume_submitted, 0444, volume_submitted_read, NULL);
+static DEVICE_ATTR(volume_coalesced, 0444, volume_coalesced_read, NULL);
+static DEVICE_ATTR(ramp,             0664, ramp_read,             ramp_write);
+static DEVICE_ATTR(mute,             0664, mute_read,             mute_write);
+static DEVICE_ATTR(enable,           0664, enable_read,           enable_write);
+static DEVICE_ATTR(channels,         0664, channels_read,         channels_write);
 
 static DEVICE_ATTR(name, 0444, name_show, NULL);
 
@@ -156,15 +121,42 @@ static DEVICE_ATTR(name, 0444, name_show, NULL);
 struct al_tpa613a2_dev
 {
     struct cdev cdev;           ///< The driver structure containing major/minor, etc
+    struct device *device;      ///< The class device holding the sysfs entries
     char *name;                 ///< This gets the name of the device when loading the driver
-    void __iomem *regs;         ///< Pointer to the registers on the device
-    uint32_t volume;
+    struct regmap *regmap;      ///< Cached register map of the amplifier
+    struct mutex reg_lock;      ///< Serializes register writes that read the cache first
+    struct kref ref;            ///< Open files hold a reference, so the struct outlives an unbind
+    bool removed;               ///< Set by remove(); the regmap is gone and the file operations fail. Protected by reg_lock
+
+    struct work_struct volume_work; ///< Sends the newest volume code over I2C
+    spinlock_t volume_lock;         ///< Protects the fields below
+    uint8_t volume_code;            ///< Newest volume code, not yet sent
+    bool volume_pending;            ///< volume_code is waiting for volume_work
+    unsigned long volume_submitted; ///< Volume writes through sysfs
+    unsigned long volume_coalesced; ///< Writes replaced by a newer one before being sent
+
+    uint8_t volume_sent;            ///< Last volume code sent, without channel_mute; protected by reg_lock
+    uint8_t channel_mute;           ///< TPA6130A2_MUTE_L/R set through mute, channels or /dev; protected by reg_lock
+
+    struct hrtimer ramp_timer;      ///< Steps the volume during a ramp
+    struct kernfs_node *ramp_kn;    ///< The ramp attribute, for poll() notifications
+    enum tpa_ramp_state ramp_state; ///< The ramp fields are also protected by volume_lock
+    enum tpa_ramp_curve ramp_curve;
+    ktime_t ramp_start;             ///< When the ramp started
+    u64 ramp_duration_ns;
+    ktime_t ramp_period;            ///< Time between steps
+    int ramp_from_mb;               ///< Start and target volume in millibel
+    int ramp_to_mb;
+    unsigned int ramp_permille;     ///< Progress of the current or last ramp
+    int ramp_code;                  ///< Last code the ramp submitted, -1 for none yet
 };
 
 
 /** Typedef of the driver structure */
 typedef struct al_tpa613a2_dev al_tpa613a2_dev_t;   //Annoying but makes sonarqube not crash during the analysis in the container_of() lines
 
+static void ramp_stop(al_tpa613a2_dev_t *devp);
+
 /** Id matching structure for use in driver/device matching */
 static struct of_device_id al_tpa613a2_dt_ids[] =
 {
@@ -174,55 +166,100 @@ static struct of_device_id al_tpa613a2_dt_ids[] =
     { }
 };
 
-static struct i2c_device_id tpa_id[] = {
+/** I2C id table, for boards that instantiate the amplifier without a device tree */
+static const struct i2c_device_id tpa_id[] = {
     {
-        "tpa_i2c",0x60
+        "tpa613a2", 0
     },
     {}
 };
 
-// create the board info and set the register for the ADC (0x60)
-static struct i2c_board_info tpa_i2c_info = {
-  I2C_BOARD_INFO("tpa_i2c",0x60),
-};
+/** The control, volume and output impedance registers can be written; all four can be read */
+static bool tpa_writeable_reg(struct device *dev, unsigned int reg)
+{
+  return reg >= TPA6130A2_REG_CONTROL && reg <= TPA6130A2_REG_OUT_IMPEDANCE;
+}
 
-#if LINUX_VERSION_CODE < KERNEL_VERSION(6,3,0)
-static int tpa_i2c_probe(struct i2c_client *client,
-                         const struct i2c_device_id *id)
-#else
-static int tpa_i2c_probe(struct i2c_client *client)
-#endif
+static bool tpa_readable_reg(struct device *dev, unsigned int reg)
 {
-  return 0;
+  return reg >= TPA6130A2_REG_CONTROL && reg <= TPA6130A2_REG_VERSION;
 }
 
-static void tpa_i2c_remove(struct i2c_client *client)
+/** The version register has no power-on default to seed the cache with; always read it from the chip */
+static bool tpa_volatile_reg(struct device *dev, unsigned int reg)
 {
+  return reg == TPA6130A2_REG_VERSION;
 }
 
-struct i2c_driver tpa_i2c_driver = {
-    .driver = { 
-        .name="tpa_i2c",
-      },
-    .probe = tpa_i2c_probe,
-    .remove = tpa_i2c_remove,
-    .id_table = tpa_id,
+/** Power-on values of the writeable registers (both channels off and muted) */
+static const struct reg_default tpa_reg_defaults[] = {
+  { TPA6130A2_REG_CONTROL,       0x00 },
+  { TPA6130A2_REG_VOLUME,        0xC0 },
+  { TPA6130A2_REG_OUT_IMPEDANCE, 0x00 },
 };
 
+/** 8-bit registers with 8-bit addresses, all but the version register cached.
+
+    Reads of the other registers are served from the flat cache without any bus traffic, and
+    regmap_update_bits() skips writes that wouldn't change a register. The
+    only status bit, the thermal flag in the control register, isn't used by
+    this driver; /sys/kernel/debug/regmap shows the cached registers.
+*/
+static const struct regmap_config tpa_regmap_config = {
+  .reg_bits = 8,
+  .val_bits = 8,
+  .max_register = TPA6130A2_REG_VERSION,
+  .writeable_reg = tpa_writeable_reg,
+  .readable_reg = tpa_readable_reg,
+  .volatile_reg = tpa_volatile_reg,
+  .reg_defaults = tpa_reg_defaults,
+  .num_reg_defaults = ARRAY_SIZE(tpa_reg_defaults),
+  .cache_type = REGCACHE_FLAT,
+};
+
+/** The amplifier may lose power while suspended; stop touching it and mark the cache dirty */
+static int __maybe_unused tpa_i2c_suspend(struct device *dev)
+{
+  al_tpa613a2_dev_t *devp = (al_tpa613a2_dev_t *)dev_get_drvdata(dev);
+
+  regcache_cache_only(devp->regmap, true);
+  regcache_mark_dirty(devp->regmap);
+  return 0;
+}
+
+/** Write the cached (non-default) register values back to the amplifier */
+static int __maybe_unused tpa_i2c_resume(struct device *dev)
+{
+  al_tpa613a2_dev_t *devp = (al_tpa613a2_dev_t *)dev_get_drvdata(dev);
+
+  regcache_cache_only(devp->regmap, false);
+  return regcache_sync(devp->regmap);
+}
+
+static SIMPLE_DEV_PM_OPS(tpa_i2c_pm_ops, tpa_i2c_suspend, tpa_i2c_resume);
 
 /** Notify the kernel about the driver matching structure information */
 MODULE_DEVICE_TABLE(of, al_tpa613a2_dt_ids);
 
-// Data structure with pointers to the externally important functions to be able to load the module
-static struct platform_driver tpa613a2_platform =
+MODULE_DEVICE_TABLE(i2c, tpa_id);
+
+/** The amplifier is an I2C device matched from the device tree (see deviceTree/).
+
+    Probing is asynchronous: the I2C register writes in tpa613a2_probe() don't hold
+    up the rest of the boot or the other audio drivers, and a probe that has to wait
+    for the I2C adapter is deferred and retried by the driver core.
+*/
+static struct i2c_driver tpa613a2_driver =
 {
-      .probe = tpa613a2_probe,
-      .remove_new = tpa613a2_remove,
-      .driver = {
-      .name = "Audio Logic tpa613a2 Driver",
-      .owner = THIS_MODULE,
-      .of_match_table = al_tpa613a2_dt_ids
-    }
+    .probe = tpa613a2_probe,
+    .remove = tpa613a2_remove,
+    .id_table = tpa_id,
+    .driver = {
+        .name = "tpa613a2",
+        .of_match_table = al_tpa613a2_dt_ids,
+        .pm = &tpa_i2c_pm_ops,
+        .probe_type = PROBE_PREFER_ASYNCHRONOUS,
+    },
 };
 
 /** Structure containing pointers to the functions the driver can load */
@@ -231,125 +268,110 @@ static const struct file_operations al_tpa613a2_fops =
     .owner = THIS_MODULE,
     .read = tpa613a2_read,               ///< Read the device contents for the entry in /dev
     .write = tpa613a2_write,             ///< Write the device contents for the entry in /dev
+    .llseek = default_llseek,            ///< The file offset is the register address
+    .unlocked_ioctl = tpa613a2_ioctl,    ///< Multi-register writes, see tpa613a2.h
+    .compat_ioctl = compat_ptr_ioctl,    ///< The ioctl argument is a pointer to a fixed-size struct
     .open = tpa613a2_open,               ///< Called when the device is opened
     .release = tpa613a2_release,         ///< Called when the device is closes
 };
 
+/** Free the device structure once the last reference is gone
 
-
-/** Function called initially on the driver loads
-
-    This function is called by the kernel when the driver module is loaded and currently just calls tpa613a2_probe()
-
-    @returns SUCCESS
+    @param ref The device's reference count
 */
-static int tpa613a2_init(void)
+static void tpa613a2_free(struct kref *ref)
 {
-    int ret_val = 0;
-    char cmd[2];
-    struct i2c_adapter *i2c_adapt;
-    struct i2c_board_info i2c_info;
-    
-    pr_info("Initializing the Audio Logic tpa613a2 module\n");
-
-    // Register our driver with the "Platform Driver" bus
-    ret_val = platform_driver_register(&tpa613a2_platform);
-    if (ret_val != 0)
-    {
-        pr_err("platform_driver_register returned %d\n", ret_val);
-        return ret_val;
-    }
-    
-    /*------------------------------------------------------------------
-      I2C communication
-    ------------------------------------------------------------------*/
-    
-    // Register the device
-    ret_val = i2c_add_driver(&tpa_i2c_driver);
-    if (ret_val < 0)
-    {
-      pr_err("Failed to register I2C driver");
-      return ret_val;
-    }
-    
-    i2c_adapt = i2c_get_adapter(0);
-    memset(&i2c_info,0,sizeof(struct i2c_board_info));    
-    strlcpy(i2c_info.type, "tpa_i2c",I2C_NAME_SIZE);
-    
-    tpa_i2c_client = i2c_new_client_device(i2c_adapt,&tpa_i2c_info);
-    
-    i2c_put_adapter(i2c_adapt);
-
-    if (!tpa_i2c_client)
-    {
-      pr_err("Failed to connect to I2C client\n");
-      ret_val = -ENODEV;
-      return ret_val;
-    }
-
-    //Send some initialization commands
+    kfree(container_of(ref, al_tpa613a2_dev_t, ref));
+}
 
-    // Enable both channels
-    cmd[0] = 0x01;
-    cmd[1] = 0xc0;
-    i2c_master_send(tpa_i2c_client,&cmd[0],2);
+/** Drop a reference to the device structure
 
-    // Set -.3dB gain on both channels (closest value to unity)
-    cmd[0] = 0x02;
-    cmd[1] = 0x34;
-    i2c_master_send(tpa_i2c_client,&cmd[0],2);
+    @param devp The device
+*/
+static void tpa613a2_put(al_tpa613a2_dev_t *devp)
+{
+    kref_put(&devp->ref, tpa613a2_free);
+}
 
-    /*------------------------------------------------------------------
-    --------------------------------------------------------------------
-    ------------------------------------------------------------------*/
-    
-    pr_info("Audio Logic TPA6130A2 module successfully initialized!\n");
+/** devm action dropping probe's reference at unbind
 
-    return 0;
+    @param data The device
+*/
+static void tpa613a2_put_action(void *data)
+{
+    tpa613a2_put(data);
 }
 
 
 
-/** Kernel module loading for platform devices
+/** Bind to the amplifier
 
-    Called by the kernel when a module is loaded which matches a device tree overlay entry.
-    This function does all the setup of the device driver and creates the sysfs entries.
+    Called by the I2C core for the amplifier node in the device tree. This sets up the register map,
+    enables both channels at unity gain, then creates the character device and the sysfs entries.
 
-    @param pdev Pointer to a platform_device structure containing information from the overlay about the device to load
+    @param client The amplifier on the I2C bus
     @returns SUCCESS or error code
 */
-static int tpa613a2_probe(struct platform_device *pdev)
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6,3,0)
+static int tpa613a2_probe(struct i2c_client *client, const struct i2c_device_id *id)
+#else
+static int tpa613a2_probe(struct i2c_client *client)
+#endif
 {
-    int ret_val = -EBUSY;
+    static const u8 init_regs[] = { TPA6130A2_HP_EN_L | TPA6130A2_HP_EN_R, TPA_VOLUME_CODE_DEFAULT };
+    int ret_val;
 
     char deviceName[20] = "al_TPA6130A2_";
     char deviceMinor[20];
-    int status;
 
     struct device *deviceObj;
     al_tpa613a2_dev_t *al_tpa613a2_devp;
 
     pr_info("tpa613a2_probe enter\n");
 
-    // Create structure to hold device-specific information (like the registers). Make size of &pdev->dev + sizeof(struct(al_tpa613a2_dev)).
-    al_tpa613a2_devp = devm_kzalloc(&pdev->dev, sizeof(al_tpa613a2_dev_t), GFP_KERNEL);
+    // Create structure to hold device-specific information (like the registers). Probe's reference is
+    // dropped at unbind, but open files can keep the structure around for longer.
+    al_tpa613a2_devp = kzalloc(sizeof(al_tpa613a2_dev_t), GFP_KERNEL);
+    if (al_tpa613a2_devp == NULL)
+        return -ENOMEM;
+    kref_init(&al_tpa613a2_devp->ref);
+    ret_val = devm_add_action_or_reset(&client->dev, tpa613a2_put_action, al_tpa613a2_devp);
+    if (ret_val)
+        return ret_val;
+
+    mutex_init(&al_tpa613a2_devp->reg_lock);
+    al_tpa613a2_devp->regmap = devm_regmap_init_i2c(client, &tpa_regmap_config);
+    if (IS_ERR(al_tpa613a2_devp->regmap))
+        return dev_err_probe(&client->dev, PTR_ERR(al_tpa613a2_devp->regmap), "Failed to set up the register map\n");
+
+    // Enable both channels and set -.3dB gain (closest value to unity), in one I2C message
+    ret_val = regmap_bulk_write(al_tpa613a2_devp->regmap, TPA6130A2_REG_CONTROL, init_regs, ARRAY_SIZE(init_regs));
+    if (ret_val < 0)
+        return dev_err_probe(&client->dev, ret_val, "Failed to enable the amplifier\n");
+
+    // Volume changes are sent over I2C from a worker, see volume_write()
+    INIT_WORK(&al_tpa613a2_devp->volume_work, volume_work_func);
+    spin_lock_init(&al_tpa613a2_devp->volume_lock);
+    al_tpa613a2_devp->volume_sent = TPA_VOLUME_CODE_DEFAULT;
+    hrtimer_init(&al_tpa613a2_devp->ramp_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+    al_tpa613a2_devp->ramp_timer.function = ramp_timer_func;
 
-    // Give a pointer to the instance-specific data to the generic platform_device structure
-    // so we can access this data later on (for instance, in the read and write functions)
-    platform_set_drvdata(pdev, (void *)al_tpa613a2_devp);
+    // Give a pointer to the instance-specific data to the I2C client
+    // so we can access this data later on (for instance, in remove and the PM callbacks)
+    i2c_set_clientdata(client, al_tpa613a2_devp);
 
     //Create a memory region to store the device name
-    al_tpa613a2_devp->name = devm_kzalloc(&pdev->dev, 50, GFP_KERNEL);
+    al_tpa613a2_devp->name = devm_kzalloc(&client->dev, 50, GFP_KERNEL);
     if (al_tpa613a2_devp->name == NULL)
-        goto bad_mem_alloc;
+        return -ENOMEM;
 
-    //Copy the name from the overlay and stick it in the created memory region
-    strcpy(al_tpa613a2_devp->name, (char *)pdev->name);
-    pr_info("%s\n", (char *)pdev->name);
+    //Copy the name of the I2C client and stick it in the created memory region
+    strscpy(al_tpa613a2_devp->name, client->name, 50);
+    pr_info("%s\n", client->name);
 
     //Request a Major/Minor number for the driver
-    status = alloc_chrdev_region(&dev_num, 0, 1, "al_TPA6130A2_");
-    if (status != 0)
+    ret_val = alloc_chrdev_region(&dev_num, 0, 1, "al_TPA6130A2_");
+    if (ret_val != 0)
         goto bad_alloc_chrdev_region;
 
     //Create the device name with the information reserved above
@@ -363,45 +385,111 @@ static int tpa613a2_probe(struct platform_device *pdev)
 #else
     cl = class_create(deviceName);
 #endif
-    if (cl == NULL)
+    if (IS_ERR(cl))
+    {
+        ret_val = PTR_ERR(cl);
         goto bad_class_create;
+    }
 
     //Initialize a char dev structure
     cdev_init(&al_tpa613a2_devp->cdev, &al_tpa613a2_fops);
 
     //Registers the char driver with the kernel
-    status = cdev_add(&al_tpa613a2_devp->cdev, dev_num, 1);
-    if (status != 0)
+    ret_val = cdev_add(&al_tpa613a2_devp->cdev, dev_num, 1);
+    if (ret_val != 0)
         goto bad_cdev_add;
 
     //Creates the device entries in sysfs
     deviceObj = device_create(cl, NULL, dev_num, NULL, deviceName);
-    if (deviceObj == NULL)
+    if (IS_ERR(deviceObj))
+    {
+        ret_val = PTR_ERR(deviceObj);
         goto bad_device_create;
+    }
+    al_tpa613a2_devp->device = deviceObj;
 
     //Put a pointer to the al_fir_dev struct that is created into the driver object so it can be accessed uniquely from elsewhere
     dev_set_drvdata(deviceObj, al_tpa613a2_devp);
 
     //---------------------------------------------------------
-    status = device_create_file(deviceObj, &dev_attr_volume);
-    if (status)
+    ret_val = device_create_file(deviceObj, &dev_attr_volume);
+    if (ret_val)
         goto bad_device_create_file_1;
 
     //---------------------------------------------------------    
-    status = device_create_file(deviceObj, &dev_attr_name);
-    if (status)
+    ret_val = device_create_file(deviceObj, &dev_attr_name);
+    if (ret_val)
         goto bad_device_create_file_2;
 
+    //---------------------------------------------------------
+    ret_val = device_create_file(deviceObj, &dev_attr_volume_submitted);
+    if (ret_val)
+        goto bad_device_create_file_3;
+
+    //---------------------------------------------------------
+    ret_val = device_create_file(deviceObj, &dev_attr_volume_coalesced);
+    if (ret_val)
+        goto bad_device_create_file_4;
+
+    //---------------------------------------------------------
+    ret_val = device_create_file(deviceObj, &dev_attr_ramp);
+    if (ret_val)
+        goto bad_device_create_file_5;
+
+    //---------------------------------------------------------
+    ret_val = device_create_file(deviceObj, &dev_attr_volume_mb);
+    if (ret_val)
+        goto bad_device_create_file_6;
+
+    //---------------------------------------------------------
+    ret_val = device_create_file(deviceObj, &dev_attr_mute);
+    if (ret_val)
+        goto bad_device_create_file_7;
+
+    //---------------------------------------------------------
+    ret_val = device_create_file(deviceObj, &dev_attr_enable);
+    if (ret_val)
+        goto bad_device_create_file_8;
+
+    //---------------------------------------------------------
+    ret_val = device_create_file(deviceObj, &dev_attr_channels);
+    if (ret_val)
+        goto bad_device_create_file_9;
+
+    // poll() on the ramp attribute wakes up when a ramp ends
+    al_tpa613a2_devp->ramp_kn = sysfs_get_dirent(deviceObj->kobj.sd, "ramp");
+
     pr_info("tpa613a2_probe exit\n");
 
     return 0;
 
-  bad_device_create_file_2:
+  bad_device_create_file_9:
+      device_remove_file(deviceObj, &dev_attr_enable);
+
+  bad_device_create_file_8:
+      device_remove_file(deviceObj, &dev_attr_mute);
+
+  bad_device_create_file_7:
+      device_remove_file(deviceObj, &dev_attr_volume_mb);
+
+  bad_device_create_file_6:
+      device_remove_file(deviceObj, &dev_attr_ramp);
+
+  bad_device_create_file_5:
+      device_remove_file(deviceObj, &dev_attr_volume_coalesced);
+
+  bad_device_create_file_4:
+      device_remove_file(deviceObj, &dev_attr_volume_submitted);
+
+  bad_device_create_file_3:
       device_remove_file(deviceObj, &dev_attr_name);
-          
+
+  bad_device_create_file_2:
+      device_remove_file(deviceObj, &dev_attr_volume);
+
   bad_device_create_file_1:
-      device_remove_file(deviceObj, &dev_attr_volume); 
-      
+      device_destroy(cl, dev_num);
+
   bad_device_create:
       cdev_del(&al_tpa613a2_devp->cdev);
 
@@ -412,7 +500,6 @@ static int tpa613a2_probe(struct platform_device *pdev)
       unregister_chrdev_region(dev_num, 1);
 
   bad_alloc_chrdev_region:
-  bad_mem_alloc:
 
     return ret_val;
 }
@@ -433,11 +520,9 @@ static int tpa613a2_open(struct inode *inode, struct file *file)
 
     //Put it in the container_of structure so it can be used from anywhere
     devp = container_of(inode->i_cdev, al_tpa613a2_dev_t, cdev);
+    kref_get(&devp->ref);
     file->private_data = devp;
 
-    //Instantiate default values for the codec
-    devp->volume       = 0;
-
     return 0;
 }
 
@@ -445,7 +530,7 @@ static int tpa613a2_open(struct inode *inode, struct file *file)
 
 /** Called when the device is closed
 
-    Currently this doesn't do anything, but as it is the opposite of open I created it for future use
+    Drops the reference open took; the device structure goes away with the last one after an unbind.
 
     @param inode Instance of the driver opened
     @param file Pointer to the file for this operation
@@ -453,90 +538,285 @@ static int tpa613a2_open(struct inode *inode, struct file *file)
 */
 static int tpa613a2_release(struct inode *inode, struct file *file)
 {
+    tpa613a2_put(file->private_data);
     return 0;
 }
 
 
 
-/** Read the contents of the coefficients stucture
+/** Write a batch of registers in a single I2C message
 
-    This function will read the contents of the coefficient memory as stored in the shadow register and return then
-    to the calling function as a binary array of 32 length fixed point values.  If done in the terminal window, hexdump
-    can be used to see the values.
+    The writes are applied in order to a copy of the cached registers, and the
+    registers from the lowest to the highest one written then go out as one
+    auto-incrementing bulk write. If the volume register is among them it takes
+    over from any ramp or volume change that hasn't been sent yet.
 
-    @param file Pointer to the file being accessed
-    @param buffer Pointer to a buffer array to return the data on
-    @len Unused
-    @offset Pass-by-reference variable to hold where to start transmitting from in the array.
-    @returns tpa613a2_read Number of bits sent in buffer, and will return 0 for the last transaction.
+    @param devp The device
+    @param writes The register writes
+    @param count Number of entries in writes, at least one
+    @returns 0, -ENODEV after the amplifier was unbound, or another error code
 */
-static ssize_t tpa613a2_read(struct file *file, char *buffer, size_t len, loff_t *offset)
+static int regs_write(al_tpa613a2_dev_t *devp, const struct tpa613a2_reg_write *writes, unsigned int count)
 {
-    return 0;
+    u8 vals[TPA6130A2_REG_OUT_IMPEDANCE + 1];
+    unsigned int first = TPA6130A2_REG_OUT_IMPEDANCE;
+    unsigned int last = TPA6130A2_REG_CONTROL;
+    unsigned int reg;
+    unsigned int val;
+    unsigned long flags;
+    unsigned int i;
+    int ret = 0;
+
+    for (i = 0; i < count; i++)
+    {
+        if (writes[i].reg < TPA6130A2_REG_CONTROL || writes[i].reg > TPA6130A2_REG_OUT_IMPEDANCE)
+            return -EINVAL;
+        first = min_t(unsigned int, first, writes[i].reg);
+        last = max_t(unsigned int, last, writes[i].reg);
+    }
+
+    mutex_lock(&devp->reg_lock);
+
+    if (devp->removed)
+    {
+        ret = -ENODEV;
+        goto out;
+    }
+
+    // The ramp timer never takes reg_lock, so stopping it here can't deadlock
+    if (first <= TPA6130A2_REG_VOLUME && last >= TPA6130A2_REG_VOLUME)
+        ramp_stop(devp);
+
+    // Registers in between that aren't written are sent again with their cached value
+    for (reg = first; reg <= last; reg++)
+    {
+        ret = regmap_read(devp->regmap, reg, &val);
+        if (ret < 0)
+            goto out;
+        vals[reg] = val;
+    }
+    for (i = 0; i < count; i++)
+        vals[writes[i].reg] = writes[i].value;
+
+    if (first <= TPA6130A2_REG_VOLUME && last >= TPA6130A2_REG_VOLUME)
+    {
+        spin_lock_irqsave(&devp->volume_lock, flags);
+        devp->volume_pending = false;
+        spin_unlock_irqrestore(&devp->volume_lock, flags);
+    }
+
+    ret = regmap_bulk_write(devp->regmap, first, &vals[first], last - first + 1);
+
+    // Split the volume register the way the sysfs attributes see it
+    if (ret == 0 && first <= TPA6130A2_REG_VOLUME && last >= TPA6130A2_REG_VOLUME)
+    {
+        val = vals[TPA6130A2_REG_VOLUME];
+        if (devp->volume_sent != TPA_VOLUME_CODE_MUTE && (val & TPA6130A2_VOLUME_MASK) == devp->volume_sent)
+        {
+            // Only the mute bits changed; they belong to the channels
+            devp->channel_mute = val & TPA6130A2_CHANNELS_MASK;
+        }
+        else if (val == TPA_VOLUME_CODE_MUTE)
+        {
+            // The mute code, as the volume attribute writes it; the channel mutes stay
+            devp->volume_sent = TPA_VOLUME_CODE_MUTE;
+        }
+        else
+        {
+            // Mute bits written here belong to the channels; the rest is the volume code
+            devp->channel_mute = val & TPA6130A2_CHANNELS_MASK;
+            devp->volume_sent = val & TPA6130A2_VOLUME_MASK;
+        }
+    }
+
+  out:
+    mutex_unlock(&devp->reg_lock);
+    return ret;
 }
 
+/** Read amplifier registers
 
+    The file offset is the register address, and each byte read is one register
+    (TPA6130A2_REG_CONTROL..TPA6130A2_REG_VERSION). The values come from the
+    register cache, so reading doesn't use the I2C bus, except for the version
+    register, which is read from the amplifier.
 
-/** Write the contents of the coefficients stucture
+    @param file Pointer to the file being accessed
+    @param buffer User buffer for the register values
+    @param len Number of registers to read
+    @param offset First register to read; advanced past the registers read
+    @returns Number of registers read, 0 past the last register, or an error code
+*/
+static ssize_t tpa613a2_read(struct file *file, char __user *buffer, size_t len, loff_t *offset)
+{
+    al_tpa613a2_dev_t *devp = file->private_data;
+    u8 vals[TPA6130A2_REG_VERSION + 1];
+    loff_t reg = *offset;
+    int ret;
+
+    if (reg < TPA6130A2_REG_CONTROL)
+        return -EINVAL;
+    if (reg > TPA6130A2_REG_VERSION || len == 0)
+        return 0;
+
+    len = min_t(size_t, len, TPA6130A2_REG_VERSION + 1 - reg);
+
+    // The regmap goes away at unbind; reg_lock keeps remove() from getting there while we use it
+    mutex_lock(&devp->reg_lock);
+    ret = devp->removed ? -ENODEV : regmap_bulk_read(devp->regmap, reg, vals, len);
+    mutex_unlock(&devp->reg_lock);
+    if (ret < 0)
+        return ret;
+
+    if (copy_to_user(buffer, vals, len))
+        return -EFAULT;
+
+    *offset += len;
+    return len;
+}
+
+/** Write amplifier registers
 
-    This function will write the contents of the buffer as binary values to the coefficients register.
-    The length variable is used to set the length of the filter itself.  After updating the shadow register,
-    the values are then written to the device.  If the size of buffer is not a 4 bit multiple, the extra bytes
-    are ignored.
+    The file offset is the register address, and each byte written is one register
+    (TPA6130A2_REG_CONTROL..TPA6130A2_REG_OUT_IMPEDANCE). All of them go to the
+    amplifier in a single I2C message; a write past the last writeable register is
+    cut short.
 
     @param file Pointer to the file being written to
-    @param buffer Pointer to a buffer array containing the data to write
-    @len Number of bytes in the buffer variable
-    @offset Pass-by-reference variable to hold where to start transmitting from in the array.
-    @returns tpa613a2_read Number of bytes written
+    @param buffer User buffer with the register values
+    @param len Number of registers to write
+    @param offset First register to write; advanced past the registers written
+    @returns Number of registers written or an error code
 */
-static ssize_t tpa613a2_write(struct file *file, const char *buffer, size_t len, loff_t *offset)
+static ssize_t tpa613a2_write(struct file *file, const char __user *buffer, size_t len, loff_t *offset)
 {
-    return 0;
+    al_tpa613a2_dev_t *devp = file->private_data;
+    struct tpa613a2_reg_write writes[TPA6130A2_REG_OUT_IMPEDANCE];
+    u8 vals[TPA6130A2_REG_OUT_IMPEDANCE];
+    loff_t reg = *offset;
+    size_t i;
+    int ret;
+
+    if (reg < TPA6130A2_REG_CONTROL || reg > TPA6130A2_REG_OUT_IMPEDANCE)
+        return -EINVAL;
+    if (len == 0)
+        return 0;
+
+    len = min_t(size_t, len, TPA6130A2_REG_OUT_IMPEDANCE + 1 - reg);
+
+    if (copy_from_user(vals, buffer, len))
+        return -EFAULT;
+
+    for (i = 0; i < len; i++)
+    {
+        writes[i].reg = reg + i;
+        writes[i].value = vals[i];
+    }
+
+    ret = regs_write(devp, writes, len);
+    if (ret < 0)
+        return ret;
+
+    *offset += len;
+    return len;
+}
+
+/** Handle TPA613A2_IOC_MULTI_WRITE: write a set of registers in one I2C message
+
+    @param devp The device
+    @param arg User pointer to a struct tpa613a2_multi_write
+    @returns 0 or an error code
+*/
+static int tpa613a2_multi_write(al_tpa613a2_dev_t *devp, void __user *arg)
+{
+    struct tpa613a2_reg_write writes[TPA613A2_MAX_WRITES];
+    struct tpa613a2_multi_write mw;
+
+    if (copy_from_user(&mw, arg, sizeof(mw)))
+        return -EFAULT;
+
+    if (mw.reserved || mw.count == 0 || mw.count > TPA613A2_MAX_WRITES)
+        return -EINVAL;
+
+    if (copy_from_user(writes, u64_to_user_ptr(mw.writes), mw.count * sizeof(writes[0])))
+        return -EFAULT;
+
+    return regs_write(devp, writes, mw.count);
 }
 
+/** ioctl handler of the character device
 
+    @param file Pointer to the file
+    @param cmd The ioctl command, see tpa613a2.h
+    @param arg The ioctl argument
+    @returns 0 or an error code
+*/
+static long tpa613a2_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+    al_tpa613a2_dev_t *devp = file->private_data;
+
+    switch (cmd)
+    {
+    case TPA613A2_IOC_MULTI_WRITE:
+        return tpa613a2_multi_write(devp, (void __user *)arg);
+    default:
+        return -ENOTTY;
+    }
+}
 
-/** Function called when the platform device driver is deleted
+
+
+/** Function called when the amplifier is unbound or the module is removed
 
     This function is called when the device driver is deleted.  It should cleans up the driver memory structures,
     deallocate the driver addresses reserved for the driver, unallocate memory and the io mapping functions to the
     hardware.  After this function, the device should be able to be added cleanly again without contention or memory
     leaks.
 
-    @param platform_device Pointer to the device structure being deleted
-    @returns SUCCESS
+    @param client The amplifier on the I2C bus
 */
-static void tpa613a2_remove(struct platform_device *pdev)
+static void tpa613a2_remove(struct i2c_client *client)
 {
-    // Grab the instance-specific information out of the platform device
-    al_tpa613a2_dev_t *dev = (al_tpa613a2_dev_t *)platform_get_drvdata(pdev);
+    // Grab the instance-specific information out of the I2C client
+    al_tpa613a2_dev_t *dev = (al_tpa613a2_dev_t *)i2c_get_clientdata(client);
 
     pr_info("tpa613a2_remove enter\n");
 
+    // Files that are still open keep the structure alive, but their reads and writes fail from here on
+    mutex_lock(&dev->reg_lock);
+    dev->removed = true;
+    mutex_unlock(&dev->reg_lock);
+
+    // Remove the sysfs entries first, so nothing can start a ramp or queue a volume change below
+    device_remove_file(dev->device, &dev_attr_channels);
+    device_remove_file(dev->device, &dev_attr_enable);
+    device_remove_file(dev->device, &dev_attr_mute);
+    device_remove_file(dev->device, &dev_attr_volume_mb);
+    device_remove_file(dev->device, &dev_attr_ramp);
+    device_remove_file(dev->device, &dev_attr_volume_coalesced);
+    device_remove_file(dev->device, &dev_attr_volume_submitted);
+    device_remove_file(dev->device, &dev_attr_name);
+    device_remove_file(dev->device, &dev_attr_volume);
+    device_destroy(cl, dev_num);
+
     // Unregister the character file (remove it from /dev)
     cdev_del(&dev->cdev);
+    class_destroy(cl);
+
+    // Stop any ramp, then let the last volume change reach the amplifier
+    hrtimer_cancel(&dev->ramp_timer);
+    flush_work(&dev->volume_work);
+    if (dev->ramp_kn)
+        sysfs_put(dev->ramp_kn);
 
     //Tell the os that the major/minor pair is avalible again
-    unregister_chrdev_region(dev_num, 2);
+    unregister_chrdev_region(dev_num, 1);
 
     pr_info("tpa613a2_remove exit\n");
 }
 
 
 
-// Called when the driver is removed
-static void tpa613a2_exit(void)
-{
-    pr_info("Audio Logic tpa613a2 module exit\n");
-
-    // Unregister our driver from the "Platform Driver" bus
-    // This will cause "tpa613a2_remove" to be called for each connected device
-    platform_driver_unregister(&tpa613a2_platform);
- 
-    pr_info("Audio Logic TPA6130A2 module successfully unregistered\n");
-}
-
 /** Function to display the overlay name for the device in sysfs
 
     @todo Better understand the inputs
@@ -557,71 +837,308 @@ static ssize_t name_show(struct device *dev, struct device_attribute *attr, char
     return strlen(buf);
 }
 
-static ssize_t volume_write(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+/** Hand a volume code to the worker instead of blocking on the I2C bus
+
+    Only the newest code matters, so a code that hasn't been sent yet is simply
+    replaced (e.g. while a slider is being dragged or a ramp is running). The
+    caller holds volume_lock and schedules volume_work afterwards.
+
+    @param devp The device
+    @param code The new volume code
+*/
+static void volume_submit_locked(al_tpa613a2_dev_t *devp, uint8_t code)
 {
-    // Initialize some variables
-    uint32_t tempValue = 0;
-    char substring[80];
-    int substring_count = 0;
-    int i;
-    char cmd[2] = {0x02,0x00};
-    uint8_t code = 0x00;
+    devp->volume_submitted++;
+    if (devp->volume_pending)
+        devp->volume_coalesced++;
+    devp->volume_code = code;
+    devp->volume_pending = true;
+}
 
-    // Create a new instance of the TPA
-    al_tpa613a2_dev_t *devp = (al_tpa613a2_dev_t *)dev_get_drvdata(dev);
+/** Current volume code, not counting channel mutes: the one waiting for the worker, or else the last one sent */
+static int volume_current_code(al_tpa613a2_dev_t *devp, unsigned int *code)
+{
+    unsigned long flags;
+    bool pending;
 
-    for (i = 0; i < count; i++)
+    spin_lock_irqsave(&devp->volume_lock, flags);
+    pending = devp->volume_pending;
+    *code = devp->volume_code;
+    spin_unlock_irqrestore(&devp->volume_lock, flags);
+
+    if (!pending)
     {
-        //If its not a space or a comma, add the digit to the substring
-        if ((buf[i] != ',') && (buf[i] != ' ') && (buf[i] != '\0') && (buf[i] != '\r') && (buf[i] != '\n'))
-        {
-            substring[substring_count] = buf[i];
-            substring_count++;
-        }
+        mutex_lock(&devp->reg_lock);
+        *code = devp->volume_sent;
+        mutex_unlock(&devp->reg_lock);
     }
 
-    substring[substring_count] = '\0';
-    
-    // If the first character is a negative sign
-    if (buf[0] == '-')
+    return 0;
+}
+
+/** Position of a volume register value on the way from mute (-1) to the loudest code */
+static int volume_code_step(unsigned int code)
+{
+    return code == TPA_VOLUME_CODE_MUTE ? -1 : (int)(code & TPA6130A2_VOLUME_MASK);
+}
+
+/** Stop a running ramp and tell poll()ers
+
+    @param devp The device
+*/
+static void ramp_stop(al_tpa613a2_dev_t *devp)
+{
+    unsigned long flags;
+    bool stopped = false;
+
+    // Can't hold volume_lock here: the timer function takes it
+    hrtimer_cancel(&devp->ramp_timer);
+
+    spin_lock_irqsave(&devp->volume_lock, flags);
+    if (devp->ramp_state == TPA_RAMP_RUNNING)
     {
-      // Shift all the values "left" to remove it
-      for (i=0;i<79;i++)
-        substring[i] = substring[i+1];
+        devp->ramp_state = TPA_RAMP_CANCELLED;
+        stopped = true;
+    }
+    spin_unlock_irqrestore(&devp->volume_lock, flags);
+
+    if (stopped && devp->ramp_kn)
+        sysfs_notify_dirent(devp->ramp_kn);
+}
+
+/** Set a new volume code, overriding any ramp
+
+    @param devp The device
+    @param code The volume register value
+*/
+static void volume_set_code(al_tpa613a2_dev_t *devp, unsigned int code)
+{
+    unsigned long flags;
+
+    ramp_stop(devp);
+
+    spin_lock_irqsave(&devp->volume_lock, flags);
+    volume_submit_locked(devp, code);
+    spin_unlock_irqrestore(&devp->volume_lock, flags);
+
+    schedule_work(&devp->volume_work);
+}
+
+/** Set the volume in dB, e.g. "-12.5"; the nearest volume code is used */
+static ssize_t volume_write(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    al_tpa613a2_dev_t *devp = (al_tpa613a2_dev_t *)dev_get_drvdata(dev);
+    uint32_t raw;
+
+    if (fixed_tpa_volume_parse(buf, count, &raw))
+        return -EINVAL;
+
+    volume_set_code(devp, volume_mb_to_code(volume_fixed_to_mb(raw)));
+
+    return count;
+}
+
+/** Send the newest volume code to the amplifier
 
-      // Find the fp28 number
-      tempValue = set_fixed_num(substring);
+    Runs from the system workqueue after volume_write(). Codes written while this is
+    waiting to run are coalesced into the newest one; codes written while it is
+    sending queue it again.
 
-      // Determine the code for the volume level
-      code = find_volume_level(tempValue,0);
+    @param work The volume_work of the device
+*/
+static void volume_work_func(struct work_struct *work)
+{
+    al_tpa613a2_dev_t *devp = container_of(work, al_tpa613a2_dev_t, volume_work);
+    unsigned long flags;
+    uint8_t code;
+    bool pending;
+    int ret;
+
+    // Taken first so a register write through /dev can't be undone by an older code
+    mutex_lock(&devp->reg_lock);
+
+    spin_lock_irqsave(&devp->volume_lock, flags);
+    pending = devp->volume_pending;
+    code = devp->volume_code;
+    devp->volume_pending = false;
+    spin_unlock_irqrestore(&devp->volume_lock, flags);
+
+    // Goes out on the I2C bus only if the register actually changes; channel mutes stay
+    if (pending)
+    {
+        ret = regmap_update_bits(devp->regmap, TPA6130A2_REG_VOLUME, 0xFF, code | devp->channel_mute);
+        if (ret == 0)
+            devp->volume_sent = code;
     }
-    // Otherwise, 
     else
     {
-      // Calculate the fp28 number
-      tempValue = set_fixed_num(substring);
+        ret = 0;
+    }
+
+    mutex_unlock(&devp->reg_lock);
+
+    if (ret < 0)
+        pr_err("tpa613a2: setting volume code 0x%02x failed: %d\n", code, ret);
+}
 
-      // Determine the code for the volume level
-      code = find_volume_level(tempValue,1);
+/** Step the volume along the ramp
+
+    Runs in hard interrupt context every ramp_period. The volume in dB follows the
+    curve between the start and the target; each step hands the nearest volume code
+    to the worker (the same path as a write to the volume attribute), so the I2C
+    bus sees at most ramp_rate_hz changes per second and only when the code changes.
+
+    @param timer The ramp_timer of the device
+    @returns HRTIMER_RESTART until the ramp is done
+*/
+static enum hrtimer_restart ramp_timer_func(struct hrtimer *timer)
+{
+    al_tpa613a2_dev_t *devp = container_of(timer, al_tpa613a2_dev_t, ramp_timer);
+    enum hrtimer_restart restart = HRTIMER_RESTART;
+    unsigned long flags;
+    unsigned int code;
+    u64 elapsed;
+    s64 t;
+    s64 c;
+    int mb;
+    bool done = false;
+
+    spin_lock_irqsave(&devp->volume_lock, flags);
+
+    elapsed = ktime_to_ns(ktime_sub(ktime_get(), devp->ramp_start));
+    t = elapsed >= devp->ramp_duration_ns ? 1000 : div64_u64(elapsed * 1000, devp->ramp_duration_ns);
+
+    // Progress along the curve, in permille
+    if (devp->ramp_curve == TPA_RAMP_SMOOTH)
+        c = div_s64(t * t * (3000 - 2 * t), 1000000);
+    else
+        c = t;
+
+    mb = devp->ramp_from_mb + (int)div_s64((s64)(devp->ramp_to_mb - devp->ramp_from_mb) * c, 1000);
+    code = volume_mb_to_code(mb);
+    if ((int)code != devp->ramp_code)
+    {
+        volume_submit_locked(devp, code);
+        devp->ramp_code = code;
+    }
+
+    devp->ramp_permille = t;
+    if (t >= 1000)
+    {
+        devp->ramp_state = TPA_RAMP_DONE;
+        restart = HRTIMER_NORESTART;
+        done = true;
     }
 
-    // Determine the closest volume level
-    tempValue = decode_volume(code);
+    spin_unlock_irqrestore(&devp->volume_lock, flags);
 
-    // Record the volume level to the volume variable
-    devp->volume = tempValue;
+    schedule_work(&devp->volume_work);
 
-    // Send the I2C commands
-    cmd[1] = code;
-    i2c_master_send(tpa_i2c_client,&cmd[0],2);
+    if (done && devp->ramp_kn)
+        sysfs_notify_dirent(devp->ramp_kn);
+    else
+        hrtimer_forward_now(timer, devp->ramp_period);
+
+    return restart;
+}
+
+/** Show the ramp state and its progress in percent, e.g. "running 42" */
+static ssize_t ramp_read(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    al_tpa613a2_dev_t *devp = (al_tpa613a2_dev_t *)dev_get_drvdata(dev);
+    enum tpa_ramp_state state;
+    unsigned int permille;
+    unsigned long flags;
+
+    spin_lock_irqsave(&devp->volume_lock, flags);
+    state = devp->ramp_state;
+    permille = devp->ramp_permille;
+    spin_unlock_irqrestore(&devp->volume_lock, flags);
+
+    return sprintf(buf, "%s %u\n", tpa_ramp_state_names[state], permille / 10);
+}
+
+/** Start or cancel a volume ramp
+
+    Write "<target dB> <duration ms> [linear|smooth]" to fade from the current volume
+    to the target, e.g. "-40 2000 smooth", or "cancel" to stop where the ramp is. A new
+    ramp replaces a running one. poll() on the attribute returns when the ramp is done
+    or cancelled.
+
+    @returns count, or -EINVAL for a malformed request
+*/
+static ssize_t ramp_write(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    al_tpa613a2_dev_t *devp = (al_tpa613a2_dev_t *)dev_get_drvdata(dev);
+    char target[32];
+    char curve[16] = "linear";
+    unsigned int duration_ms;
+    unsigned int code;
+    unsigned int steps;
+    unsigned long flags;
+    u64 period_ns;
+    uint32_t raw;
+    int from_mb;
+    int to_mb;
+    int ret;
+
+    if (sysfs_streq(buf, "cancel"))
+    {
+        ramp_stop(devp);
+        return count;
+    }
+
+    if (sscanf(buf, "%31s %u %15s", target, &duration_ms, curve) < 2)
+        return -EINVAL;
+    if (strcmp(curve, "linear") != 0 && strcmp(curve, "smooth") != 0)
+        return -EINVAL;
+    if (fixed_tpa_volume_parse(target, strlen(target), &raw))
+        return -EINVAL;
+
+    to_mb = volume_fixed_to_mb(raw);
+
+    ramp_stop(devp);
+
+    ret = volume_current_code(devp, &code);
+    if (ret < 0)
+        return ret;
+    from_mb = volume_code_to_mb(code);
+
+    // One step per volume code on the way, but no more than ramp_rate_hz of them
+    steps = abs(volume_code_step(volume_mb_to_code(to_mb)) - volume_code_step(code));
+    period_ns = steps ? div_u64((u64)duration_ms * NSEC_PER_MSEC, steps) : (u64)duration_ms * NSEC_PER_MSEC;
+    period_ns = max_t(u64, period_ns, NSEC_PER_SEC / max(ramp_rate_hz, 1U));
+
+    spin_lock_irqsave(&devp->volume_lock, flags);
+    devp->ramp_curve = strcmp(curve, "smooth") == 0 ? TPA_RAMP_SMOOTH : TPA_RAMP_LINEAR;
+    devp->ramp_from_mb = from_mb;
+    devp->ramp_to_mb = to_mb;
+    devp->ramp_duration_ns = max_t(u64, (u64)duration_ms * NSEC_PER_MSEC, 1);
+    devp->ramp_period = ns_to_ktime(period_ns);
+    devp->ramp_start = ktime_get();
+    devp->ramp_permille = 0;
+    devp->ramp_code = -1;
+    devp->ramp_state = TPA_RAMP_RUNNING;
+    spin_unlock_irqrestore(&devp->volume_lock, flags);
+
+    // The first step comes right away, so a zero duration jumps to the target
+    hrtimer_start(&devp->ramp_timer, 0, HRTIMER_MODE_REL);
 
     return count;
 }
 static ssize_t volume_read(struct device *dev, struct device_attribute *attr, char *buf)
 {
     al_tpa613a2_dev_t *devp = (al_tpa613a2_dev_t *)dev_get_drvdata(dev);
+    unsigned int code;
+    int ret;
+
+    // A code still waiting for the worker is the volume the amplifier is about to get;
+    // otherwise the register cache has the current one, without going out on the bus
+    ret = volume_current_code(devp, &code);
+    if (ret < 0)
+        return ret;
 
-    fp_to_string(buf, devp->volume);
+    fixed_tpa_volume_format(buf, PAGE_SIZE, volume_mb_to_fixed(volume_code_to_mb(code)), 2);
 
     strcat2(buf, "\n");
 
@@ -629,304 +1146,232 @@ static ssize_t volume_read(struct device *dev, struct device_attribute *attr, ch
     return strlen(buf);
 }
 
-char *strcat2(char *dst, char *src)
+/** Show the volume as an integer number of millibel (1/100 dB), e.g. "-1250" */
+static ssize_t volume_mb_read(struct device *dev, struct device_attribute *attr, char *buf)
 {
-    char *cp = dst;
+    al_tpa613a2_dev_t *devp = (al_tpa613a2_dev_t *)dev_get_drvdata(dev);
+    unsigned int code;
+    int ret;
 
-    while (*cp)
-        cp++; /* find end of dst */
+    ret = volume_current_code(devp, &code);
+    if (ret < 0)
+        return ret;
 
-    while (( *cp++ = *src++ ) != 0); /* Copy src to end of dst */
+    return sprintf(buf, "%d\n", volume_code_to_mb(code));
+}
 
-    return dst; /* return dst */
+/** Set the volume from an integer number of millibel, without any fixed-point parsing */
+static ssize_t volume_mb_write(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    al_tpa613a2_dev_t *devp = (al_tpa613a2_dev_t *)dev_get_drvdata(dev);
+    int mb;
+    int ret;
+
+    ret = kstrtoint(buf, 10, &mb);
+    if (ret < 0)
+        return ret;
+
+    volume_set_code(devp, volume_mb_to_code(mb));
+
+    return count;
 }
 
-/** Convert a string to a fixed point number structure
-    @param s String containing the string to convert to 32F16 representation
-    @return SUCCESS
+/** Channel set of an attribute value: "none", "left", "right" or "both"
 
-    @todo This function is really ugly and could be cleaned up to make it clear what is happening....
+    @param word The value
+    @returns The TPA6130A2_CHANNELS_MASK bits of the channels, or -EINVAL
 */
-uint32_t set_fixed_num(const char *s)
+static int channels_parse(const char *word)
 {
-    struct fixed_num num = {0, 0, 0};
-    int seen_point = 0;
-    int pointIndex;
     int i;
-    int ii;
-    int frac_comp;
-    uint32_t acc = 0;
-    char s2[80];
-    int pointsSeen = 0;
-    int charIndex = 0;
-
-    //If no leading 0, add one (eg: .25 -> 0.25)
-    if (s[0] == '.')
+
+    for (i = 0; i < ARRAY_SIZE(tpa_channel_names); i++)
     {
-        s2[0] = '0';
-        charIndex++;
+        if (sysfs_streq(word, tpa_channel_names[i]))
+            return i << 6;
     }
 
-    //This is a strcpy() to move the data a "const char *" to a "char *" and validate the data
-    for (i = 0; i < strlen(s); i++)
-    {
-        //Make sure the string contains an non-valid char (eg: not a number or a decimal point)
-        if ((s[i] == '.') || (s[i] >= '0' && s[i] <= '9'))
-        {
-            //Copy the data over and increment the pointer
-            s2[charIndex] = s[i];
-            charIndex++;
-        }
-        else
-        {
-            pr_info("Invalid char (c:%c x:%X) in number %s\n", s[i], s[i], s);
-            return 0x00000000;
-        }
+    return -EINVAL;
+}
 
-        //Count the number of decimals in the string
-        if (s[i] == '.')
-            pointsSeen++;
-    }
+/** Name of the channel set in the TPA6130A2_CHANNELS_MASK bits of a register */
+static const char *channels_name(unsigned int bits)
+{
+    return tpa_channel_names[(bits & TPA6130A2_CHANNELS_MASK) >> 6];
+}
 
-    //If multiple decimals points in the number (eg: 1.1.4)
-    if (pointsSeen > 1)
-        pr_info("Invalid number format: %s\n", s);
-
-    //Turn 1 into 1.0
-    //if (pointsSeen == 0)
-    // {
-    //    printk("Adding the decimal...\n");
-    //    s2[i] = char(".");
-    //    s2[i+1] = char("0");
-    //    //strcat2(".0",s2);
-    //    i=i+2;
-    // }
-    //Make sure the string is terminated
-    s2[i] = '\0';
-
-    //Count the fractional digits
-    for (pointIndex = 0; pointIndex < strlen(s2); pointIndex++)
-    {
-        if (s2[pointIndex] == '.')
-            break;
-    }
+/** Show the muted channels: "none", "left", "right" or "both" */
+static ssize_t mute_read(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    al_tpa613a2_dev_t *devp = (al_tpa613a2_dev_t *)dev_get_drvdata(dev);
+    unsigned int mute;
 
-    //String extend so that the output is accurate
-    while (strlen(s2) - pointIndex < 9)
-        strcat2(s2, "0");
+    mutex_lock(&devp->reg_lock);
+    mute = devp->channel_mute;
+    mutex_unlock(&devp->reg_lock);
 
-    //Truncate the string if its longer
-    s2[strlen(s2) - pointIndex + 9] = '\0';
+    return sprintf(buf, "%s\n", channels_name(mute));
+}
 
-    //Covert to fixed point
-    for (i = 0; i < 10; i++)
-    {
-        if (s2[i] == '.')
-        {
-            seen_point = 1;
-            continue;
-        }
-        if (!seen_point)
-        {
-            num.integer *= 10;
-            num.integer += (int)(s2[i] - '0');
-        }
-        else
-        {
-            num.fraction_len++;
-            num.fraction *= 10;
-            num.fraction += (int)(s2[i] - '0');
-        }
-    }
+/** Mute channels: "none", "left", "right" or "both"
 
-    //Turn the fixed point conversion into binary digits
-    for (ii = 0, frac_comp = 1; ii < num.fraction_len; ii++) frac_comp *= 10;
-    frac_comp /= 2;
+    Only the mute bits of the volume register change, in a single I2C write; the
+    volume code, a running ramp and the volume attribute are left alone. A volume
+    below the lowest code still mutes both channels whatever is written here.
+*/
+static ssize_t mute_write(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    al_tpa613a2_dev_t *devp = (al_tpa613a2_dev_t *)dev_get_drvdata(dev);
+    int mute = channels_parse(buf);
+    int ret;
 
-    // Get the fractional part (f28 hopefully)
-    for (ii = 0; i <= 36; i++)
-    {
-        if (num.fraction >= frac_comp)
-        {
-            acc |= 0x00000001;
-            num.fraction -= frac_comp;
-        }
-        frac_comp /= 2;
+    if (mute < 0)
+        return mute;
 
-        acc = acc << 1;
-    }
+    mutex_lock(&devp->reg_lock);
+    ret = regmap_update_bits(devp->regmap, TPA6130A2_REG_VOLUME, TPA6130A2_CHANNELS_MASK,
+                             mute | (devp->volume_sent & TPA6130A2_CHANNELS_MASK));
+    if (ret == 0)
+        devp->channel_mute = mute;
+    mutex_unlock(&devp->reg_lock);
+
+    return ret < 0 ? ret : count;
+}
 
-    acc = acc >> 12;
+/** Show the enabled channels: "none", "left", "right" or "both" */
+static ssize_t enable_read(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    al_tpa613a2_dev_t *devp = (al_tpa613a2_dev_t *)dev_get_drvdata(dev);
+    unsigned int control;
+    int ret;
 
-    //Combine the fractional part with the integer
-    acc += num.integer << 16;
+    ret = regmap_read(devp->regmap, TPA6130A2_REG_CONTROL, &control);
+    if (ret < 0)
+        return ret;
 
-    return acc;
+    return sprintf(buf, "%s\n", channels_name(control));
 }
 
-/** Function to convert a fp16 to a string representation
-    @todo doesn't handle negative numbers
-*/
-int fp_to_string(char *buf, uint32_t fp28_num)
+/** Enable channels: "none", "left", "right" or "both"; a single I2C write */
+static ssize_t enable_write(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
 {
-    int buf_pos = 0;
-    int i;
-    int fractionPart;
-    //int isNegative = 0;
-    int intPart = 1;
-    int i16 = 0;
+    al_tpa613a2_dev_t *devp = (al_tpa613a2_dev_t *)dev_get_drvdata(dev);
+    int enable = channels_parse(buf);
+    int ret;
 
-    if (fp28_num & 0x80000000)
-    {
-        fp28_num *= -1;
+    if (enable < 0)
+        return enable;
 
-        buf[buf_pos] = '-';
-        buf_pos++;
-    }
+    mutex_lock(&devp->reg_lock);
+    ret = regmap_update_bits(devp->regmap, TPA6130A2_REG_CONTROL, TPA6130A2_CHANNELS_MASK, enable);
+    mutex_unlock(&devp->reg_lock);
 
-    //Convert the integer part
-    i16 = (fp28_num >> 16);
-    while ( (i16 / intPart) > 9)
-    {
-        intPart *= 10;
-    }
+    return ret < 0 ? ret : count;
+}
 
-    while (intPart > 0)
-    {
-        buf[buf_pos] = (char)((i16 / intPart) + '0');
-        buf_pos++;
+/** Show the enabled and the muted channels, e.g. "both left" */
+static ssize_t channels_read(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    al_tpa613a2_dev_t *devp = (al_tpa613a2_dev_t *)dev_get_drvdata(dev);
+    unsigned int control;
+    unsigned int mute;
+    int ret;
 
-        i16 = i16 % intPart;
-        intPart = intPart / 10;
-    }
+    mutex_lock(&devp->reg_lock);
+    ret = regmap_read(devp->regmap, TPA6130A2_REG_CONTROL, &control);
+    mute = devp->channel_mute;
+    mutex_unlock(&devp->reg_lock);
 
-    //buf[buf_pos] = (char)((fp28_num>>16) + '0');
-    //buf_pos++;
+    if (ret < 0)
+        return ret;
 
-    buf[buf_pos] = '.';
-    buf_pos++;
+    return sprintf(buf, "%s %s\n", channels_name(control), channels_name(mute));
+}
 
-    //Mask the integer bits and dump 1 bit to make the conversion easier....
-    fractionPart = (0x0000FFFF & fp28_num) >> 1; // 32F27 so that 0-9 can fit in the high 5 bits)
+/** Set the enabled and the muted channels together: "<enabled> <muted>", e.g. "both right"
 
-    for (i = 0; i < 8; i++)
+    Both registers go to the amplifier in one I2C message, so the two channels
+    never pass through a half-updated state.
+*/
+static ssize_t channels_write(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    al_tpa613a2_dev_t *devp = (al_tpa613a2_dev_t *)dev_get_drvdata(dev);
+    char enable_word[8];
+    char mute_word[8];
+    unsigned int control;
+    u8 vals[2];
+    int enable;
+    int mute;
+    int ret;
+
+    if (sscanf(buf, "%7s %7s", enable_word, mute_word) != 2)
+        return -EINVAL;
+
+    enable = channels_parse(enable_word);
+    mute = channels_parse(mute_word);
+    if (enable < 0 || mute < 0)
+        return -EINVAL;
+
+    mutex_lock(&devp->reg_lock);
+
+    ret = regmap_read(devp->regmap, TPA6130A2_REG_CONTROL, &control);
+    if (ret == 0)
     {
-        fractionPart *= 10;
-        buf[buf_pos] = (fractionPart >> 15) + '0';
-        buf_pos++;
-        fractionPart &= 0x00007FFF;
+        // A code still waiting for the worker goes out later with the new mutes
+        vals[0] = (control & ~TPA6130A2_CHANNELS_MASK) | enable;
+        vals[1] = devp->volume_sent | mute;
+        ret = regmap_bulk_write(devp->regmap, TPA6130A2_REG_CONTROL, vals, ARRAY_SIZE(vals));
     }
+    if (ret == 0)
+        devp->channel_mute = mute;
 
-    buf[buf_pos] = '\0';
+    mutex_unlock(&devp->reg_lock);
 
-    return 0;
+    return ret < 0 ? ret : count;
 }
-uint8_t find_volume_level(uint32_t fp28_num, uint8_t pn)
-{
-  // Instantiate some variables
-  uint8_t return_code = 0;
-  int start_index;
-  int stop_index;
-  int16_t diff = 10000;
-  int16_t curDiff = 10000;
-  uint32_t inputnum = fp28_num*10;
-  uint16_t intval = (uint16_t)((inputnum)>>=16);
-  int i;
-  uint16_t return_value = 0;
-
-  // Find the length of the array
-  size_t n = sizeof(VolumeLevels)/sizeof(VolumeLevels[0]);
-  
-  // Set the start and stop search values depending on whether
-  // a negative sign was detected
-  if (pn == 1)
-  {
-    start_index = PN_INDEX;
-    stop_index = n;
-  }
-  else
-  {  
-    start_index = 0;
-    stop_index = PN_INDEX - 1;  
-  } 
-      
-  // Determine whether the negative dB bound has been exceeded
-  if ((intval > VolumeLevels[0].value) && (pn == 0))
-  { 
-    printk("Maximum attenuation exceeded.\n");
-    printk("Setting attenuation to -100 dB.\n");
-    return VolumeLevels[0].code;
-  }
-
-  // Determine whether the positive dB bound has been exceeded
-  if ((intval > VolumeLevels[n-1].value) && (pn == 1))
-  {
-    printk("Maximum amplification exceeded.\n");
-    printk("Setting amplification to 4 dB.\n");
-    return VolumeLevels[n-1].code;
-  }  
-
-  // Search for the closest value (above or below)
-  for (i = start_index; i < stop_index; i++)
-  {
-    // calculate the difference values 
-    if (intval > VolumeLevels[i].value)
-      diff = intval - VolumeLevels[i].value;
-    else
-      diff = VolumeLevels[i].value - intval;
 
-    // If the calculated difference is smaller than the calculated
-    // current best (smallest) difference set the new current difference
-    if (diff < curDiff)
-    {
-      curDiff = diff;
-      return_code = VolumeLevels[i].code;
-      return_value = VolumeLevels[i].value;
-    }
-    // Otherwise, stop.  (it only gets worse from here)
-    else
-      break;
-  }
-  
-  // Return the correct volume code
-  return return_code;
+/** Number of volume changes written to sysfs */
+static ssize_t volume_submitted_read(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    al_tpa613a2_dev_t *devp = (al_tpa613a2_dev_t *)dev_get_drvdata(dev);
+    unsigned long flags;
+    unsigned long val;
+
+    spin_lock_irqsave(&devp->volume_lock, flags);
+    val = devp->volume_submitted;
+    spin_unlock_irqrestore(&devp->volume_lock, flags);
+
+    return sprintf(buf, "%lu\n", val);
 }
 
-uint32_t decode_volume(uint8_t code)
+/** Number of volume changes dropped because a newer one came before they were sent */
+static ssize_t volume_coalesced_read(struct device *dev, struct device_attribute *attr, char *buf)
 {
-  // Initialize some variables
-  int i;
-  size_t n = sizeof(VolumeLevels)/sizeof(VolumeLevels[0]);
-  uint32_t decodedDB = 0;
+    al_tpa613a2_dev_t *devp = (al_tpa613a2_dev_t *)dev_get_drvdata(dev);
+    unsigned long flags;
+    unsigned long val;
 
-  // Find the correct volume level
-  for (i=0;i<n;i++)
-  {
-    if (code == VolumeLevels[i].code)
-      break; 
-  }
+    spin_lock_irqsave(&devp->volume_lock, flags);
+    val = devp->volume_coalesced;
+    spin_unlock_irqrestore(&devp->volume_lock, flags);
 
-  // If it's in the negative portion, multiply by -1  
-  if (i < PN_INDEX)
-  {    
-    decodedDB = VolumeLevels[i].value;
-    decodedDB = (decodedDB<<16)/10;
-    return -1*decodedDB;
-  }  
-  else
-  {
-    decodedDB = VolumeLevels[i].value;
-    return (decodedDB<<16)/10;
-  }  
+    return sprintf(buf, "%lu\n", val);
+}
 
+char *strcat2(char *dst, char *src)
+{
+    char *cp = dst;
 
-}
+    while (*cp)
+        cp++; /* find end of dst */
+
+    while (( *cp++ = *src++ ) != 0); /* Copy src to end of dst */
 
-/** Tell the kernel what the initialization function is */
-module_init(tpa613a2_init);
+    return dst; /* return dst */
+}
 
-/** Tell the kernel what the delete function is */
-module_exit(tpa613a2_exit);
+/** Register the I2C driver at module load and unregister it at unload */
+module_i2c_driver(tpa613a2_driver);
 
 
 
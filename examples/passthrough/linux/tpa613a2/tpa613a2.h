@@ -0,0 +1,82 @@
+/* SPDX-License-Identifier: GPL-2.0 or MIT                               */
+/*-------------------------------------------------------------------------
+ * Description:  User-space interface of the tpa613a2 driver (TPA6130A2
+ *               register map and ioctl definitions). Included by both
+ *               the driver and user-space programs.
+ * ------------------------------------------------------------------------
+ * /dev/al_TPA6130A2_* is a binary view of the amplifier registers: the
+ * file offset is the register address and every byte is one register.
+ *
+ *   pread(fd, buf, 4, TPA6130A2_REG_CONTROL)    reads registers 1..4
+ *   pwrite(fd, buf, 2, TPA6130A2_REG_VOLUME)    writes registers 2..3
+ *
+ * Reads come from the driver's register cache; only TPA6130A2_REG_VERSION
+ * is read from the amplifier over I2C.
+ * A write goes out as one I2C message with an auto-incremented register
+ * address; writes past the last writeable register are cut short.
+ *
+ * TPA613A2_IOC_MULTI_WRITE writes any set of registers in one I2C message,
+ * e.g. the channel enables and the volume together. Writes that change
+ * the volume register take over from a running volume ramp.
+-------------------------------------------------------------------------*/
+#ifndef TPA613A2_H
+#define TPA613A2_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/*-----------------------------------------------------------------------*/
+/* TPA6130A2 Registers (datasheet section 8.6 Register Maps)             */
+/*-----------------------------------------------------------------------*/
+#define TPA6130A2_REG_CONTROL       0x01  /* Channel enables, mode, thermal flag, shutdown */
+#define TPA6130A2_REG_VOLUME        0x02  /* Mute bits and volume code                     */
+#define TPA6130A2_REG_OUT_IMPEDANCE 0x03  /* High-impedance outputs                        */
+#define TPA6130A2_REG_VERSION       0x04  /* Read-only chip version                        */
+
+#define TPA6130A2_HP_EN_L           0x80  /* TPA6130A2_REG_CONTROL: enable the left channel  */
+#define TPA6130A2_HP_EN_R           0x40  /* TPA6130A2_REG_CONTROL: enable the right channel */
+#define TPA6130A2_MUTE_L            0x80  /* TPA6130A2_REG_VOLUME: mute the left channel     */
+#define TPA6130A2_MUTE_R            0x40  /* TPA6130A2_REG_VOLUME: mute the right channel    */
+#define TPA6130A2_VOLUME_MASK       0x3F  /* TPA6130A2_REG_VOLUME: volume code               */
+
+/*-----------------------------------------------------------------------*/
+/* Multi-Register Writes                                                 */
+/*-----------------------------------------------------------------------*/
+/* Maximum number of register writes in a single TPA613A2_IOC_MULTI_WRITE */
+#define TPA613A2_MAX_WRITES 16
+
+/*
+ * struct tpa613a2_reg_write - One register write
+ * @reg: Register address, TPA6130A2_REG_CONTROL..TPA6130A2_REG_OUT_IMPEDANCE.
+ * @value: Value to write.
+ */
+struct tpa613a2_reg_write {
+	__u8 reg;
+	__u8 value;
+};
+
+/*
+ * struct tpa613a2_multi_write - A batch of register writes
+ * @writes: User-space pointer to an array of struct tpa613a2_reg_write.
+ * @count: Number of entries in @writes (1..TPA613A2_MAX_WRITES).
+ * @reserved: Must be zero.
+ *
+ * The writes are applied in order to the cached registers (so the last
+ * write to a register wins), and the registers from the lowest to the
+ * highest one written are then sent in a single I2C message.
+ */
+struct tpa613a2_multi_write {
+	__u64 writes;
+	__u32 count;
+	__u32 reserved;
+};
+
+/*-----------------------------------------------------------------------*/
+/* ioctl Commands                                                        */
+/*-----------------------------------------------------------------------*/
+#define TPA613A2_IOC_MAGIC 't'
+
+#define TPA613A2_IOC_MULTI_WRITE \
+	_IOW(TPA613A2_IOC_MAGIC, 0x01, struct tpa613a2_multi_write)
+
+#endif
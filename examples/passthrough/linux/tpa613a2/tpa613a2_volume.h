@@ -0,0 +1,74 @@
+/** @file
+
+    TPA6130A2 volume conversions between register values, millibel (1/100 dB) and the
+    32F16 dB values of the volume and ramp attributes.
+
+    Shared by the driver and tpa613a2_volume_test.c, so the host test checks the same
+    code the driver runs. Only 32-bit arithmetic is used, which needs no 64-bit division
+    helpers in the kernel.
+*/
+
+#ifndef TPA613A2_VOLUME_H
+#define TPA613A2_VOLUME_H
+
+#include "fixed_point.h"
+#include "tpa613a2.h"           // TPA6130A2 register bits
+
+// Code <-> millibel tables, generated from the datasheet by tpa613a2_volume_gen.c
+#include "tpa613a2_volume_table.h"
+
+#define TPA_VOLUME_CODE_MUTE        0xFF    ///< Both channels muted
+#define TPA_VOLUME_CODE_DEFAULT     0x34    ///< -0.3 dB, the closest code to unity gain
+#define TPA_VOLUME_MB_MUTE          -10000  ///< Gain reported for (and mapped to) mute: -100 dB
+
+/** Furthest a 32F16 gain is taken from 0 dB before converting; well past mute and the loudest code */
+#define TPA_VOLUME_FIXED_LIMIT      (200 * 65536)
+
+/** Gain of a volume register value in millibel */
+static inline int volume_code_to_mb(unsigned int code)
+{
+    if ((code & (TPA6130A2_MUTE_L | TPA6130A2_MUTE_R)) == (TPA6130A2_MUTE_L | TPA6130A2_MUTE_R))
+        return TPA_VOLUME_MB_MUTE;
+
+    return tpa_volume_code_to_mb[code & TPA6130A2_VOLUME_MASK];
+}
+
+/** Volume register value closest to a gain in millibel; far below the lowest code is mute */
+static inline unsigned int volume_mb_to_code(int mb)
+{
+    if (mb < TPA_VOLUME_MB_MIN)
+        return mb < (TPA_VOLUME_MB_MUTE + TPA_VOLUME_MB_MIN) / 2 ? TPA_VOLUME_CODE_MUTE : 0;
+    if (mb > TPA_VOLUME_MB_MAX)
+        return TPA_VOLUME_NUM_CODES - 1;
+
+    return tpa_volume_mb_to_code[mb - TPA_VOLUME_MB_MIN];
+}
+
+/** A 32F16 gain in dB, rounded to millibel
+
+    1 dB is 100 mB and 65536 in 32F16, so mB = v * 100 / 65536 = v * 25 / 16384.
+*/
+static inline int volume_fixed_to_mb(uint32_t raw)
+{
+    int64_t v = fixed_tpa_volume_value(raw);
+    int32_t x;
+
+    if (v < -TPA_VOLUME_FIXED_LIMIT)
+        v = -TPA_VOLUME_FIXED_LIMIT;
+    if (v > TPA_VOLUME_FIXED_LIMIT)
+        v = TPA_VOLUME_FIXED_LIMIT;
+
+    x = (int32_t)v * 25;
+
+    return (x + (x < 0 ? -8192 : 8192)) / 16384;
+}
+
+/** A gain in millibel as a 32F16 value in dB, rounded to the nearest LSB */
+static inline uint32_t volume_mb_to_fixed(int mb)
+{
+    int32_t x = (int32_t)mb * 16384;
+
+    return fixed_tpa_volume_from_value((x + (x < 0 ? -12 : 12)) / 25);
+}
+
+#endif
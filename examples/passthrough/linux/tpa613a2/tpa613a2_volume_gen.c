@@ -0,0 +1,105 @@
+/** @file
+
+    Generates tpa613a2_volume_table.h, the TPA6130A2 volume lookup tables, at build time.
+
+    The only input is the datasheet's volume table (TPA6130A2 datasheet, Table 2 in
+    section 8.4.9 Volume Control), one entry per 6-bit volume code. From it this builds
+        - tpa_volume_code_to_mb[64]: the gain of every code in millibel (1/100 dB), and
+        - tpa_volume_mb_to_code[]: the nearest code for every millibel value in range,
+    so the driver converts both ways with a single array access. The tables are checked
+    before they are written; any problem fails the build.
+
+    Runs on the build host: tpa613a2_volume_gen > tpa613a2_volume_table.h
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_CODES 64
+
+/** Gain of each volume code in tenths of a dB, from the datasheet */
+static const int code_db10[NUM_CODES] =
+{
+    -595, -535, -500, -475, -455, -439, -414, -395,     // 0x00
+    -365, -353, -333, -317, -304, -286, -271, -263,     // 0x08
+    -247, -237, -225, -217, -205, -196, -188, -178,     // 0x10
+    -170, -162, -152, -145, -137, -130, -123, -116,     // 0x18
+    -109, -103,  -97,  -90,  -85,  -78,  -72,  -67,     // 0x20
+     -61,  -56,  -51,  -45,  -41,  -35,  -31,  -26,     // 0x28
+     -21,  -17,  -12,   -8,   -3,    1,    5,    9,     // 0x30
+      14,   17,   21,   25,   29,   33,   36,   40,     // 0x38
+};
+
+static void fail(const char *msg, int a, int b)
+{
+    fprintf(stderr, "tpa613a2_volume_gen: %s (%d, %d)\n", msg, a, b);
+    exit(1);
+}
+
+int main(void)
+{
+    int min_mb = code_db10[0] * 10;
+    int max_mb = code_db10[NUM_CODES - 1] * 10;
+    int n = max_mb - min_mb + 1;
+    unsigned char *mb_to_code = malloc(n);
+    int code;
+    int best;
+    int mb;
+    int i;
+
+    if (!mb_to_code)
+        fail("out of memory", n, 0);
+
+    // Codes must be strictly increasing in gain, or "nearest" isn't well defined
+    for (code = 1; code < NUM_CODES; code++)
+    {
+        if (code_db10[code] <= code_db10[code - 1])
+            fail("gain not increasing at code", code, code_db10[code]);
+    }
+
+    // Nearest code for every millibel value; a tie goes to the quieter code
+    for (mb = min_mb, code = 0; mb <= max_mb; mb++)
+    {
+        while (code + 1 < NUM_CODES && abs(code_db10[code + 1] * 10 - mb) < abs(code_db10[code] * 10 - mb))
+            code++;
+        mb_to_code[mb - min_mb] = code;
+    }
+
+    // Check against a brute-force search, and that every code maps back onto itself
+    for (mb = min_mb; mb <= max_mb; mb++)
+    {
+        best = 0;
+        for (i = 1; i < NUM_CODES; i++)
+        {
+            if (abs(code_db10[i] * 10 - mb) < abs(code_db10[best] * 10 - mb))
+                best = i;
+        }
+        if (mb_to_code[mb - min_mb] != best)
+            fail("nearest code mismatch at mB", mb, best);
+    }
+    for (code = 0; code < NUM_CODES; code++)
+    {
+        if (mb_to_code[code_db10[code] * 10 - min_mb] != code)
+            fail("code doesn't round-trip", code, code_db10[code]);
+    }
+
+    printf("/* Generated by tpa613a2_volume_gen from the TPA6130A2 datasheet volume table; do not edit */\n\n");
+    printf("#define TPA_VOLUME_NUM_CODES %d\n", NUM_CODES);
+    printf("#define TPA_VOLUME_MB_MIN %d\n", min_mb);
+    printf("#define TPA_VOLUME_MB_MAX %d\n\n", max_mb);
+
+    printf("/** Gain of each volume code in millibel */\n");
+    printf("static const s16 tpa_volume_code_to_mb[TPA_VOLUME_NUM_CODES] =\n{");
+    for (code = 0; code < NUM_CODES; code++)
+        printf("%s%6d,", code % 8 ? "" : "\n   ", code_db10[code] * 10);
+    printf("\n};\n\n");
+
+    printf("/** Nearest volume code of each gain from TPA_VOLUME_MB_MIN to TPA_VOLUME_MB_MAX millibel */\n");
+    printf("static const u8 tpa_volume_mb_to_code[TPA_VOLUME_MB_MAX - TPA_VOLUME_MB_MIN + 1] =\n{");
+    for (i = 0; i < n; i++)
+        printf("%s 0x%02x,", i % 16 ? "" : "\n   ", mb_to_code[i]);
+    printf("\n};\n");
+
+    free(mb_to_code);
+    return 0;
+}
@@ -0,0 +1,116 @@
+/* SPDX-License-Identifier: GPL-2.0 or MIT                               */
+/*-------------------------------------------------------------------------
+ * Description:  Host-side test of the tpa613a2 volume conversions
+ * ------------------------------------------------------------------------
+ * Runs the conversions of tpa613a2_volume.h the way the volume attribute
+ * does: every volume code (and mute) is read as "x.yz" dB, written back,
+ * and has to give the same code again. A few gains written by hand are
+ * checked against the millibel (1/100 dB) value and code they must give.
+ *
+ * Build and run on the host:
+ *   gcc -O2 -Wall -o tpa613a2_volume_gen tpa613a2_volume_gen.c
+ *   ./tpa613a2_volume_gen > tpa613a2_volume_table.h
+ *   gcc -O2 -Wall -I../../../../intro/linux/platform_driver \
+ *       -o tpa613a2_volume_test tpa613a2_volume_test.c
+ *   ./tpa613a2_volume_test
+ *
+ * The exit status is non-zero if any check failed.
+-------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef int16_t s16;    // Types of the generated tables
+typedef uint8_t u8;
+
+#include "tpa613a2_volume.h"
+
+static unsigned long failures;
+
+/** Writes s to the volume attribute: the code the driver would program, or -1 if s is rejected */
+static int volume_write(const char *s, int *mb)
+{
+    uint32_t raw;
+
+    if (fixed_tpa_volume_parse(s, strlen(s), &raw) < 0)
+        return -1;
+
+    *mb = volume_fixed_to_mb(raw);
+
+    return volume_mb_to_code(*mb);
+}
+
+/** Reads the volume attribute for a code */
+static void volume_read(char *buf, size_t len, unsigned int code)
+{
+    fixed_tpa_volume_format(buf, len, volume_mb_to_fixed(volume_code_to_mb(code)), 2);
+}
+
+static void check_round_trip(unsigned int code)
+{
+    char buf[32];
+    int mb;
+    int got;
+
+    volume_read(buf, sizeof(buf), code);
+    got = volume_write(buf, &mb);
+    if (got != (int)code || mb != volume_code_to_mb(code)) {
+        printf("FAIL code 0x%02X reads \"%s\" (%d mB), written back gives code 0x%02X (%d mB)\n",
+               code, buf, volume_code_to_mb(code), got, mb);
+        failures++;
+    }
+}
+
+static void check_write(const char *s, int want_mb, int want_code)
+{
+    int mb = 0;
+    int got = volume_write(s, &mb);
+
+    if (got != want_code || mb != want_mb) {
+        printf("FAIL \"%s\" dB gives %d mB, code 0x%02X; expected %d mB, code 0x%02X\n",
+               s, mb, got, want_mb, want_code);
+        failures++;
+    }
+}
+
+static void check_read(unsigned int code, const char *want)
+{
+    char buf[32];
+
+    volume_read(buf, sizeof(buf), code);
+    if (strcmp(buf, want) != 0) {
+        printf("FAIL code 0x%02X reads \"%s\", expected \"%s\"\n", code, buf, want);
+        failures++;
+    }
+}
+
+int main(void)
+{
+    unsigned int code;
+
+    for (code = 0; code < TPA_VOLUME_NUM_CODES; code++)
+        check_round_trip(code);
+    check_round_trip(TPA_VOLUME_CODE_MUTE);
+
+    check_write("-12.5", -1250, volume_mb_to_code(-1250));
+    check_write("-3", -300, volume_mb_to_code(-300));
+    check_write("-59.5", -5950, 0);
+    check_write("4", 400, TPA_VOLUME_NUM_CODES - 1);
+    check_write("30", 3000, TPA_VOLUME_NUM_CODES - 1);
+    check_write("-100", TPA_VOLUME_MB_MUTE, TPA_VOLUME_CODE_MUTE);
+    check_write("-32000", -20000, TPA_VOLUME_CODE_MUTE);
+
+    check_read(0x00, "-59.50");
+    check_read(TPA_VOLUME_CODE_DEFAULT, "-0.30");
+    check_read(TPA_VOLUME_NUM_CODES - 1, "4.00");
+    check_read(TPA_VOLUME_CODE_MUTE, "-100.00");
+
+    if (failures) {
+        printf("%lu failures\n", failures);
+        return 1;
+    }
+
+    printf("all %u volume codes round-trip\n", TPA_VOLUME_NUM_CODES + 1);
+
+    return 0;
+}
@@ -0,0 +1,121 @@
+/* SPDX-License-Identifier: GPL-2.0 or MIT */
+/*
+ * Fixed-point formats known at compile time.
+ *
+ * FIXED_POINT_DEFINE(name, W, F, S) defines a set of functions for one Q
+ * format, so the format is written down once instead of being passed (and
+ * re-derived) on every call. The width, fractional bits and signedness are
+ * constants in every function, so after inlining the masks, shifts and
+ * limits fold away and each conversion is straight-line code. A format
+ * that doesn't fit in a 32-bit register word fails to compile.
+ *
+ * For a format called name this defines:
+ *   name_WIDTH, name_FRAC_BITS, name_SIGNED  (enum constants)
+ *   name_value(raw)                 sign-extended integer (in LSBs)
+ *   name_from_value(v)              saturating
+ *   name_from_f32_bits(bits, mode)  saturating, see fp_array_from_f32_bits()
+ *   name_to_f32_bits(raw)
+ *   name_format(buf, len, raw, digits), see fp_format()
+ *   name_parse(s, len, &raw), see fp_parse()
+ *   name_from_double(x, mode), name_to_double(raw)  (user-space only)
+ *
+ * fixed_point.hpp has the same formats as C++ types.
+ */
+
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include "fp_conversions.h"
+#include "fp_array_conversions.h"
+
+/* Compile-time constants of a format; usable in initializers and case labels */
+#define FIXED_POINT_MASK(W) ((uint32_t)(((uint64_t)1 << (W)) - 1))
+#define FIXED_POINT_MIN(W, S) ((S) ? -((int64_t)1 << ((W) - 1)) : (int64_t)0)
+#define FIXED_POINT_MAX(W, S) ((S) ? ((int64_t)1 << ((W) - 1)) - 1 : ((int64_t)1 << (W)) - 1)
+
+/* The same for a format defined with FIXED_POINT_DEFINE() */
+#define FIXED_POINT_MASK_OF(name) FIXED_POINT_MASK(name##_WIDTH)
+#define FIXED_POINT_MIN_OF(name) FIXED_POINT_MIN(name##_WIDTH, name##_SIGNED)
+#define FIXED_POINT_MAX_OF(name) FIXED_POINT_MAX(name##_WIDTH, name##_SIGNED)
+
+/* A constant in a format, rounded to nearest: FIXED_POINT_CONST(0.5, 16) */
+#define FIXED_POINT_CONST(x, F) \
+  ((int64_t)((x) * (double)((uint64_t)1 << (F)) + ((x) < 0 ? -0.5 : 0.5)))
+
+#ifdef __KERNEL__
+#define FIXED_POINT_DEFINE_FLOAT(name, W, F, S)
+#else
+#define FIXED_POINT_DEFINE_FLOAT(name, W, F, S)                                               \
+  static inline uint32_t name##_from_double(double x, enum fp_round mode) {                   \
+    uint64_t bits;                                                                            \
+    bool saturated;                                                                           \
+    memcpy(&bits, &x, sizeof(bits));                                                          \
+    return fp_array_from_f64_bits(bits, W, F, S, mode, &saturated);                           \
+  }                                                                                           \
+  static inline double name##_to_double(uint32_t raw) {                                       \
+    uint64_t bits = fp_array_to_f64_bits(raw, W, F, S);                                       \
+    double x;                                                                                 \
+    memcpy(&x, &bits, sizeof(x));                                                             \
+    return x;                                                                                 \
+  }
+#endif
+
+/** FIXED_POINT_DEFINE: Define the constants and functions of a Q format.
+
+@param name, the prefix of everything defined.
+
+@param W, the total number of bits (1..32), including the sign bit.
+
+@param F, the number of fractional bits (0..W).
+
+@param S, 1 for two's complement, 0 for unsigned.
+*/
+#define FIXED_POINT_DEFINE(name, W, F, S)                                                     \
+  _Static_assert((W) >= 1 && (W) <= FP_ARRAY_MAX_WIDTH, #name ": width must be 1..32 bits"); \
+  _Static_assert((F) <= (W), #name ": more fractional than total bits");                     \
+  _Static_assert((S) == 0 || (S) == 1, #name ": signedness must be 0 or 1");                 \
+  enum {                                                                                      \
+    name##_WIDTH = (W),                                                                       \
+    name##_FRAC_BITS = (F),                                                                   \
+    name##_SIGNED = (S),                                                                      \
+  };                                                                                          \
+  static inline int64_t name##_value(uint32_t raw) {                                          \
+    return fp_array_value(raw, W, S);                                                         \
+  }                                                                                           \
+  static inline uint32_t name##_from_value(int64_t v) {                                       \
+    v = v < FIXED_POINT_MIN(W, S) ? FIXED_POINT_MIN(W, S) : v;                                \
+    v = v > FIXED_POINT_MAX(W, S) ? FIXED_POINT_MAX(W, S) : v;                                \
+    return (uint32_t)v & FIXED_POINT_MASK(W);                                                 \
+  }                                                                                           \
+  static inline uint32_t name##_from_f32_bits(uint32_t bits, enum fp_round mode) {            \
+    bool saturated;                                                                           \
+    return fp_array_from_f32_bits(bits, W, F, S, mode, &saturated);                           \
+  }                                                                                           \
+  static inline uint32_t name##_to_f32_bits(uint32_t raw) {                                   \
+    return fp_array_to_f32_bits(raw, W, F, S);                                                \
+  }                                                                                           \
+  static inline int name##_format(char *buf, size_t buflen, uint32_t raw, unsigned int digits) { \
+    return fp_format(buf, buflen, raw, W, F, S, digits);                                      \
+  }                                                                                           \
+  static inline int name##_parse(const char *s, size_t len, uint32_t *raw) {                  \
+    uint64_t out;                                                                             \
+    int ret = fp_parse(s, len, W, F, S, &out);                                                \
+    if (ret == 0) {                                                                           \
+      *raw = (uint32_t)out;                                                                   \
+    }                                                                                         \
+    return ret;                                                                               \
+  }                                                                                           \
+  FIXED_POINT_DEFINE_FLOAT(name, W, F, S)
+
+/*-----------------------------------------------------------------------*/
+/* Formats used in the designs                                           */
+/*-----------------------------------------------------------------------*/
+FIXED_POINT_DEFINE(fixed_audio, 24, 23, 1)       // Avalon streaming audio
+FIXED_POINT_DEFINE(fixed_hanning, 24, 22, 0)     // fftAnalysisSynthesis Hanning window
+FIXED_POINT_DEFINE(fixed_fft_gain, 16, 8, 1)     // fftAnalysisSynthesis filter gains
+FIXED_POINT_DEFINE(fixed_comb_gain, 16, 16, 1)   // combFilter b0 and bM
+FIXED_POINT_DEFINE(fixed_comb_mix, 16, 16, 0)    // combFilter wet/dry mix
+FIXED_POINT_DEFINE(fixed_comb_delay, 16, 0, 0)   // combFilter delay M in samples
+FIXED_POINT_DEFINE(fixed_tpa_volume, 32, 16, 1)  // tpa613a2 volume in dB
+
+#endif
@@ -0,0 +1,216 @@
+/* SPDX-License-Identifier: GPL-2.0 or MIT */
+/*
+ * Compile-time fixed-point types.
+ *
+ * fixed<W, F, Signed> is a W-bit Q format with F fractional bits, held in
+ * the low W bits of a 32-bit word the way the registers hold it. The format
+ * is part of the type, so masks, limits and scale factors are constants,
+ * conversions compile to straight-line code, and a bad format is a compile
+ * error instead of a wrong register value.
+ *
+ * Host-side tools and models use this header; drivers use the C
+ * instantiations in fixed_point.h. Both share the rounding of
+ * fp_array_conversions.h and the string conversions of fp_conversions.h,
+ * so a value converts the same way everywhere. Needs C++17.
+ */
+
+#ifndef FIXED_POINT_HPP
+#define FIXED_POINT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include "fp_conversions.h"
+#include "fp_array_conversions.h"
+
+namespace fp {
+
+/** fixed: A W-bit fixed point number with F fractional bits.
+*/
+template <unsigned W, unsigned F, bool Signed>
+class fixed {
+  static_assert(W >= 1 && W <= FP_ARRAY_MAX_WIDTH, "fixed-point width must be 1..32 bits");
+  static_assert(F <= W, "fixed-point format can't have more fractional than total bits");
+
+public:
+  static constexpr unsigned width = W;
+  static constexpr unsigned frac_bits = F;
+  static constexpr unsigned int_bits = W - F;
+  static constexpr bool is_signed = Signed;
+
+  /** mask: The bits of a register word that hold the value.
+  */
+  static constexpr uint32_t mask = (uint32_t)(((uint64_t)1 << W) - 1);
+
+  /** sign_bit: The sign bit of a signed format, 0 for an unsigned one.
+  */
+  static constexpr uint32_t sign_bit = Signed ? (uint32_t)1 << (W - 1) : 0;
+
+  /** min_value, max_value: The limits of the format as integers (in LSBs).
+  */
+  static constexpr int64_t min_value = Signed ? -((int64_t)1 << (W - 1)) : 0;
+  static constexpr int64_t max_value = Signed ? ((int64_t)1 << (W - 1)) - 1 : ((int64_t)1 << W) - 1;
+
+  /** scale: 2^F, the value of one in LSBs; lsb is its inverse. Both are exact.
+  */
+  static constexpr double scale = (double)((uint64_t)1 << F);
+  static constexpr double lsb = 1.0 / scale;
+
+  /** min, max: The limits of the format as real numbers.
+  */
+  static constexpr double min = (double)min_value * lsb;
+  static constexpr double max = (double)max_value * lsb;
+
+  /** digits: Fractional digits that always survive a round trip through a string.
+  */
+  static constexpr unsigned digits = FP_ROUNDTRIP_DIGITS(F);
+
+  constexpr fixed() : raw_(0) {}
+
+  /** from_raw: Make a value from a register word; bits above W are ignored.
+  */
+  static constexpr fixed from_raw(uint32_t raw) {
+    return fixed(raw & mask);
+  }
+
+  /** from_value: Make a value from an integer number of LSBs, saturating it.
+  */
+  static constexpr fixed from_value(int64_t value) {
+    return fixed((uint32_t)clamp(value) & mask);
+  }
+
+  /** from_double: Convert a real number, rounding it and saturating it to the format.
+
+  NaN converts to 0. Usable in constant expressions, e.g. for coefficient tables.
+  */
+  static constexpr fixed from_double(double x, enum fp_round mode = FP_ROUND_NEAREST_EVEN) {
+    if (!(x == x)) {
+      return fixed();
+    }
+    // Anything beyond 2^33 saturates anyway; this keeps the cast defined
+    const double y = x * scale > 8589934592.0 ? 8589934592.0
+                   : x * scale < -8589934592.0 ? -8589934592.0 : x * scale;
+    int64_t t = (int64_t)y;
+    const double f = y - (double)t;
+
+    switch (mode) {
+    case FP_ROUND_NEAREST_EVEN:
+      t += (f > 0.5 || (f == 0.5 && (t & 1))) - (f < -0.5 || (f == -0.5 && (t & 1)));
+      break;
+    case FP_ROUND_NEAREST_AWAY:
+      t += (f >= 0.5) - (f <= -0.5);
+      break;
+    case FP_ROUND_FLOOR:
+      t -= f < 0;
+      break;
+    case FP_ROUND_CEIL:
+      t += f > 0;
+      break;
+    default:
+      break;
+    }
+    return from_value(t);
+  }
+
+  /** from_float: Convert a float the same way fp_array_from_f32() does.
+  */
+  static fixed from_float(float x, enum fp_round mode = FP_ROUND_NEAREST_EVEN) {
+    uint32_t bits;
+    bool saturated;
+
+    std::memcpy(&bits, &x, sizeof(bits));
+    return fixed(fp_array_from_f32_bits(bits, W, F, Signed, mode, &saturated));
+  }
+
+  /** raw: The register word (the value in the low W bits).
+  */
+  constexpr uint32_t raw() const {
+    return raw_;
+  }
+
+  /** value: The value as a (sign-extended) integer number of LSBs.
+  */
+  constexpr int64_t value() const {
+    return Signed && (raw_ & sign_bit) ? (int64_t)raw_ - ((int64_t)1 << W) : (int64_t)raw_;
+  }
+
+  /** to_double: The value as a real number. Always exact.
+  */
+  constexpr double to_double() const {
+    return (double)value() * lsb;
+  }
+
+  /** to_float: The value as the nearest float; exact for formats of up to 24 bits.
+  */
+  float to_float() const {
+    uint32_t bits = fp_array_to_f32_bits(raw_, W, F, Signed);
+    float x;
+
+    std::memcpy(&x, &bits, sizeof(x));
+    return x;
+  }
+
+  /** format: The value as a decimal string, see fp_format().
+
+  @param digits, the number of fractional digits; the default is exact. More than
+  FP_MAX_FRAC_DIGITS are clamped to FP_MAX_FRAC_DIGITS.
+  */
+  std::string format(unsigned digits = F) const {
+    char buf[FP_FORMAT_MAX_LEN] = "";
+
+    if (digits > FP_MAX_FRAC_DIGITS) {
+      digits = FP_MAX_FRAC_DIGITS;
+    }
+    if (fp_format(buf, sizeof(buf), raw_, W, F, Signed, digits) < 0) {
+      return std::string();
+    }
+    return buf;
+  }
+
+  /** parse: Convert a decimal string, see fp_parse().
+
+  @returns 0, -EINVAL for a malformed string or -ERANGE if it doesn't fit the format.
+  */
+  static int parse(const std::string &s, fixed *out) {
+    uint64_t raw;
+    int ret = fp_parse(s.c_str(), s.size(), W, F, Signed, &raw);
+
+    if (ret == 0) {
+      *out = fixed((uint32_t)raw);
+    }
+    return ret;
+  }
+
+  friend constexpr bool operator==(fixed a, fixed b) {
+    return a.raw_ == b.raw_;
+  }
+
+  friend constexpr bool operator!=(fixed a, fixed b) {
+    return a.raw_ != b.raw_;
+  }
+
+private:
+  constexpr explicit fixed(uint32_t raw) : raw_(raw) {}
+
+  static constexpr int64_t clamp(int64_t value) {
+    return value < min_value ? min_value : value > max_value ? max_value : value;
+  }
+
+  uint32_t raw_;
+};
+
+/*-----------------------------------------------------------------------*/
+/* Formats used in the designs                                           */
+/*-----------------------------------------------------------------------*/
+using audio_sample = fixed<24, 23, true>;   // Avalon streaming audio
+using hanning_coeff = fixed<24, 22, false>; // fftAnalysisSynthesis Hanning window
+using fft_gain = fixed<16, 8, true>;        // fftAnalysisSynthesis filter gains
+using comb_gain = fixed<16, 16, true>;      // combFilter b0 and bM
+using comb_mix = fixed<16, 16, false>;      // combFilter wet/dry mix
+using comb_delay = fixed<16, 0, false>;     // combFilter delay M in samples
+using tpa_volume = fixed<32, 16, true>;     // tpa613a2 volume in dB
+
+}  // namespace fp
+
+#endif
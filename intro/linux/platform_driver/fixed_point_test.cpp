@@ -0,0 +1,111 @@
+/* SPDX-License-Identifier: GPL-2.0 or MIT                               */
+/*-------------------------------------------------------------------------
+ * Description:  Host-side test for fixed_point.hpp
+ * ------------------------------------------------------------------------
+ * The static_asserts check the constants and the constexpr conversions at
+ * compile time; main() checks from_double() against the run-time array
+ * conversions (which are checked against libm in fp_conversions_test.c)
+ * for every format the designs use.
+ *
+ * Build and run on the host (or on the HPS):
+ *   g++ -std=c++17 -O2 -Wall -o fixed_point_test fixed_point_test.cpp
+ *   ./fixed_point_test
+-------------------------------------------------------------------------*/
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include "fixed_point.hpp"
+
+using namespace fp;
+
+static_assert(audio_sample::mask == 0xFFFFFF, "24-bit mask");
+static_assert(audio_sample::max_value == 0x7FFFFF && audio_sample::min_value == -0x800000, "24-bit limits");
+static_assert(audio_sample::from_double(-1.0).raw() == 0x800000, "-1.0 is the most negative sample");
+static_assert(audio_sample::from_double(1.0).raw() == 0x7FFFFF, "1.0 saturates");
+static_assert(audio_sample::from_raw(0xC00000).to_double() == -0.5, "sign extension");
+static_assert(hanning_coeff::max == 4.0 - hanning_coeff::lsb, "24/22 range");
+static_assert(hanning_coeff::from_double(-0.1).raw() == 0, "unsigned formats saturate at zero");
+static_assert(comb_gain::from_double(0.25).raw() == 0x4000, "comb gain");
+static_assert(comb_gain::from_double(-0.5).raw() == 0x8000, "comb gain -0.5 is the most negative");
+static_assert(comb_mix::from_double(0.5).raw() == 0x8000, "wet/dry mix");
+static_assert(comb_delay::from_double(2.5).raw() == 2 && comb_delay::from_double(3.5).raw() == 4, "ties to even");
+static_assert(comb_delay::from_double(2.5, FP_ROUND_NEAREST_AWAY).raw() == 3, "ties away");
+static_assert(comb_delay::from_double(-0.5, FP_ROUND_FLOOR).raw() == 0, "floor saturates at zero");
+static_assert(fft_gain::from_double(1.5).raw() == 0x180, "fft gain");
+static_assert(tpa_volume::from_double(-0.3).value() == -19661, "tpa volume");
+static_assert(fixed<32, 32, false>::scale == 4294967296.0, "32-bit scale");
+static_assert(fixed<1, 0, true>::min == -1.0 && fixed<1, 0, true>::max == 0.0, "1-bit format");
+
+static unsigned long failures;
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t rng(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return rng_state;
+}
+
+/* from_double() against fp_array_from_f64_bits() in every rounding mode */
+template <typename T>
+static void check(const char *name)
+{
+	double x;
+	uint64_t bits;
+	uint32_t want;
+	bool saturated;
+	char buf[FP_FORMAT_MAX_LEN];
+	T back;
+	int i, mode;
+
+	for (i = 0; i < 200000; i++) {
+		x = (T::min - 4 * T::lsb) + (T::max - T::min + 8 * T::lsb) * (double)(rng() >> 11) * 0x1p-53;
+		if (i & 1) {
+			// Ties
+			x = ((double)(int64_t)(x * T::scale) + 0.5) * T::lsb;
+		}
+		std::memcpy(&bits, &x, sizeof(bits));
+		for (mode = FP_ROUND_NEAREST_EVEN; mode <= FP_ROUND_CEIL; mode++) {
+			want = fp_array_from_f64_bits(bits, T::width, T::frac_bits, T::is_signed,
+			                              (enum fp_round)mode, &saturated);
+			if (T::from_double(x, (enum fp_round)mode).raw() != want) {
+				if (failures++ < 20) {
+					printf("FAIL %s: %a mode %d got 0x%x want 0x%x\n", name, x, mode,
+					       T::from_double(x, (enum fp_round)mode).raw(), want);
+				}
+			}
+		}
+
+		T v = T::from_raw((uint32_t)rng());
+		if (T::parse(v.format(T::digits), &back) != 0 || back != v ||
+		    v.format(FP_MAX_FRAC_DIGITS + 1) != v.format(FP_MAX_FRAC_DIGITS) ||
+		    v.to_double() != (double)v.value() * T::lsb ||
+		    (T::width <= 24 && (double)v.to_float() != v.to_double())) {
+			fp_format(buf, sizeof(buf), v.raw(), T::width, T::frac_bits, T::is_signed, T::frac_bits);
+			if (failures++ < 20) {
+				printf("FAIL %s: 0x%x (%s) didn't convert back\n", name, v.raw(), buf);
+			}
+		}
+	}
+}
+
+int main(void)
+{
+	check<audio_sample>("audio_sample");
+	check<hanning_coeff>("hanning_coeff");
+	check<fft_gain>("fft_gain");
+	check<comb_gain>("comb_gain");
+	check<comb_mix>("comb_mix");
+	check<comb_delay>("comb_delay");
+	check<tpa_volume>("tpa_volume");
+	check<fixed<32, 32, false>>("fixed<32, 32, false>");
+	check<fixed<1, 0, true>>("fixed<1, 0, true>");
+
+	if (failures) {
+		printf("\n%lu failures\n", failures);
+		return 1;
+	}
+	printf("all fixed_point.hpp checks passed\n");
+	return 0;
+}
@@ -0,0 +1,751 @@
+/* SPDX-License-Identifier: GPL-2.0 or MIT */
+/*
+ * Fixed-point array conversion functions.
+ *
+ * Converts whole buffers of coefficients (filter taps, FFT gains, comb
+ * filter gains, ...) between IEEE-754 float/double and Q-format words.
+ * A Q-format word holds one fixed point number in its low W bits
+ * (1 <= W <= 32), the way the registers hold them; the upper bits are zero.
+ *
+ * The scalar code only uses integer arithmetic on the IEEE-754 bit
+ * patterns, so the kernel (which can't use the FPU without saving it) gets
+ * the same results as user-space. User-space builds use NEON on the ARM
+ * HPS and SSE2/AVX2 on x86 hosts for float buffers in formats of up to 24
+ * bits, where a float holds every value exactly; everything else takes the
+ * scalar path. The vector kernels give bit-identical results.
+ */
+
+#ifndef FP_ARRAY_CONVERSIONS_H
+#define FP_ARRAY_CONVERSIONS_H
+
+#ifdef __KERNEL__
+#include <linux/types.h>
+#include <linux/errno.h>
+#include <linux/string.h>
+#else
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define FP_ARRAY_NEON 1
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define FP_ARRAY_AVX2 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define FP_ARRAY_SSE2 1
+#endif
+#endif
+
+/* Widest Q format the array functions handle */
+#define FP_ARRAY_MAX_WIDTH 32
+
+/* Widest Q format the vector kernels handle; a float holds 24 significant bits */
+#define FP_ARRAY_SIMD_MAX_WIDTH 24
+
+/** enum fp_round: How values between two fixed point numbers are rounded.
+*/
+enum fp_round {
+  FP_ROUND_NEAREST_EVEN,  // to nearest, ties to even (IEEE-754 default, MATLAB convergent)
+  FP_ROUND_NEAREST_AWAY,  // to nearest, ties away from zero (MATLAB round)
+  FP_ROUND_ZERO,          // toward zero (C casts, MATLAB fix)
+  FP_ROUND_FLOOR,         // toward minus infinity (MATLAB floor, fi default overflow-free)
+  FP_ROUND_CEIL,          // toward plus infinity (MATLAB ceil)
+};
+
+/** fp_array_limits: Smallest and largest value of a Q format, as integers.
+*/
+static inline void fp_array_limits(unsigned int width, bool is_signed, int64_t *min, int64_t *max) {
+  if (is_signed) {
+    *min = -((int64_t)1 << (width - 1));
+    *max = ((int64_t)1 << (width - 1)) - 1;
+  } else {
+    *min = 0;
+    *max = ((int64_t)1 << width) - 1;
+  }
+}
+
+/** fp_array_round: Round sig * 2^shift to an integer and saturate it to a Q format.
+
+@param neg, the sign of the value.
+
+@param sig, the significand (at most 53 bits).
+
+@param shift, the binary exponent applied to sig, with the fractional bits already added in.
+
+@param min, max, the limits of the Q format (see fp_array_limits()).
+
+@param mode, the rounding mode.
+
+@param saturated, set to true if the value didn't fit and was saturated.
+
+@returns the rounded and saturated value.
+*/
+static inline int64_t fp_array_round(bool neg, uint64_t sig, int shift, int64_t min, int64_t max,
+                                     enum fp_round mode, bool *saturated) {
+  uint64_t q;
+  uint64_t r;
+  uint64_t half;
+  bool inexact;
+  bool up;
+  int64_t val;
+
+  *saturated = false;
+  if (sig == 0) {
+    return 0;
+  }
+
+  if (shift >= 0) {
+    // An integer; anything from 2^33 up is out of range of every format
+    if (shift > 33 || (sig >> (33 - shift)) != 0) {
+      *saturated = true;
+      return neg ? min : max;
+    }
+    q = sig << shift;
+    up = false;
+  } else if (shift <= -64) {
+    // Less than half an LSB (sig < 2^53), but not zero
+    q = 0;
+    up = (mode == FP_ROUND_FLOOR && neg) || (mode == FP_ROUND_CEIL && !neg);
+  } else {
+    q = sig >> -shift;
+    r = sig & (((uint64_t)1 << -shift) - 1);
+    half = (uint64_t)1 << (-shift - 1);
+    inexact = r != 0;
+    switch (mode) {
+    case FP_ROUND_NEAREST_EVEN:
+      up = r > half || (r == half && (q & 1));
+      break;
+    case FP_ROUND_NEAREST_AWAY:
+      up = r >= half;
+      break;
+    case FP_ROUND_FLOOR:
+      up = inexact && neg;
+      break;
+    case FP_ROUND_CEIL:
+      up = inexact && !neg;
+      break;
+    default:
+      up = false;
+      break;
+    }
+  }
+
+  // up rounds the magnitude away from zero
+  q += up;
+  val = neg ? -(int64_t)q : (int64_t)q;
+  if (val < min) {
+    *saturated = true;
+    return min;
+  }
+  if (val > max) {
+    *saturated = true;
+    return max;
+  }
+  return val;
+}
+
+/** fp_array_from_f32_bits: Convert one float, given as its bit pattern, to a Q-format word.
+
+NaN converts to 0 and counts as saturated; infinities saturate.
+
+@returns the Q-format word.
+*/
+static inline uint32_t fp_array_from_f32_bits(uint32_t bits, unsigned int width, unsigned int frac_bits,
+                                              bool is_signed, enum fp_round mode, bool *saturated) {
+  uint32_t e = (bits >> 23) & 0xFF;
+  uint32_t m = bits & 0x7FFFFF;
+  bool neg = bits >> 31;
+  int64_t min;
+  int64_t max;
+  int64_t val;
+
+  fp_array_limits(width, is_signed, &min, &max);
+  if (e == 0xFF) {
+    *saturated = true;
+    if (m) {
+      return 0;  // NaN
+    }
+    val = neg ? min : max;
+  } else if (e == 0) {
+    val = fp_array_round(neg, m, (int)frac_bits - 149, min, max, mode, saturated);
+  } else {
+    val = fp_array_round(neg, m | 0x800000, (int)e - 150 + (int)frac_bits, min, max, mode, saturated);
+  }
+  return (uint32_t)val & (uint32_t)(((uint64_t)1 << width) - 1);
+}
+
+/** fp_array_from_f64_bits: Convert one double, given as its bit pattern, to a Q-format word.
+
+NaN converts to 0 and counts as saturated; infinities saturate.
+
+@returns the Q-format word.
+*/
+static inline uint32_t fp_array_from_f64_bits(uint64_t bits, unsigned int width, unsigned int frac_bits,
+                                              bool is_signed, enum fp_round mode, bool *saturated) {
+  uint32_t e = (uint32_t)(bits >> 52) & 0x7FF;
+  uint64_t m = bits & 0xFFFFFFFFFFFFFULL;
+  bool neg = bits >> 63;
+  int64_t min;
+  int64_t max;
+  int64_t val;
+
+  fp_array_limits(width, is_signed, &min, &max);
+  if (e == 0x7FF) {
+    *saturated = true;
+    if (m) {
+      return 0;  // NaN
+    }
+    val = neg ? min : max;
+  } else if (e == 0) {
+    val = fp_array_round(neg, m, (int)frac_bits - 1074, min, max, mode, saturated);
+  } else {
+    val = fp_array_round(neg, m | (1ULL << 52), (int)e - 1075 + (int)frac_bits, min, max, mode,
+                         saturated);
+  }
+  return (uint32_t)val & (uint32_t)(((uint64_t)1 << width) - 1);
+}
+
+/** fp_array_value: Sign-extend a Q-format word into the integer it holds.
+*/
+static inline int64_t fp_array_value(uint32_t word, unsigned int width, bool is_signed) {
+  uint64_t v = word & (((uint64_t)1 << width) - 1);
+
+  if (is_signed && ((v >> (width - 1)) & 1)) {
+    return (int64_t)v - ((int64_t)1 << width);
+  }
+  return (int64_t)v;
+}
+
+/** fp_array_msb: Index of the most significant set bit of a non-zero value.
+*/
+static inline int fp_array_msb(uint64_t v) {
+  return 63 - __builtin_clzll(v);
+}
+
+/** fp_array_to_f32_bits: Convert one Q-format word to the bit pattern of the nearest float.
+
+Formats of up to 24 bits convert exactly; wider ones round to nearest, ties to even.
+*/
+static inline uint32_t fp_array_to_f32_bits(uint32_t word, unsigned int width, unsigned int frac_bits,
+                                            bool is_signed) {
+  int64_t v = fp_array_value(word, width, is_signed);
+  uint32_t sign = v < 0 ? 0x80000000U : 0;
+  uint64_t q = v < 0 ? (uint64_t)-v : (uint64_t)v;
+  uint64_t r;
+  uint64_t half;
+  int msb;
+  int e;
+  int shift;
+
+  if (q == 0) {
+    return 0;
+  }
+
+  // |v| <= 2^32 and frac_bits <= 32, so the result is always a normal float
+  msb = fp_array_msb(q);
+  e = msb - (int)frac_bits + 127;
+  if (msb <= 23) {
+    q <<= 23 - msb;
+  } else {
+    shift = msb - 23;
+    r = q & (((uint64_t)1 << shift) - 1);
+    half = (uint64_t)1 << (shift - 1);
+    q >>= shift;
+    if (r > half || (r == half && (q & 1))) {
+      q++;
+      if (q >> 24) {
+        q >>= 1;
+        e++;
+      }
+    }
+  }
+  return sign | ((uint32_t)e << 23) | ((uint32_t)q & 0x7FFFFF);
+}
+
+/** fp_array_to_f64_bits: Convert one Q-format word to the bit pattern of the equal double.
+
+Every Q format of up to 32 bits converts exactly.
+*/
+static inline uint64_t fp_array_to_f64_bits(uint32_t word, unsigned int width, unsigned int frac_bits,
+                                            bool is_signed) {
+  int64_t v = fp_array_value(word, width, is_signed);
+  uint64_t sign = v < 0 ? 1ULL << 63 : 0;
+  uint64_t q = v < 0 ? (uint64_t)-v : (uint64_t)v;
+  int msb;
+
+  if (q == 0) {
+    return 0;
+  }
+
+  msb = fp_array_msb(q);
+  q <<= 52 - msb;
+  return sign | ((uint64_t)(msb - (int)frac_bits + 1023) << 52) | (q & 0xFFFFFFFFFFFFFULL);
+}
+
+/** fp_array_format_ok: Check a Q format for the array functions.
+*/
+static inline bool fp_array_format_ok(unsigned int width, unsigned int frac_bits) {
+  return width >= 1 && width <= FP_ARRAY_MAX_WIDTH && frac_bits <= width;
+}
+
+/*-----------------------------------------------------------------------*/
+/* Scalar array conversions                                              */
+/*-----------------------------------------------------------------------*/
+/** fp_array_from_f32_scalar: Convert floats (as bit patterns) to Q-format words, one at a time.
+
+@param dst, the Q-format words.
+
+@param src, the floats' bit patterns; may be a float array.
+
+@param n, the number of values.
+
+@param width, the total number of bits in the format (1..32), including the sign bit.
+
+@param frac_bits, the number of fractional bits (0..width).
+
+@param is_signed, whether the format is two's complement.
+
+@param mode, the rounding mode.
+
+@returns the number of values that were saturated (or NaN), or -EINVAL for a bad format.
+*/
+static inline long fp_array_from_f32_scalar(uint32_t *dst, const void *src, size_t n,
+                                            unsigned int width, unsigned int frac_bits,
+                                            bool is_signed, enum fp_round mode) {
+  const unsigned char *p = (const unsigned char *)src;
+  long saturated = 0;
+  uint32_t bits;
+  bool sat;
+  size_t i;
+
+  if (!fp_array_format_ok(width, frac_bits)) {
+    return -EINVAL;
+  }
+  for (i = 0; i < n; i++) {
+    memcpy(&bits, p + i * sizeof(bits), sizeof(bits));
+    dst[i] = fp_array_from_f32_bits(bits, width, frac_bits, is_signed, mode, &sat);
+    saturated += sat;
+  }
+  return saturated;
+}
+
+/** fp_array_to_f32_scalar: Convert Q-format words to floats (as bit patterns), one at a time.
+
+@param dst, the floats' bit patterns; may be a float array.
+
+@returns 0, or -EINVAL for a bad format.
+*/
+static inline long fp_array_to_f32_scalar(void *dst, const uint32_t *src, size_t n,
+                                          unsigned int width, unsigned int frac_bits, bool is_signed) {
+  unsigned char *p = (unsigned char *)dst;
+  uint32_t bits;
+  size_t i;
+
+  if (!fp_array_format_ok(width, frac_bits)) {
+    return -EINVAL;
+  }
+  for (i = 0; i < n; i++) {
+    bits = fp_array_to_f32_bits(src[i], width, frac_bits, is_signed);
+    memcpy(p + i * sizeof(bits), &bits, sizeof(bits));
+  }
+  return 0;
+}
+
+/*-----------------------------------------------------------------------*/
+/* Vector kernels (user-space only)                                      */
+/*-----------------------------------------------------------------------*/
+/*
+ * The float -> Q kernels scale by 2^F (exact), clamp to +-2^30 so the
+ * conversion can't overflow, truncate toward zero and then fix up the
+ * result for the rounding mode from the (exact) fractional part. Vectors
+ * holding a NaN or a denormal (which NEON flushes to zero) are handed to
+ * the scalar code, so the results match it bit for bit. The caller
+ * converts any tail that doesn't fill a vector.
+ */
+#if defined(FP_ARRAY_NEON)
+
+#define FP_ARRAY_LANES 4
+
+static inline long fp_array_from_f32_simd(uint32_t *dst, const void *src, size_t n,
+                                          unsigned int width, unsigned int frac_bits,
+                                          bool is_signed, enum fp_round mode) {
+  const unsigned char *p = (const unsigned char *)src;
+  int64_t min;
+  int64_t max;
+  const float32x4_t scale = vdupq_n_f32((float)((uint64_t)1 << frac_bits));
+  const float32x4_t big = vdupq_n_f32(1073741824.0f);
+  const float32x4_t halfv = vdupq_n_f32(0.5f);
+  const float32x4_t zero = vdupq_n_f32(0.0f);
+  const int32_t tiny = 0x00800000;
+  int32x4_t vmin;
+  int32x4_t vmax;
+  uint32x4_t wmask = vdupq_n_u32((uint32_t)(((uint64_t)1 << width) - 1));
+  uint32x4_t satv = vdupq_n_u32(0);
+  long saturated = 0;
+  size_t i;
+
+  fp_array_limits(width, is_signed, &min, &max);
+  vmin = vdupq_n_s32((int32_t)min);
+  vmax = vdupq_n_s32((int32_t)max);
+
+  for (i = 0; i + 4 <= n; i += 4) {
+    uint32x4_t bits = vld1q_u32((const uint32_t *)(const void *)(p + i * 4));
+    int32x4_t mag = vreinterpretq_s32_u32(vandq_u32(bits, vdupq_n_u32(0x7FFFFFFF)));
+    uint32x4_t special = vorrq_u32(vcgtq_s32(mag, vdupq_n_s32(0x7F800000)),
+                                   vandq_u32(vcgtq_s32(mag, vdupq_n_s32(0)),
+                                             vcltq_s32(mag, vdupq_n_s32(tiny))));
+    uint32x2_t any = vorr_u32(vget_low_u32(special), vget_high_u32(special));
+    float32x4_t y;
+    float32x4_t f;
+    int32x4_t t;
+    uint32x4_t up;
+    uint32x4_t down;
+    uint32x4_t odd;
+    uint32x4_t sat;
+
+    if (vget_lane_u32(vpmax_u32(any, any), 0)) {
+      saturated += fp_array_from_f32_scalar(dst + i, p + i * 4, 4, width, frac_bits, is_signed, mode);
+      continue;
+    }
+
+    y = vmulq_f32(vreinterpretq_f32_u32(bits), scale);
+    y = vminq_f32(vmaxq_f32(y, vnegq_f32(big)), big);
+    t = vcvtq_s32_f32(y);
+    f = vsubq_f32(y, vcvtq_f32_s32(t));
+    odd = vtstq_s32(t, vdupq_n_s32(1));
+
+    switch (mode) {
+    case FP_ROUND_NEAREST_EVEN:
+      up = vorrq_u32(vcgtq_f32(f, halfv), vandq_u32(vceqq_f32(f, halfv), odd));
+      down = vorrq_u32(vcltq_f32(f, vnegq_f32(halfv)),
+                       vandq_u32(vceqq_f32(f, vnegq_f32(halfv)), odd));
+      break;
+    case FP_ROUND_NEAREST_AWAY:
+      up = vcgeq_f32(f, halfv);
+      down = vcleq_f32(f, vnegq_f32(halfv));
+      break;
+    case FP_ROUND_FLOOR:
+      up = vdupq_n_u32(0);
+      down = vcltq_f32(f, zero);
+      break;
+    case FP_ROUND_CEIL:
+      up = vcgtq_f32(f, zero);
+      down = vdupq_n_u32(0);
+      break;
+    default:
+      up = vdupq_n_u32(0);
+      down = vdupq_n_u32(0);
+      break;
+    }
+    // The masks are all ones (-1) where the lane is adjusted
+    t = vaddq_s32(vsubq_s32(t, vreinterpretq_s32_u32(up)), vreinterpretq_s32_u32(down));
+
+    sat = vorrq_u32(vcgtq_s32(t, vmax), vcltq_s32(t, vmin));
+    satv = vsubq_u32(satv, sat);
+    t = vminq_s32(vmaxq_s32(t, vmin), vmax);
+    vst1q_u32(dst + i, vandq_u32(vreinterpretq_u32_s32(t), wmask));
+  }
+
+  return saturated + (long)vgetq_lane_u32(satv, 0) + vgetq_lane_u32(satv, 1) +
+         vgetq_lane_u32(satv, 2) + vgetq_lane_u32(satv, 3);
+}
+
+static inline void fp_array_to_f32_simd(void *dst, const uint32_t *src, size_t n,
+                                        unsigned int width, unsigned int frac_bits, bool is_signed) {
+  unsigned char *p = (unsigned char *)dst;
+  const float32x4_t scale = vdupq_n_f32(1.0f / (float)((uint64_t)1 << frac_bits));
+  const int32x4_t up = vdupq_n_s32(32 - (int)width);
+  const int32x4_t down = vdupq_n_s32((int)width - 32);
+  size_t i;
+
+  for (i = 0; i + 4 <= n; i += 4) {
+    uint32x4_t w = vshlq_u32(vld1q_u32(src + i), up);
+    int32x4_t v = is_signed ? vshlq_s32(vreinterpretq_s32_u32(w), down)
+                            : vreinterpretq_s32_u32(vshlq_u32(w, down));
+    vst1q_f32((float *)(void *)(p + i * 4), vmulq_f32(vcvtq_f32_s32(v), scale));
+  }
+}
+
+#elif defined(FP_ARRAY_AVX2) || defined(FP_ARRAY_SSE2)
+
+#if defined(FP_ARRAY_AVX2)
+#define FP_ARRAY_LANES 8
+typedef __m256 fp_vf;
+typedef __m256i fp_vi;
+#define fp_vf_set1 _mm256_set1_ps
+#define fp_vi_set1 _mm256_set1_epi32
+#define fp_vi_load(p) _mm256_loadu_si256((const __m256i *)(const void *)(p))
+#define fp_vi_store(p, v) _mm256_storeu_si256((__m256i *)(void *)(p), v)
+#define fp_vf_store(p, v) _mm256_storeu_ps((float *)(void *)(p), v)
+#define fp_vi_as_vf _mm256_castsi256_ps
+#define fp_vf_as_vi _mm256_castps_si256
+#define fp_vf_mul _mm256_mul_ps
+#define fp_vf_sub _mm256_sub_ps
+#define fp_vf_min _mm256_min_ps
+#define fp_vf_max _mm256_max_ps
+#define fp_vf_gt(a, b) fp_vf_as_vi(_mm256_cmp_ps(a, b, _CMP_GT_OQ))
+#define fp_vf_ge(a, b) fp_vf_as_vi(_mm256_cmp_ps(a, b, _CMP_GE_OQ))
+#define fp_vf_eq(a, b) fp_vf_as_vi(_mm256_cmp_ps(a, b, _CMP_EQ_OQ))
+#define fp_vf_lt(a, b) fp_vf_as_vi(_mm256_cmp_ps(a, b, _CMP_LT_OQ))
+#define fp_vf_le(a, b) fp_vf_as_vi(_mm256_cmp_ps(a, b, _CMP_LE_OQ))
+#define fp_vf_from_vi _mm256_cvtepi32_ps
+#define fp_vi_trunc _mm256_cvttps_epi32
+#define fp_vi_and _mm256_and_si256
+#define fp_vi_or _mm256_or_si256
+#define fp_vi_andnot _mm256_andnot_si256
+#define fp_vi_add _mm256_add_epi32
+#define fp_vi_sub _mm256_sub_epi32
+#define fp_vi_gt _mm256_cmpgt_epi32
+#define fp_vi_eq _mm256_cmpeq_epi32
+#define fp_vi_sll(v, n) _mm256_sll_epi32(v, _mm_cvtsi32_si128(n))
+#define fp_vi_srl(v, n) _mm256_srl_epi32(v, _mm_cvtsi32_si128(n))
+#define fp_vi_sra(v, n) _mm256_sra_epi32(v, _mm_cvtsi32_si128(n))
+#define fp_vi_any(v) (_mm256_movemask_epi8(v) != 0)
+#define fp_vi_count(v) __builtin_popcount(_mm256_movemask_ps(fp_vi_as_vf(v)))
+#define fp_vi_zero _mm256_setzero_si256
+#else
+#define FP_ARRAY_LANES 4
+typedef __m128 fp_vf;
+typedef __m128i fp_vi;
+#define fp_vf_set1 _mm_set1_ps
+#define fp_vi_set1 _mm_set1_epi32
+#define fp_vi_load(p) _mm_loadu_si128((const __m128i *)(const void *)(p))
+#define fp_vi_store(p, v) _mm_storeu_si128((__m128i *)(void *)(p), v)
+#define fp_vf_store(p, v) _mm_storeu_ps((float *)(void *)(p), v)
+#define fp_vi_as_vf _mm_castsi128_ps
+#define fp_vf_as_vi _mm_castps_si128
+#define fp_vf_mul _mm_mul_ps
+#define fp_vf_sub _mm_sub_ps
+#define fp_vf_min _mm_min_ps
+#define fp_vf_max _mm_max_ps
+#define fp_vf_gt(a, b) fp_vf_as_vi(_mm_cmpgt_ps(a, b))
+#define fp_vf_ge(a, b) fp_vf_as_vi(_mm_cmpge_ps(a, b))
+#define fp_vf_eq(a, b) fp_vf_as_vi(_mm_cmpeq_ps(a, b))
+#define fp_vf_lt(a, b) fp_vf_as_vi(_mm_cmplt_ps(a, b))
+#define fp_vf_le(a, b) fp_vf_as_vi(_mm_cmple_ps(a, b))
+#define fp_vf_from_vi _mm_cvtepi32_ps
+#define fp_vi_trunc _mm_cvttps_epi32
+#define fp_vi_and _mm_and_si128
+#define fp_vi_or _mm_or_si128
+#define fp_vi_andnot _mm_andnot_si128
+#define fp_vi_add _mm_add_epi32
+#define fp_vi_sub _mm_sub_epi32
+#define fp_vi_gt _mm_cmpgt_epi32
+#define fp_vi_eq _mm_cmpeq_epi32
+#define fp_vi_sll(v, n) _mm_sll_epi32(v, _mm_cvtsi32_si128(n))
+#define fp_vi_srl(v, n) _mm_srl_epi32(v, _mm_cvtsi32_si128(n))
+#define fp_vi_sra(v, n) _mm_sra_epi32(v, _mm_cvtsi32_si128(n))
+#define fp_vi_any(v) (_mm_movemask_epi8(v) != 0)
+#define fp_vi_count(v) __builtin_popcount(_mm_movemask_ps(fp_vi_as_vf(v)))
+#define fp_vi_zero _mm_setzero_si128
+#endif
+
+/* Select a where mask is set, b elsewhere */
+#define fp_vi_select(mask, a, b) fp_vi_or(fp_vi_and(mask, a), fp_vi_andnot(mask, b))
+
+static inline long fp_array_from_f32_simd(uint32_t *dst, const void *src, size_t n,
+                                          unsigned int width, unsigned int frac_bits,
+                                          bool is_signed, enum fp_round mode) {
+  const unsigned char *p = (const unsigned char *)src;
+  int64_t min;
+  int64_t max;
+  const fp_vf scale = fp_vf_set1((float)((uint64_t)1 << frac_bits));
+  const fp_vf big = fp_vf_set1(1073741824.0f);
+  const fp_vf nbig = fp_vf_set1(-1073741824.0f);
+  const fp_vf halfv = fp_vf_set1(0.5f);
+  const fp_vf nhalfv = fp_vf_set1(-0.5f);
+  const fp_vf zero = fp_vf_set1(0.0f);
+  const fp_vi one = fp_vi_set1(1);
+  const fp_vi absmask = fp_vi_set1(0x7FFFFFFF);
+  const fp_vi inf = fp_vi_set1(0x7F800000);
+  const fp_vi tiny = fp_vi_set1(0x00800000);
+  const fp_vi wmask = fp_vi_set1((int32_t)(((uint64_t)1 << width) - 1));
+  fp_vi vmin;
+  fp_vi vmax;
+  long saturated = 0;
+  size_t i;
+
+  fp_array_limits(width, is_signed, &min, &max);
+  vmin = fp_vi_set1((int32_t)min);
+  vmax = fp_vi_set1((int32_t)max);
+
+  for (i = 0; i + FP_ARRAY_LANES <= n; i += FP_ARRAY_LANES) {
+    fp_vi bits = fp_vi_load(p + i * 4);
+    fp_vi mag = fp_vi_and(bits, absmask);
+    fp_vi special = fp_vi_or(fp_vi_gt(mag, inf),
+                             fp_vi_andnot(fp_vi_eq(mag, fp_vi_zero()), fp_vi_gt(tiny, mag)));
+    fp_vf y;
+    fp_vf f;
+    fp_vi t;
+    fp_vi up;
+    fp_vi down;
+    fp_vi odd;
+    fp_vi sat;
+
+    if (fp_vi_any(special)) {
+      saturated += fp_array_from_f32_scalar(dst + i, p + i * 4, FP_ARRAY_LANES, width, frac_bits,
+                                            is_signed, mode);
+      continue;
+    }
+
+    y = fp_vf_mul(fp_vi_as_vf(bits), scale);
+    y = fp_vf_min(fp_vf_max(y, nbig), big);
+    t = fp_vi_trunc(y);
+    f = fp_vf_sub(y, fp_vf_from_vi(t));
+    odd = fp_vi_eq(fp_vi_and(t, one), one);
+
+    switch (mode) {
+    case FP_ROUND_NEAREST_EVEN:
+      up = fp_vi_or(fp_vf_gt(f, halfv), fp_vi_and(fp_vf_eq(f, halfv), odd));
+      down = fp_vi_or(fp_vf_lt(f, nhalfv), fp_vi_and(fp_vf_eq(f, nhalfv), odd));
+      break;
+    case FP_ROUND_NEAREST_AWAY:
+      up = fp_vf_ge(f, halfv);
+      down = fp_vf_le(f, nhalfv);
+      break;
+    case FP_ROUND_FLOOR:
+      up = fp_vi_zero();
+      down = fp_vf_lt(f, zero);
+      break;
+    case FP_ROUND_CEIL:
+      up = fp_vf_gt(f, zero);
+      down = fp_vi_zero();
+      break;
+    default:
+      up = fp_vi_zero();
+      down = fp_vi_zero();
+      break;
+    }
+    // The masks are all ones (-1) where the lane is adjusted
+    t = fp_vi_add(fp_vi_sub(t, up), down);
+
+    sat = fp_vi_or(fp_vi_gt(t, vmax), fp_vi_gt(vmin, t));
+    saturated += fp_vi_count(sat);
+    t = fp_vi_select(fp_vi_gt(t, vmax), vmax, t);
+    t = fp_vi_select(fp_vi_gt(vmin, t), vmin, t);
+    fp_vi_store(dst + i, fp_vi_and(t, wmask));
+  }
+
+  return saturated;
+}
+
+static inline void fp_array_to_f32_simd(void *dst, const uint32_t *src, size_t n,
+                                        unsigned int width, unsigned int frac_bits, bool is_signed) {
+  unsigned char *p = (unsigned char *)dst;
+  const fp_vf scale = fp_vf_set1(1.0f / (float)((uint64_t)1 << frac_bits));
+  size_t i;
+
+  for (i = 0; i + FP_ARRAY_LANES <= n; i += FP_ARRAY_LANES) {
+    fp_vi w = fp_vi_sll(fp_vi_load(src + i), 32 - (int)width);
+    fp_vi v = is_signed ? fp_vi_sra(w, 32 - (int)width) : fp_vi_srl(w, 32 - (int)width);
+
+    fp_vf_store(p + i * 4, fp_vf_mul(fp_vf_from_vi(v), scale));
+  }
+}
+
+#endif
+
+/*-----------------------------------------------------------------------*/
+/* Array conversions                                                     */
+/*-----------------------------------------------------------------------*/
+/** fp_array_from_f32: Convert floats (as bit patterns) to Q-format words.
+
+Same as fp_array_from_f32_scalar(), but uses the vector kernels where they apply.
+
+@returns the number of values that were saturated (or NaN), or -EINVAL for a bad format.
+*/
+static inline long fp_array_from_f32(uint32_t *dst, const void *src, size_t n, unsigned int width,
+                                     unsigned int frac_bits, bool is_signed, enum fp_round mode) {
+  long saturated = 0;
+  size_t done = 0;
+
+  if (!fp_array_format_ok(width, frac_bits)) {
+    return -EINVAL;
+  }
+#ifdef FP_ARRAY_LANES
+  if (width <= FP_ARRAY_SIMD_MAX_WIDTH) {
+    done = n - n % FP_ARRAY_LANES;
+    saturated = fp_array_from_f32_simd(dst, src, done, width, frac_bits, is_signed, mode);
+  }
+#endif
+  return saturated + fp_array_from_f32_scalar(dst + done, (const unsigned char *)src + done * 4,
+                                              n - done, width, frac_bits, is_signed, mode);
+}
+
+/** fp_array_to_f32: Convert Q-format words to floats (as bit patterns).
+
+Same as fp_array_to_f32_scalar(), but uses the vector kernels where they apply.
+
+@returns 0, or -EINVAL for a bad format.
+*/
+static inline long fp_array_to_f32(void *dst, const uint32_t *src, size_t n, unsigned int width,
+                                   unsigned int frac_bits, bool is_signed) {
+  size_t done = 0;
+
+  if (!fp_array_format_ok(width, frac_bits)) {
+    return -EINVAL;
+  }
+#ifdef FP_ARRAY_LANES
+  if (width <= FP_ARRAY_SIMD_MAX_WIDTH) {
+    done = n - n % FP_ARRAY_LANES;
+    fp_array_to_f32_simd(dst, src, done, width, frac_bits, is_signed);
+  }
+#endif
+  return fp_array_to_f32_scalar((unsigned char *)dst + done * 4, src + done, n - done, width,
+                                frac_bits, is_signed);
+}
+
+/** fp_array_from_f64: Convert doubles (as bit patterns) to Q-format words.
+
+ARMv7 NEON has no double lanes, so this is always the scalar code.
+
+@param src, the doubles' bit patterns; may be a double array.
+
+@returns the number of values that were saturated (or NaN), or -EINVAL for a bad format.
+*/
+static inline long fp_array_from_f64(uint32_t *dst, const void *src, size_t n, unsigned int width,
+                                     unsigned int frac_bits, bool is_signed, enum fp_round mode) {
+  const unsigned char *p = (const unsigned char *)src;
+  long saturated = 0;
+  uint64_t bits;
+  bool sat;
+  size_t i;
+
+  if (!fp_array_format_ok(width, frac_bits)) {
+    return -EINVAL;
+  }
+  for (i = 0; i < n; i++) {
+    memcpy(&bits, p + i * sizeof(bits), sizeof(bits));
+    dst[i] = fp_array_from_f64_bits(bits, width, frac_bits, is_signed, mode, &sat);
+    saturated += sat;
+  }
+  return saturated;
+}
+
+/** fp_array_to_f64: Convert Q-format words to doubles (as bit patterns). Always exact.
+
+@param dst, the doubles' bit patterns; may be a double array.
+
+@returns 0, or -EINVAL for a bad format.
+*/
+static inline long fp_array_to_f64(void *dst, const uint32_t *src, size_t n, unsigned int width,
+                                   unsigned int frac_bits, bool is_signed) {
+  unsigned char *p = (unsigned char *)dst;
+  uint64_t bits;
+  size_t i;
+
+  if (!fp_array_format_ok(width, frac_bits)) {
+    return -EINVAL;
+  }
+  for (i = 0; i < n; i++) {
+    bits = fp_array_to_f64_bits(src[i], width, frac_bits, is_signed);
+    memcpy(p + i * sizeof(bits), &bits, sizeof(bits));
+  }
+  return 0;
+}
+
+#endif
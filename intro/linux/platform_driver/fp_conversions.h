@@ -8,13 +8,47 @@
 #ifndef FP_CONVERSIONS_H
 #define FP_CONVERSIONS_H
 
+#ifdef __KERNEL__
 #include <linux/types.h>
 #include <linux/err.h>
 #include <linux/string.h>
+#else
+/* The same functions are used by host-side tools and tests */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#endif
 
 
 #define ARBITRARY_CUTOFF_LEN 9
 
+/* Widest fixed-point format fp_format() and fp_parse() handle */
+#define FP_MAX_WIDTH 64
+
+/* Most fractional digits fp_format() prints; an F-bit fraction has exactly F decimal digits */
+#define FP_MAX_FRAC_DIGITS 64
+
+/* fp_parse() keeps the fraction in base 10^9 limbs of 9 digits each */
+#define FP_LIMB_DIGITS 9
+#define FP_LIMB_BASE 1000000000U
+#define FP_PARSE_LIMBS 8
+
+/* Two limbs as one 64-bit word; fp_parse() uses it for up to 18 fractional digits */
+#define FP_PARSE_WORD_BASE 1000000000000000000ULL
+
+/* Fractional digits fp_parse() keeps; later digits only matter for rounding ties.
+   Every rounding boundary of a 64-bit format has at most 65 digits. */
+#define FP_PARSE_FRAC_DIGITS (FP_PARSE_LIMBS * FP_LIMB_DIGITS)
+
+/* Longest string fp_format() produces, including sign, point and NUL */
+#define FP_FORMAT_MAX_LEN (1 + 20 + 1 + FP_MAX_FRAC_DIGITS + 1)
+
+/* Fewest fractional digits that make fp_format() -> fp_parse() give back the same value
+   for a format with F fractional bits: floor(F * log10(2)) + 1 */
+#define FP_ROUNDTRIP_DIGITS(F) ((((F) * 1233) >> 12) + 1)
+
 /** fp_to_str: Based off Ray's fp_to_string. Turns a uint32_t interpreted as a fixed point into a string.
 
 @param buf, buffer in which to fill the string. It is assumed to have enough space. If a buflen parameter were passed it would
@@ -28,8 +62,10 @@ is a sensible number. i.e. less than 32, more than 0.
 @param is_signed, whether or not to interpret the first bit as a sign. If true, the first bit is inspected then dumped.
 
 @returns the length of the buffered string.
+
+New code should use fp_format(), which is exact and checks the buffer length.
 */
-int fp_to_str(char * buf, uint32_t fp_num, size_t fractional_bits, bool is_signed) {
+static inline int fp_to_str(char * buf, uint32_t fp_num, size_t fractional_bits, bool is_signed) {
   int buf_index = 0;
   int int_mag = 1;
   int int_part;
@@ -84,8 +120,10 @@ int fp_to_str(char * buf, uint32_t fp_num, size_t fractional_bits, bool is_signe
 @param is_signed, whether or not to interpret the string as a signed or not.
 
 @returns returns a uint32_t that is a fixed point representation based on the num_fractional_bits and is_signed params.
+
+New code should use fp_parse(), which rounds correctly and reports errors.
 */
-uint32_t str_to_fp(const char * s, int num_fractional_bits, bool is_signed, size_t size) {
+static inline uint32_t str_to_fp(const char * s, int num_fractional_bits, bool is_signed, size_t size) {
   int int_part_decimal = 0;
   int frac_part_decimal = 0;
   int frac_len = 0;
@@ -158,4 +196,383 @@ uint32_t str_to_fp(const char * s, int num_fractional_bits, bool is_signed, size
   return accumulator;
 }
 
+/** fp_mask: Mask with the low n bits set. Works for n = 0..64.
+*/
+static inline uint64_t fp_mask(unsigned int n) {
+  return n >= 64 ? ~(uint64_t)0 : ((uint64_t)1 << n) - 1;
+}
+
+/** fp_mul10_frac: Multiply an n-bit binary fraction by ten.
+
+The product is formed from 32x32-bit multiplies, so there is no 128-bit type or division involved.
+
+@param frac, the fraction; replaced by the fractional part of the product.
+
+@param n, the number of bits in the fraction (0..64).
+
+@returns the decimal digit that moved past the point.
+*/
+static inline uint32_t fp_mul10_frac(uint64_t *frac, unsigned int n) {
+  uint64_t lo = (uint64_t)(uint32_t)*frac * 10;
+  uint64_t mid = (*frac >> 32) * 10 + (lo >> 32);
+  uint64_t prod_hi = mid >> 32;                        // bits 64..67 of the product
+  uint64_t prod_lo = (mid << 32) | (uint32_t)lo;       // bits 0..63 of the product
+
+  if (n == 0) {
+    *frac = 0;
+    return 0;
+  }
+  if (n == 64) {
+    *frac = prod_lo;
+    return (uint32_t)prod_hi;
+  }
+  *frac = prod_lo & fp_mask(n);
+  return (uint32_t)((prod_hi << (64 - n)) | (prod_lo >> n));
+}
+
+/** fp_format: Turns a fixed point number into a correctly rounded decimal string.
+
+Handles any format up to 64 bits. The number is rounded to the given number of fractional digits
+(round half to even), so the result is the decimal number closest to the fixed point value.
+Every digit costs a fixed number of multiplies, compares and subtractions; there are no divisions.
+Up to 60 fractional bits each digit takes one 64-bit multiply (up to 28 bits, a 32-bit one), and an
+integer part that fits 32 bits is printed with divisions by the constant ten, which compile to
+multiplies.
+
+@param buf, buffer in which to fill the string. Nothing is written past buflen bytes.
+
+@param buflen, the size of buf. FP_FORMAT_MAX_LEN is always enough.
+
+@param raw, the fixed point number in its low width bits; higher bits are ignored.
+
+@param width, the total number of bits in the format (1..64), including the sign bit.
+
+@param frac_bits, the number of fractional bits (0..width).
+
+@param is_signed, whether the format is two's complement.
+
+@param digits, the number of fractional digits to print (0..FP_MAX_FRAC_DIGITS). With 0 no point is
+printed. FP_ROUNDTRIP_DIGITS(frac_bits) is enough to parse back the same number, frac_bits gives the
+exact value.
+
+@returns the length of the string (without the NUL), -EINVAL for a bad format, or -ENOSPC if buf is
+too small.
+*/
+static inline int fp_format(char *buf, size_t buflen, uint64_t raw, unsigned int width,
+                            unsigned int frac_bits, bool is_signed, unsigned int digits) {
+  static const uint64_t pow10[20] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+    10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL,
+  };
+  uint8_t frac[FP_MAX_FRAC_DIGITS];
+  char int_buf[10];
+  uint64_t mag;
+  uint64_t int_part;
+  uint64_t frac_part;
+  uint64_t frac_mask;
+  uint64_t half;
+  uint64_t p;
+  uint32_t frac32;
+  uint32_t frac32_mask;
+  uint32_t int32;
+  bool neg = false;
+  bool round_up = false;
+  unsigned int int_digits;
+  unsigned int len = 0;
+  unsigned int i;
+  unsigned int d;
+
+  if (width == 0 || width > FP_MAX_WIDTH || frac_bits > width || digits > FP_MAX_FRAC_DIGITS) {
+    return -EINVAL;
+  }
+
+  // Split the magnitude into its integer and fractional parts
+  mag = raw & fp_mask(width);
+  if (is_signed && ((mag >> (width - 1)) & 1)) {
+    neg = true;
+    mag = (~mag + 1) & fp_mask(width);  // the most negative number's magnitude still fits
+  }
+  int_part = frac_bits == 64 ? 0 : mag >> frac_bits;
+  frac_mask = fp_mask(frac_bits);
+  frac_part = mag & frac_mask;
+
+  // Fractional digits: multiply by ten and take the digit that moves past the point. Up to 60
+  // fractional bits ten times the fraction still fits 64 bits, up to 28 bits it fits 32.
+  if (frac_bits <= 28) {
+    frac32 = (uint32_t)frac_part;
+    frac32_mask = (uint32_t)frac_mask;
+    for (i = 0; i < digits; i++) {
+      frac32 *= 10;
+      frac[i] = (uint8_t)(frac32 >> frac_bits);
+      frac32 &= frac32_mask;
+    }
+    frac_part = frac32;
+  } else if (frac_bits <= 60) {
+    for (i = 0; i < digits; i++) {
+      frac_part *= 10;
+      frac[i] = (uint8_t)(frac_part >> frac_bits);
+      frac_part &= frac_mask;
+    }
+  } else {
+    for (i = 0; i < digits; i++) {
+      frac[i] = (uint8_t)fp_mul10_frac(&frac_part, frac_bits);
+    }
+  }
+
+  // What's left decides the rounding of the last digit
+  if (frac_bits > 0) {
+    half = (uint64_t)1 << (frac_bits - 1);
+    round_up = frac_part > half ||
+               (frac_part == half && ((digits ? frac[digits - 1] : int_part) & 1));
+  }
+  for (i = digits; round_up && i > 0; i--) {
+    if (frac[i - 1] == 9) {
+      frac[i - 1] = 0;
+    } else {
+      frac[i - 1]++;
+      round_up = false;
+    }
+  }
+  if (round_up) {
+    int_part++;  // can't overflow; with fractional bits int_part < 2^63
+  }
+
+  // Integer parts that fit 32 bits are split into digits from the right, without branching on
+  // the value of each digit
+  int_digits = 0;
+  if (int_part <= 0xFFFFFFFFU) {
+    int32 = (uint32_t)int_part;
+    do {
+      int_buf[int_digits++] = (char)('0' + int32 % 10);
+      int32 /= 10;
+    } while (int32);
+  } else {
+    int_digits = 10;
+    while (int_digits < 20 && int_part >= pow10[int_digits]) {
+      int_digits++;
+    }
+  }
+
+  if (buflen < neg + int_digits + (digits ? 1 + digits : 0) + 1) {
+    if (buflen > 0) {
+      buf[0] = '\0';
+    }
+    return -ENOSPC;
+  }
+
+  if (neg) {
+    buf[len++] = '-';
+  }
+
+  if (int_part <= 0xFFFFFFFFU) {
+    for (i = int_digits; i-- > 0;) {
+      buf[len++] = int_buf[i];
+    }
+  }
+
+  // Larger integer parts: peel off 8, 4, 2 and 1 times each power of ten
+  for (i = int_part <= 0xFFFFFFFFU ? 0 : int_digits; i-- > 0;) {
+    p = pow10[i];
+    d = 0;
+    if (i == 19) {  // the leading digit of a 20-digit number is 1; 2 * 10^19 doesn't fit
+      if (int_part >= p) {
+        int_part -= p;
+        d = 1;
+      }
+    } else {
+      if (int_part >= 8 * p) { int_part -= 8 * p; d += 8; }
+      if (int_part >= 4 * p) { int_part -= 4 * p; d += 4; }
+      if (int_part >= 2 * p) { int_part -= 2 * p; d += 2; }
+      if (int_part >= p) { int_part -= p; d += 1; }
+    }
+    buf[len++] = (char)('0' + d);
+  }
+
+  if (digits) {
+    buf[len++] = '.';
+    for (i = 0; i < digits; i++) {
+      buf[len++] = (char)('0' + frac[i]);
+    }
+  }
+  buf[len] = '\0';
+  return len;
+}
+
+/** fp_isspace: Whitespace fp_parse() skips around the number.
+*/
+static inline bool fp_isspace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/** fp_parse: Converts a decimal string to the nearest fixed point number.
+
+Accepts optional whitespace, an optional sign, digits with an optional point, and optional whitespace
+(e.g. "-0.25\n" from sysfs). The number is rounded to the nearest fixed point value (round half to
+even) no matter how many digits it has; the first FP_PARSE_FRAC_DIGITS fractional digits are used
+exactly and any further ones only break ties, which is enough for every format up to 64 bits.
+The fraction is kept in base 10^9 limbs, so each fractional bit costs one add and compare per nine
+digits. Up to 18 fractional digits the limbs are handled as one 32-bit or 64-bit word, without the
+loop over the limbs. There are no divisions.
+
+@param s, the string to be converted. At most len characters are read; a NUL ends it early.
+
+@param len, the length of s.
+
+@param width, the total number of bits in the format (1..64), including the sign bit.
+
+@param frac_bits, the number of fractional bits (0..width).
+
+@param is_signed, whether the format is two's complement.
+
+@param out, where the fixed point number is stored, in its low width bits.
+
+@returns 0 on success, -EINVAL if s isn't a number or the format is bad, or -ERANGE if the number
+doesn't fit the format.
+*/
+static inline int fp_parse(const char *s, size_t len, unsigned int width, unsigned int frac_bits,
+                           bool is_signed, uint64_t *out) {
+  uint32_t limbs[FP_PARSE_LIMBS] = { 0 };
+  unsigned int nfrac = 0;
+  unsigned int nlimbs;
+  unsigned int ndigits = 0;
+  unsigned int i;
+  unsigned int b;
+  uint32_t carry;
+  uint32_t v;
+  uint64_t int_part = 0;
+  uint64_t bits = 0;
+  uint64_t dec;
+  uint64_t mag;
+  uint64_t limit;
+  bool neg = false;
+  bool sticky = false;
+  bool above;
+  bool tie;
+  size_t pos = 0;
+
+  if (width == 0 || width > FP_MAX_WIDTH || frac_bits > width) {
+    return -EINVAL;
+  }
+
+  while (pos < len && fp_isspace(s[pos])) {
+    pos++;
+  }
+  if (pos < len && (s[pos] == '-' || s[pos] == '+')) {
+    neg = s[pos] == '-';
+    pos++;
+  }
+
+  // Integer part; 1844674407370955161 * 10 + 5 is the largest that fits 64 bits
+  for (; pos < len && s[pos] >= '0' && s[pos] <= '9'; pos++) {
+    v = s[pos] - '0';
+    if (int_part > 1844674407370955161ULL || (int_part == 1844674407370955161ULL && v > 5)) {
+      return -ERANGE;
+    }
+    int_part = (int_part << 3) + (int_part << 1) + v;
+    ndigits++;
+  }
+
+  // Fractional part
+  if (pos < len && s[pos] == '.') {
+    for (pos++; pos < len && s[pos] >= '0' && s[pos] <= '9'; pos++) {
+      v = s[pos] - '0';
+      if (nfrac < FP_PARSE_FRAC_DIGITS) {
+        i = nfrac++ / FP_LIMB_DIGITS;  // constant divisor; compiles to a multiply
+        limbs[i] = (limbs[i] << 3) + (limbs[i] << 1) + v;
+      } else if (v) {
+        sticky = true;
+      }
+      ndigits++;
+    }
+  }
+
+  while (pos < len && fp_isspace(s[pos])) {
+    pos++;
+  }
+  if (ndigits == 0 || (pos < len && s[pos] != '\0')) {
+    return -EINVAL;
+  }
+
+  // Pad the last limb to 9 digits, and drop limbs that are all zeros
+  for (i = nfrac; i % FP_LIMB_DIGITS != 0; i++) {
+    limbs[nfrac / FP_LIMB_DIGITS] *= 10;
+  }
+  nlimbs = (nfrac + FP_LIMB_DIGITS - 1) / FP_LIMB_DIGITS;
+  while (nlimbs > 0 && limbs[nlimbs - 1] == 0) {
+    nlimbs--;
+  }
+
+  // Binary fraction: double the decimal fraction, each carry out of it is the next bit. What's
+  // left of the decimal fraction then decides the rounding.
+  if (nlimbs <= 1) {
+    v = limbs[0];  // 2 * 10^9 still fits 32 bits
+    for (b = 0; b < frac_bits; b++) {
+      v <<= 1;
+      carry = v >= FP_LIMB_BASE;
+      v = carry ? v - FP_LIMB_BASE : v;
+      bits = (bits << 1) | carry;
+    }
+    above = v > FP_LIMB_BASE / 2 || (v == FP_LIMB_BASE / 2 && sticky);
+    tie = v == FP_LIMB_BASE / 2 && !sticky;
+  } else if (nlimbs <= 2) {
+    dec = (uint64_t)limbs[0] * FP_LIMB_BASE + limbs[1];
+    for (b = 0; b < frac_bits; b++) {
+      dec <<= 1;
+      carry = dec >= FP_PARSE_WORD_BASE;
+      dec = carry ? dec - FP_PARSE_WORD_BASE : dec;
+      bits = (bits << 1) | carry;
+    }
+    above = dec > FP_PARSE_WORD_BASE / 2 || (dec == FP_PARSE_WORD_BASE / 2 && sticky);
+    tie = dec == FP_PARSE_WORD_BASE / 2 && !sticky;
+  } else {
+    for (b = 0; b < frac_bits; b++) {
+      carry = 0;
+      for (i = nlimbs; i-- > 0;) {
+        v = 2 * limbs[i] + carry;
+        carry = v >= FP_LIMB_BASE;
+        limbs[i] = carry ? v - FP_LIMB_BASE : v;
+      }
+      bits = (bits << 1) | carry;
+      while (nlimbs > 0 && limbs[nlimbs - 1] == 0) {
+        nlimbs--;
+      }
+    }
+    above = nlimbs > 0 && (limbs[0] > FP_LIMB_BASE / 2 ||
+                           (limbs[0] == FP_LIMB_BASE / 2 && (nlimbs > 1 || sticky)));
+    tie = nlimbs == 1 && limbs[0] == FP_LIMB_BASE / 2 && !sticky;
+  }
+
+  if (frac_bits == 64) {
+    if (int_part) {
+      return -ERANGE;
+    }
+    mag = bits;
+  } else {
+    if (int_part > (~(uint64_t)0 >> frac_bits)) {
+      return -ERANGE;
+    }
+    mag = (int_part << frac_bits) | bits;
+  }
+  if (above || (tie && (mag & 1))) {
+    if (mag == ~(uint64_t)0) {
+      return -ERANGE;
+    }
+    mag++;
+  }
+
+  if (!is_signed) {
+    limit = neg ? 0 : fp_mask(width);
+  } else {
+    limit = neg ? (uint64_t)1 << (width - 1) : fp_mask(width - 1);
+  }
+  if (mag > limit) {
+    return -ERANGE;
+  }
+
+  *out = (neg ? ~mag + 1 : mag) & fp_mask(width);
+  return 0;
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,837 @@
+/* SPDX-License-Identifier: GPL-2.0 or MIT                               */
+/*-------------------------------------------------------------------------
+ * Description:  Host-side test and microbenchmark for fp_conversions.h
+ *               and fp_array_conversions.h
+ * ------------------------------------------------------------------------
+ * Checks fp_format()/fp_parse() against an exact 128-bit reference,
+ * round-trips every value of the small formats (and many random values of
+ * the large ones), shows how the old fp_to_str()/str_to_fp() compare, and
+ * times old against new.
+ *
+ * The array conversions are checked against libm in every rounding mode,
+ * and the vector kernels against the scalar code. The formats defined in
+ * fixed_point.h are checked against the generic functions.
+ *
+ * Build and run on the host (or on the HPS):
+ *   gcc -O2 -Wall -o fp_conversions_test fp_conversions_test.c -lm
+ *   ./fp_conversions_test
+ *
+ * Add -mavx2 on x86 (SSE2 is the default there), or -mfpu=neon on the HPS,
+ * to test the other vector kernels.
+ *
+ * The exit status is non-zero if fp_format(), fp_parse() or an array
+ * conversion got anything wrong; differences of the old functions are only
+ * reported.
+-------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include "fp_conversions.h"
+#include "fp_array_conversions.h"
+#include "fixed_point.h"
+
+/*
+ * Unsigned 128-bit integers for the exact reference. 32-bit ARM gcc has no
+ * unsigned __int128, so the few operations the reference needs are
+ * spelled out on two 64-bit halves.
+ */
+typedef struct {
+	uint64_t hi;
+	uint64_t lo;
+} u128;
+
+static u128 u128_from(uint64_t lo)
+{
+	u128 r = { 0, lo };
+
+	return r;
+}
+
+/* a * b, exact                                                          */
+static u128 u128_mul64(uint64_t a, uint64_t b)
+{
+	uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+	uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+	uint64_t ll = a_lo * b_lo;
+	uint64_t lh = a_lo * b_hi;
+	uint64_t hl = a_hi * b_lo;
+	uint64_t hh = a_hi * b_hi;
+	uint64_t mid = (ll >> 32) + (uint32_t)lh + (uint32_t)hl;
+	u128 r;
+
+	r.lo = (mid << 32) | (uint32_t)ll;
+	r.hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+	return r;
+}
+
+/* n << shift, for shift < 128                                           */
+static u128 u128_shl(u128 n, unsigned int shift)
+{
+	u128 r;
+
+	if (shift == 0) {
+		return n;
+	}
+	if (shift >= 64) {
+		r.hi = n.lo << (shift - 64);
+		r.lo = 0;
+	} else {
+		r.hi = (n.hi << shift) | (n.lo >> (64 - shift));
+		r.lo = n.lo << shift;
+	}
+	return r;
+}
+
+/* n >> shift, for shift < 128                                           */
+static u128 u128_shr(u128 n, unsigned int shift)
+{
+	u128 r;
+
+	if (shift == 0) {
+		return n;
+	}
+	if (shift >= 64) {
+		r.lo = n.hi >> (shift - 64);
+		r.hi = 0;
+	} else {
+		r.lo = (n.lo >> shift) | (n.hi << (64 - shift));
+		r.hi = n.hi >> shift;
+	}
+	return r;
+}
+
+/* The low shift bits of n, for shift < 128                              */
+static u128 u128_low_bits(u128 n, unsigned int shift)
+{
+	return u128_shr(u128_shl(n, 128 - shift), 128 - shift);
+}
+
+static int u128_cmp(u128 a, u128 b)
+{
+	if (a.hi != b.hi) {
+		return a.hi < b.hi ? -1 : 1;
+	}
+	if (a.lo != b.lo) {
+		return a.lo < b.lo ? -1 : 1;
+	}
+	return 0;
+}
+
+static u128 u128_inc(u128 n)
+{
+	n.lo++;
+	n.hi += n.lo == 0;
+	return n;
+}
+
+/* n / d, and n % d in *rem; shift-and-subtract, one quotient bit a step  */
+static u128 u128_divmod64(u128 n, uint64_t d, uint64_t *rem)
+{
+	u128 q = { 0, 0 };
+	uint64_t r = 0;
+	uint64_t top;
+	int i;
+
+	for (i = 127; i >= 0; i--) {
+		top = r >> 63;
+		r = (r << 1) | ((i >= 64 ? n.hi >> (i - 64) : n.lo >> i) & 1);
+		q = u128_shl(q, 1);
+		if (top || r >= d) {
+			r -= d;
+			q.lo |= 1;
+		}
+	}
+	*rem = r;
+	return q;
+}
+
+static unsigned long failures;
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t rng(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return rng_state;
+}
+
+static void fail(const char *what, unsigned int w, unsigned int f, int s,
+	uint64_t raw, const char *got, const char *want)
+{
+	if (failures++ < 20) {
+		printf("FAIL %s: W=%u F=%u %s raw=0x%llx got \"%s\" want \"%s\"\n",
+		       what, w, f, s ? "signed" : "unsigned",
+		       (unsigned long long)raw, got, want);
+	}
+}
+
+/* Round n / 2^shift to the nearest integer, ties to even               */
+static u128 round_shift(u128 n, unsigned int shift)
+{
+	u128 q, r, half;
+	int c;
+
+	if (shift == 0) {
+		return n;
+	}
+	q = u128_shr(n, shift);
+	r = u128_low_bits(n, shift);
+	half = u128_shl(u128_from(1), shift - 1);
+	c = u128_cmp(r, half);
+	if (c > 0 || (c == 0 && (q.lo & 1))) {
+		q = u128_inc(q);
+	}
+	return q;
+}
+
+/* Exact decimal string of a fixed-point value, with digits <= 19        */
+static void ref_format(char *buf, uint64_t raw, unsigned int w, unsigned int f,
+	int is_signed, unsigned int digits)
+{
+	uint64_t mag = raw & fp_mask(w);
+	uint64_t p10 = 1;
+	int neg = 0;
+	u128 scaled;
+	uint64_t frac;
+	unsigned int i;
+
+	if (is_signed && ((mag >> (w - 1)) & 1)) {
+		neg = 1;
+		mag = (~mag + 1) & fp_mask(w);
+	}
+	for (i = 0; i < digits; i++) {
+		p10 *= 10;
+	}
+	scaled = round_shift(u128_mul64(mag, p10), f);
+
+	if (digits) {
+		scaled = u128_divmod64(scaled, p10, &frac);
+		sprintf(buf, "%s%llu.%0*llu", neg ? "-" : "",
+		        (unsigned long long)scaled.lo, digits,
+		        (unsigned long long)frac);
+	} else {
+		sprintf(buf, "%s%llu", neg ? "-" : "", (unsigned long long)scaled.lo);
+	}
+}
+
+/* Format with the given digits, compare with the reference and parse back */
+static void check_value(uint64_t raw, unsigned int w, unsigned int f, int s)
+{
+	char buf[FP_FORMAT_MAX_LEN];
+	char want[FP_FORMAT_MAX_LEN];
+	unsigned int rt = FP_ROUNDTRIP_DIGITS(f);
+	unsigned int d;
+	uint64_t back;
+	int len;
+
+	raw &= fp_mask(w);
+
+	// Shortest round-trip string must parse back to the same value.
+	len = fp_format(buf, sizeof(buf), raw, w, f, s, rt);
+	if (len < 0 || fp_parse(buf, len, w, f, s, &back) != 0 || back != raw) {
+		fail("round trip", w, f, s, raw, buf, "same value");
+	}
+	if (rt <= 19) {
+		ref_format(want, raw, w, f, s, rt);
+		if (strcmp(buf, want) != 0) {
+			fail("format", w, f, s, raw, buf, want);
+		}
+	}
+
+	// A random number of digits must still be correctly rounded.
+	d = rng() % 20;
+	fp_format(buf, sizeof(buf), raw, w, f, s, d);
+	ref_format(want, raw, w, f, s, d);
+	if (strcmp(buf, want) != 0) {
+		fail("format", w, f, s, raw, buf, want);
+	}
+
+	// The exact expansion must parse back too.
+	len = fp_format(buf, sizeof(buf), raw, w, f, s, f);
+	if (len < 0 || fp_parse(buf, len, w, f, s, &back) != 0 || back != raw) {
+		fail("exact round trip", w, f, s, raw, buf, "same value");
+	}
+}
+
+/* Every value of every format up to 16 bits                             */
+static void test_exhaustive(void)
+{
+	static const unsigned int widths[] = { 1, 2, 8, 12, 16 };
+	unsigned long count = 0;
+	unsigned int i, f;
+	uint64_t raw;
+	int s;
+
+	for (i = 0; i < sizeof(widths) / sizeof(widths[0]); i++) {
+		for (f = 0; f <= widths[i]; f++) {
+			for (s = 0; s <= 1; s++) {
+				for (raw = 0; raw <= fp_mask(widths[i]); raw++) {
+					check_value(raw, widths[i], f, s);
+					count++;
+				}
+			}
+		}
+	}
+	printf("exhaustive W<=16:  %lu values checked\n", count);
+}
+
+/* Random and edge values of the wide formats                            */
+static void test_random(void)
+{
+	static const unsigned int widths[] = { 24, 32, 48, 63, 64 };
+	unsigned long count = 0;
+	unsigned int i, f, n;
+	uint64_t edges[6];
+	int s;
+
+	for (i = 0; i < sizeof(widths) / sizeof(widths[0]); i++) {
+		unsigned int w = widths[i];
+
+		edges[0] = 0;
+		edges[1] = 1;
+		edges[2] = fp_mask(w);
+		edges[3] = fp_mask(w - 1);
+		edges[4] = (uint64_t)1 << (w - 1);
+		edges[5] = ((uint64_t)1 << (w - 1)) + 1;
+
+		for (f = 0; f <= w; f++) {
+			for (s = 0; s <= 1; s++) {
+				for (n = 0; n < 6; n++) {
+					check_value(edges[n], w, f, s);
+				}
+				for (n = 0; n < 4000; n++) {
+					check_value(rng() >> (rng() % w), w, f, s);
+				}
+				count += 4006;
+			}
+		}
+	}
+	printf("random W=24..64:   %lu values checked\n", count);
+}
+
+/* Random decimal strings against an exact reference                     */
+static void test_parse(void)
+{
+	static const struct {
+		const char *s;
+		unsigned int w, f;
+		int is_signed;
+		int ret;
+		uint64_t val;
+	} cases[] = {
+		{ "0.5", 8, 0, 0, 0, 0 },            // ties go to even
+		{ "1.5", 8, 0, 0, 0, 2 },
+		{ "2.5", 8, 0, 0, 0, 2 },
+		{ "-2.5", 8, 0, 1, 0, 0xFE },
+		{ "0.25", 8, 1, 0, 0, 0 },
+		{ "0.75", 8, 1, 0, 0, 2 },
+		{ "0.25000000000000000000000000000000000000000000000000"
+		  "000000000000000000000000000000", 8, 1, 0, 0, 0 },
+		{ "0.25000000000000000000000000000000000000000000000000"
+		  "000000000000000000000000000001",
+		  8, 1, 0, 0, 1 },                   // digit past the kept ones breaks the tie
+		{ "  -1.0\n", 16, 8, 1, 0, 0xFF00 },
+		{ "+1", 16, 8, 1, 0, 0x0100 },
+		{ "-128", 8, 0, 1, 0, 0x80 },
+		{ "-128.5", 8, 0, 1, 0, 0x80 },     // tie, -128 is even
+		{ "-128.6", 8, 0, 1, -ERANGE, 0 },
+		{ "128", 8, 0, 1, -ERANGE, 0 },
+		{ "255.4", 8, 0, 0, 0, 0xFF },
+		{ "255.5", 8, 0, 0, -ERANGE, 0 },
+		{ "-1", 8, 0, 0, -ERANGE, 0 },
+		{ "-0", 8, 0, 0, 0, 0 },
+		{ "18446744073709551615", 64, 0, 0, 0, 0xFFFFFFFFFFFFFFFFULL },
+		{ "18446744073709551616", 64, 0, 0, -ERANGE, 0 },
+		{ "0.99999999999999999999999", 64, 64, 0, -ERANGE, 0 },
+		{ "", 8, 0, 0, -EINVAL, 0 },
+		{ ".", 8, 0, 0, -EINVAL, 0 },
+		{ "1.2.3", 8, 0, 0, -EINVAL, 0 },
+		{ "1,5", 8, 0, 0, -EINVAL, 0 },
+	};
+	char buf[64];
+	unsigned long count = 0;
+	unsigned int i, n, nd, fd, f;
+	uint64_t num, val, mask, p10, r2;
+	u128 ref;
+	int neg, ret, want_ret;
+
+	for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		val = 0;
+		ret = fp_parse(cases[i].s, strlen(cases[i].s), cases[i].w, cases[i].f,
+		               cases[i].is_signed, &val);
+		if (ret != cases[i].ret || (ret == 0 && val != cases[i].val)) {
+			sprintf(buf, "ret %d val 0x%llx", ret, (unsigned long long)val);
+			fail("parse", cases[i].w, cases[i].f, cases[i].is_signed, 0,
+			     buf, cases[i].s);
+		}
+	}
+
+	// s = +-num / 10^fd with at most 18 digits, parsed as signed Q(47-f).f
+	for (n = 0; n < 500000; n++) {
+		nd = 1 + rng() % 18;
+		fd = rng() % (nd + 1);
+		f = rng() % 48;
+		neg = rng() & 1;
+		num = 0;
+		for (i = 0; i < nd; i++) {
+			num = num * 10 + rng() % 10;
+		}
+		p10 = 1;
+		for (i = 0; i < fd; i++) {
+			p10 *= 10;
+		}
+		sprintf(buf, "%s%0*llu", neg ? "-" : "", nd, (unsigned long long)num);
+		if (fd) {
+			// Put the point fd digits from the end.
+			size_t l = strlen(buf);
+			memmove(buf + l - fd + 1, buf + l - fd, fd + 1);
+			buf[l - fd] = '.';
+		}
+
+		// round(num * 2^f / 10^fd), ties to even
+		ref = u128_divmod64(u128_shl(u128_from(num), f), p10, &r2);
+		r2 *= 2;
+		if (r2 > p10 || (r2 == p10 && (ref.lo & 1))) {
+			ref = u128_inc(ref);
+		}
+		mask = fp_mask(48);
+		if (neg ? u128_cmp(ref, u128_from((uint64_t)1 << 47)) > 0 :
+		          u128_cmp(ref, u128_from(fp_mask(47))) > 0) {
+			want_ret = -ERANGE;
+		} else {
+			want_ret = 0;
+		}
+
+		ret = fp_parse(buf, strlen(buf), 48, f, 1, &val);
+		if (ret != want_ret ||
+		    (ret == 0 && val != ((neg ? ~ref.lo + 1 : ref.lo) & mask))) {
+			char got[64];
+			sprintf(got, "ret %d val 0x%llx", ret, (unsigned long long)val);
+			fail("parse", 48, f, 1, 0, got, buf);
+		}
+		count++;
+	}
+	printf("parse:             %lu strings checked\n", count);
+}
+
+/* Round y (already scaled by 2^F) with libm and saturate it             */
+static uint32_t ref_round(double y, unsigned int w, int s, enum fp_round mode,
+	bool *sat)
+{
+	double min = s ? -ldexp(1, w - 1) : 0;
+	double max = s ? ldexp(1, w - 1) - 1 : ldexp(1, w) - 1;
+	double r;
+
+	*sat = false;
+	if (isnan(y)) {
+		*sat = true;
+		return 0;
+	}
+
+	switch (mode) {
+	case FP_ROUND_NEAREST_EVEN:
+		r = nearbyint(y);
+		break;
+	case FP_ROUND_NEAREST_AWAY:
+		r = round(y);
+		break;
+	case FP_ROUND_FLOOR:
+		r = floor(y);
+		break;
+	case FP_ROUND_CEIL:
+		r = ceil(y);
+		break;
+	default:
+		r = trunc(y);
+		break;
+	}
+
+	if (r < min) {
+		*sat = true;
+		r = min;
+	} else if (r > max) {
+		*sat = true;
+		r = max;
+	}
+	return (uint32_t)(int64_t)r & (uint32_t)(((uint64_t)1 << w) - 1);
+}
+
+/* Random floats around the range of a format, plus the awkward ones     */
+static void array_inputs(float *x, size_t n, unsigned int w, unsigned int f,
+	int s)
+{
+	static const float edge[] = {
+		0.0f, -0.0f, INFINITY, -INFINITY, NAN, 1e-45f, -1e-45f,
+		1.1754942e-38f, 1.17549435e-38f, 3.4028235e38f, -3.4028235e38f,
+		1.0f, -1.0f, 0.5f, -0.5f, 1.5f, -1.5f, 2.5f, -2.5f, 16777216.0f,
+		1073741824.0f, -1073741824.0f, 4294967296.0f, 1e10f, -1e10f,
+	};
+	size_t ne = sizeof(edge) / sizeof(edge[0]);
+	double lsb = ldexp(1, -(int)f);
+	double lo = s ? -ldexp(1, w - 1) * lsb : 0;
+	double hi = (s ? ldexp(1, w - 1) : ldexp(1, w)) * lsb;
+	uint32_t bits;
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		switch (rng() % 8) {
+		case 0:
+			x[i] = edge[rng() % ne];
+			break;
+		case 1:
+			// Any bit pattern
+			bits = (uint32_t)rng();
+			memcpy(&x[i], &bits, sizeof(bits));
+			break;
+		case 2:
+			// Exact ties and their neighbours
+			x[i] = (float)(((int64_t)(rng() % (1ULL << w)) + (s ? -(1LL << (w - 1)) : 0)
+			        + 0.5) * lsb);
+			if (rng() & 1) {
+				x[i] = nextafterf(x[i], (rng() & 1) ? INFINITY : -INFINITY);
+			}
+			break;
+		case 3:
+			// Just outside the range
+			x[i] = (float)((rng() & 1 ? hi : lo) + ((double)(rng() % 5) - 2) * lsb * 0.5);
+			break;
+		default:
+			x[i] = (float)(lo - lsb + (hi - lo + 2 * lsb) * (double)(rng() >> 11) * 0x1p-53);
+			break;
+		}
+	}
+}
+
+/* Every format up to 32 bits, every rounding mode, floats and doubles    */
+static void test_array(void)
+{
+	enum { N = 1027 };	// odd, so the vector code leaves a tail
+	static float x[N];
+	static double xd[N];
+	static uint32_t got[N];
+	static uint32_t scalar[N];
+	static uint32_t words[N];
+	static float back[N];
+	static double backd[N];
+	unsigned int w, f, mode;
+	long nsat, nsat_scalar, want_sat;
+	uint32_t want;
+	char gs[40], ws[40];
+	bool sat;
+	int s;
+	size_t i;
+
+	for (w = 1; w <= 32; w++) {
+		for (f = 0; f <= w; f += (w < 8 ? 1 : 3)) {
+			for (s = 0; s <= 1; s++) {
+				array_inputs(x, N, w, f, s);
+				for (i = 0; i < N; i++) {
+					xd[i] = (double)x[i] * (1.0 + (double)(rng() % 3 - 1) * 0x1p-40);
+				}
+
+				for (mode = FP_ROUND_NEAREST_EVEN; mode <= FP_ROUND_CEIL; mode++) {
+					nsat = fp_array_from_f32(got, x, N, w, f, s, mode);
+					nsat_scalar = fp_array_from_f32_scalar(scalar, x, N, w, f, s, mode);
+					want_sat = 0;
+					for (i = 0; i < N; i++) {
+						want = ref_round(ldexp(x[i], f), w, s, mode, &sat);
+						want_sat += sat;
+						if (got[i] != want || scalar[i] != want) {
+							snprintf(gs, sizeof(gs), "0x%x/0x%x", got[i], scalar[i]);
+							snprintf(ws, sizeof(ws), "0x%x (%a, mode %u)", want,
+							         x[i], mode);
+							fail("from_f32", w, f, s, i, gs, ws);
+						}
+					}
+					if (nsat != want_sat || nsat_scalar != want_sat) {
+						snprintf(gs, sizeof(gs), "%ld/%ld", nsat, nsat_scalar);
+						snprintf(ws, sizeof(ws), "%ld", want_sat);
+						fail("from_f32 saturation count", w, f, s, mode, gs, ws);
+					}
+
+					nsat = fp_array_from_f64(got, xd, N, w, f, s, mode);
+					want_sat = 0;
+					for (i = 0; i < N; i++) {
+						want = ref_round(ldexp(xd[i], f), w, s, mode, &sat);
+						want_sat += sat;
+						if (got[i] != want) {
+							snprintf(gs, sizeof(gs), "0x%x", got[i]);
+							snprintf(ws, sizeof(ws), "0x%x (%a, mode %u)", want,
+							         xd[i], mode);
+							fail("from_f64", w, f, s, i, gs, ws);
+						}
+					}
+					if (nsat != want_sat) {
+						snprintf(gs, sizeof(gs), "%ld", nsat);
+						snprintf(ws, sizeof(ws), "%ld", want_sat);
+						fail("from_f64 saturation count", w, f, s, mode, gs, ws);
+					}
+				}
+
+				// Back again; the upper bits of the words must be ignored
+				for (i = 0; i < N; i++) {
+					words[i] = (uint32_t)rng();
+				}
+				fp_array_to_f32(back, words, N, w, f, s);
+				fp_array_to_f64(backd, words, N, w, f, s);
+				for (i = 0; i < N; i++) {
+					double v = ldexp((double)fp_array_value(words[i], w, s), -(int)f);
+
+					if (back[i] != (float)v || backd[i] != v) {
+						snprintf(gs, sizeof(gs), "%a/%a", back[i], backd[i]);
+						snprintf(ws, sizeof(ws), "%a", v);
+						fail("to_f32/to_f64", w, f, s, words[i], gs, ws);
+					}
+				}
+			}
+		}
+	}
+
+	if (fp_array_from_f32(got, x, 1, 33, 0, true, FP_ROUND_ZERO) != -EINVAL ||
+	    fp_array_from_f64(got, xd, 1, 8, 9, true, FP_ROUND_ZERO) != -EINVAL ||
+	    fp_array_to_f32(back, got, 1, 0, 0, true) != -EINVAL) {
+		fail("bad format", 0, 0, 0, 0, "accepted", "-EINVAL");
+	}
+}
+
+/* The FIXED_POINT_DEFINE() functions against the generic ones          */
+#define CHECK_FIXED_POINT(name)                                                   \
+	do {                                                                      \
+		for (i = 0; i < 100000; i++) {                                    \
+			raw = (uint32_t)rng();                                    \
+			bits = (uint32_t)rng();                                   \
+			d = (double)(int64_t)rng() * 0x1p-60;                     \
+			name##_format(gs, sizeof(gs), raw, name##_FRAC_BITS);     \
+			fp_format(ws, sizeof(ws), raw, name##_WIDTH, name##_FRAC_BITS, \
+			          name##_SIGNED, name##_FRAC_BITS);               \
+			if (strcmp(gs, ws) != 0 ||                                \
+			    name##_parse(gs, strlen(gs), &back) != 0 ||           \
+			    back != (raw & FIXED_POINT_MASK_OF(name)) ||          \
+			    name##_value(raw) != fp_array_value(raw, name##_WIDTH, name##_SIGNED) || \
+			    name##_from_value(name##_value(raw)) != back ||       \
+			    name##_from_f32_bits(bits, FP_ROUND_FLOOR) !=         \
+			      fp_array_from_f32_bits(bits, name##_WIDTH, name##_FRAC_BITS, \
+			                             name##_SIGNED, FP_ROUND_FLOOR, &sat) || \
+			    name##_from_double(d, FP_ROUND_CEIL) !=               \
+			      ref_round(ldexp(d, name##_FRAC_BITS), name##_WIDTH, \
+			                name##_SIGNED, FP_ROUND_CEIL, &sat) ||    \
+			    name##_to_double(raw) != ldexp((double)name##_value(raw), \
+			                                   -name##_FRAC_BITS)) {  \
+				fail(#name, name##_WIDTH, name##_FRAC_BITS,       \
+				     name##_SIGNED, raw, gs, ws);                 \
+			}                                                         \
+		}                                                                 \
+		if (name##_from_value(FIXED_POINT_MAX_OF(name) + 1) !=            \
+		      (uint32_t)FIXED_POINT_MAX_OF(name) ||                       \
+		    name##_from_value(FIXED_POINT_MIN_OF(name) - 1) !=            \
+		      ((uint32_t)FIXED_POINT_MIN_OF(name) & FIXED_POINT_MASK_OF(name))) { \
+			fail(#name " saturation", name##_WIDTH, name##_FRAC_BITS, \
+			     name##_SIGNED, 0, "", "");                           \
+		}                                                                 \
+	} while (0)
+
+static void test_fixed_point(void)
+{
+	char gs[FP_FORMAT_MAX_LEN], ws[FP_FORMAT_MAX_LEN];
+	uint32_t raw, bits, back;
+	double d;
+	bool sat;
+	int i;
+
+	CHECK_FIXED_POINT(fixed_audio);
+	CHECK_FIXED_POINT(fixed_hanning);
+	CHECK_FIXED_POINT(fixed_fft_gain);
+	CHECK_FIXED_POINT(fixed_comb_gain);
+	CHECK_FIXED_POINT(fixed_comb_mix);
+	CHECK_FIXED_POINT(fixed_comb_delay);
+	CHECK_FIXED_POINT(fixed_tpa_volume);
+
+	if (FIXED_POINT_CONST(0.25, 16) != 0x4000 || FIXED_POINT_CONST(-0.3, 16) != -19661) {
+		fail("FIXED_POINT_CONST", 16, 16, 1, 0, "", "");
+	}
+}
+
+/* How the old functions compare with exact results                      */
+static void test_old(void)
+{
+	static const unsigned int fracs[] = { 16, 23, 24, 28 };
+	char old_buf[80];
+	char buf[FP_FORMAT_MAX_LEN];
+	char want[FP_FORMAT_MAX_LEN];
+	unsigned int i, n, f;
+	unsigned long str_diff, parse_diff, old_rt, new_rt;
+	uint64_t raw, back;
+	int len;
+
+	printf("\nold functions, signed 32-bit, %d digits, 100000 values each:\n",
+	       ARBITRARY_CUTOFF_LEN);
+	printf("   F  fp_to_str!=exact  str_to_fp!=raw  old round trip  new round trip\n");
+
+	for (i = 0; i < sizeof(fracs) / sizeof(fracs[0]); i++) {
+		f = fracs[i];
+		str_diff = parse_diff = old_rt = new_rt = 0;
+
+		for (n = 0; n < 100000; n++) {
+			// Keep the integer part small; str_to_fp() keeps it in an int.
+			raw = (uint32_t)((int32_t)(rng() & fp_mask(f + 4)) -
+			                 (int32_t)((uint64_t)1 << (f + 3)));
+
+			// fp_to_str() truncates to 9 digits and appends a newline.
+			len = fp_to_str(old_buf, (uint32_t)raw, f, true);
+			old_buf[len - 1] = '\0';
+			ref_format(want, raw, 32, f, 1, ARBITRARY_CUTOFF_LEN);
+			fp_format(buf, sizeof(buf), raw, 32, f, true, ARBITRARY_CUTOFF_LEN);
+			if (strcmp(old_buf, want) != 0) {
+				str_diff++;
+			}
+			if (strcmp(buf, want) != 0) {
+				fail("format", 32, f, 1, raw, buf, want);
+			}
+
+			// Both parse the exact expansion of the value.
+			len = fp_format(buf, sizeof(buf), raw, 32, f, true, f);
+			if (str_to_fp(buf, f, true, len) != (uint32_t)raw) {
+				parse_diff++;
+			}
+
+			if (str_to_fp(old_buf, f, true, strlen(old_buf)) != (uint32_t)raw) {
+				old_rt++;
+			}
+			len = fp_format(buf, sizeof(buf), raw, 32, f, true,
+			                FP_ROUNDTRIP_DIGITS(f));
+			if (fp_parse(buf, len, 32, f, true, &back) != 0 || back != raw) {
+				new_rt++;
+				fail("round trip", 32, f, 1, raw, buf, "same value");
+			}
+		}
+		printf("  %2u  %16lu  %14lu  %14lu  %14lu\n", f, str_diff, parse_diff,
+		       old_rt, new_rt);
+	}
+}
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Old against new on the 24/23 audio format                             */
+static void benchmark(void)
+{
+	enum { N = 1000000 };
+	static char strs[256][FP_FORMAT_MAX_LEN];
+	static uint32_t vals[256];
+	char buf[FP_FORMAT_MAX_LEN];
+	unsigned long sum = 0;
+	uint64_t val;
+	double t;
+	int i;
+
+	for (i = 0; i < 256; i++) {
+		vals[i] = (uint32_t)rng();
+		fp_format(strs[i], sizeof(strs[i]), vals[i], 32, 23, true, 9);
+	}
+
+	printf("\nmicrobenchmark, signed 32-bit, 23 fractional bits, 9 digits:\n");
+
+	t = now_ns();
+	for (i = 0; i < N; i++) {
+		sum += fp_to_str(buf, vals[i & 255], 23, true);
+	}
+	printf("  fp_to_str  %7.1f ns\n", (now_ns() - t) / N);
+
+	t = now_ns();
+	for (i = 0; i < N; i++) {
+		sum += fp_format(buf, sizeof(buf), vals[i & 255], 32, 23, true, 9);
+	}
+	printf("  fp_format  %7.1f ns\n", (now_ns() - t) / N);
+
+	t = now_ns();
+	for (i = 0; i < N; i++) {
+		sum += str_to_fp(strs[i & 255], 23, true, strlen(strs[i & 255]));
+	}
+	printf("  str_to_fp  %7.1f ns\n", (now_ns() - t) / N);
+
+	t = now_ns();
+	for (i = 0; i < N; i++) {
+		fp_parse(strs[i & 255], FP_FORMAT_MAX_LEN, 32, 23, true, &val);
+		sum += val;
+	}
+	printf("  fp_parse   %7.1f ns\n", (now_ns() - t) / N);
+
+	// Keep the compiler from dropping the loops.
+	if (sum == 42) {
+		printf("\n");
+	}
+}
+
+/* Array conversions of 24/23 audio coefficients                         */
+static void benchmark_array(void)
+{
+	enum { N = 4096, REPS = 2000 };
+	static float x[N];
+	static uint32_t q[N];
+	long sum = 0;
+	double t;
+	int i;
+
+	for (i = 0; i < N; i++) {
+		x[i] = (float)((double)(rng() >> 11) * 0x1p-52 - 1.0);
+	}
+
+	printf("\narray microbenchmark, signed 24-bit, 23 fractional bits, per value:\n");
+
+	t = now_ns();
+	for (i = 0; i < REPS; i++) {
+		sum += fp_array_from_f32_scalar(q, x, N, 24, 23, true, FP_ROUND_NEAREST_EVEN);
+	}
+	printf("  from_f32 scalar  %6.2f ns\n", (now_ns() - t) / N / REPS);
+
+	t = now_ns();
+	for (i = 0; i < REPS; i++) {
+		sum += fp_array_from_f32(q, x, N, 24, 23, true, FP_ROUND_NEAREST_EVEN);
+	}
+	printf("  from_f32 vector  %6.2f ns\n", (now_ns() - t) / N / REPS);
+
+	t = now_ns();
+	for (i = 0; i < REPS; i++) {
+		sum += fp_array_to_f32_scalar(x, q, N, 24, 23, true);
+	}
+	printf("  to_f32 scalar    %6.2f ns\n", (now_ns() - t) / N / REPS);
+
+	t = now_ns();
+	for (i = 0; i < REPS; i++) {
+		sum += fp_array_to_f32(x, q, N, 24, 23, true);
+	}
+	printf("  to_f32 vector    %6.2f ns\n", (now_ns() - t) / N / REPS);
+
+	// Keep the compiler from dropping the loops.
+	if (sum == 42 && x[0] == 42.0f) {
+		printf("\n");
+	}
+}
+
+int main(void)
+{
+	test_exhaustive();
+	test_random();
+	test_parse();
+	test_array();
+	test_fixed_point();
+	test_old();
+	benchmark();
+	benchmark_array();
+
+	if (failures) {
+		printf("\n%lu failures\n", failures);
+		return 1;
+	}
+	printf("\nall fp_format()/fp_parse(), array and fixed_point.h checks passed\n");
+	return 0;
+}
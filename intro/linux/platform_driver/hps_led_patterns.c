@@ -15,26 +15,135 @@
 #include <linux/mod_devicetable.h>
 #include <linux/types.h>
 #include <linux/io.h>
-#include <linux/mutex.h>
+#include <linux/seqlock.h>
 #include <linux/miscdevice.h>
 #include <linux/fs.h>
 #include <linux/kernel.h>
 #include <linux/uaccess.h>
+#include <linux/mm.h>
+#include <linux/version.h>
+#include <linux/slab.h>
+#include <linux/compat.h>
+#include <linux/poll.h>
+#include <linux/wait.h>
+#include <linux/hrtimer.h>
+#include <linux/interrupt.h>
+#include <linux/sysfs.h>
+#include <linux/mutex.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/atomic.h>
+#include <linux/ktime.h>
+#include <linux/bitops.h>
+#include <linux/idr.h>
+#include <linux/list.h>
+#include <linux/kref.h>
+#include <linux/rwsem.h>
 /*#include "fp_conversions.h"*/
+#include "hps_led_patterns.h"
+
+#define CREATE_TRACE_POINTS
+#include "hps_led_patterns_trace.h"
 
 /*-----------------------------------------------------------------------*/
 /* DEFINE STATEMENTS                                                     */
 /*-----------------------------------------------------------------------*/
-/* Define the Component Register Offsets*/
-#define REG0_HPS_LED_CONTROL_OFFSET 0x0
-/* #define REG1 (Add offset for SYS_CLKs_sec) */
-#define REG2_LED_REG_OFFSET 0x08
-/* #define REG3 (Add offset for Base_rate) */
+/* The Component Register Offsets are defined in hps_led_patterns.h      */
 
 /* Memory span of all registers (used or not) in the                     */
 /* component hps_led_patterns                                            */
 #define SPAN 0x10
 
+/* Number of 32-bit registers in the span                                */
+#define NUM_REGS (SPAN / sizeof(u32))
+
+/* Number of log2 buckets in the latency histograms. Bucket 0 counts     */
+/* 0 ns, bucket n counts [2^(n-1), 2^n) ns and the last one everything   */
+/* above that.                                                           */
+#define HIST_BUCKETS 32
+
+/*-----------------------------------------------------------------------*/
+/* Module Parameters                                                     */
+/*-----------------------------------------------------------------------*/
+/*
+ * Period (in microseconds) of the change detector that is used when the 
+ * device tree doesn't give us an interrupt. 0 disables the detector.
+ */
+static unsigned int change_poll_us = 10000;
+module_param(change_poll_us, uint, 0444);
+MODULE_PARM_DESC(change_poll_us,
+	"Register change detector period in us when there is no IRQ (0 = off)");
+
+/*
+ * Bit mask of the registers the FPGA can change on its own (bit n is 
+ * register n). These are always read from the hardware; all others are
+ * served from the driver's shadow copy.
+ */
+static unsigned int volatile_regs;
+module_param(volatile_regs, uint, 0444);
+MODULE_PARM_DESC(volatile_regs,
+	"Bit mask of registers that are always read from the hardware");
+
+
+/*-----------------------------------------------------------------------*/
+/* Access Statistics                                                     */
+/*-----------------------------------------------------------------------*/
+/* Driver entry points we count and time                                 */
+enum hps_led_patterns_path {
+	HPS_LED_PATTERNS_PATH_READ,     // char device read()
+	HPS_LED_PATTERNS_PATH_WRITE,    // char device write()
+	HPS_LED_PATTERNS_PATH_SHOW,     // sysfs show() and binary read()
+	HPS_LED_PATTERNS_PATH_STORE,    // sysfs store() and binary write()
+	HPS_LED_PATTERNS_PATH_GROUP,    // grouped write ioctl
+	HPS_LED_PATTERNS_NUM_PATHS,
+};
+
+/* Latency histograms we keep                                            */
+enum hps_led_patterns_hist {
+	HPS_LED_PATTERNS_HIST_MMIO_READ,    // ioread32()
+	HPS_LED_PATTERNS_HIST_MMIO_WRITE,   // iowrite32()
+	HPS_LED_PATTERNS_HIST_LOCK_WAIT,    // waiting for the device lock
+	HPS_LED_PATTERNS_NUM_HISTS,
+};
+
+static const char * const hps_led_patterns_path_names[] = {
+	[HPS_LED_PATTERNS_PATH_READ] = "read",
+	[HPS_LED_PATTERNS_PATH_WRITE] = "write",
+	[HPS_LED_PATTERNS_PATH_SHOW] = "show",
+	[HPS_LED_PATTERNS_PATH_STORE] = "store",
+	[HPS_LED_PATTERNS_PATH_GROUP] = "group",
+};
+
+static const char * const hps_led_patterns_hist_names[] = {
+	[HPS_LED_PATTERNS_HIST_MMIO_READ] = "ioread32",
+	[HPS_LED_PATTERNS_HIST_MMIO_WRITE] = "iowrite32",
+	[HPS_LED_PATTERNS_HIST_LOCK_WAIT] = "lock_wait",
+};
+
+/*
+ * struct hps_led_patterns_stats - Access statistics of a device.
+ * @reg_reads: Register reads, indexed by register number. Reads that a
+ *             seqlock reader retries are counted again.
+ * @reg_hw_reads: The part of @reg_reads that went across the bridge.
+ * @reg_writes: Register writes, indexed by register number.
+ * @path_calls: Successful calls of each driver entry point.
+ * @path_ns: Total time spent in each driver entry point.
+ * @lock_ns: Total time writers spent waiting for the device lock.
+ * @hist: log2-bucketed latency histograms, see HIST_BUCKETS.
+ *
+ * Everything is atomic, so the statistics never need a lock of their own
+ * and can be updated from any context.
+ */
+struct hps_led_patterns_stats {
+	atomic64_t reg_reads[NUM_REGS];
+	atomic64_t reg_hw_reads[NUM_REGS];
+	atomic64_t reg_writes[NUM_REGS];
+	atomic64_t path_calls[HPS_LED_PATTERNS_NUM_PATHS];
+	atomic64_t path_ns[HPS_LED_PATTERNS_NUM_PATHS];
+	atomic64_t lock_ns;
+	atomic64_t hist[HPS_LED_PATTERNS_NUM_HISTS][HIST_BUCKETS];
+};
+
 
 /*-----------------------------------------------------------------------*/
 /* HPS_LED_patterns device structure                                     */
@@ -43,19 +152,600 @@
  * struct  hps_led_patterns_dev - Private hps_led_patterns device struct.
  * @miscdev: miscdevice used to create a char device 
  *           for the hps_led_patterns component
+ * @id: Instance number, allocated from hps_led_patterns_ida.
+ * @name: Instance name, "hps_led_patterns<id>"; used for the char device,
+ *        the IRQ and the debugfs directory.
+ * @node: Entry in hps_led_patterns_list.
  * @base_addr: Base address of the hps_led_patterns component
- * @lock: mutex used to prevent concurrent writes 
- *        to the hps_led_patterns component
+ * @phys_addr: Physical base address of the hps_led_patterns component;
+ *             used by mmap() to map the registers into user-space
+ * @phys_size: Size of the component's memory region in the device tree
+ * @shadow: Software copy of the registers, so reads don't have to go
+ *          across the bridge. Protected by @lock.
+ * @volatile_mask: Registers (bit n is register n) the FPGA can change; 
+ *                 these are always read from the hardware.
+ * @force_hw_read: Debug knob; read every register from the hardware.
+ * @mmap_count: Number of user-space mappings of the registers. Mapped
+ *              registers can change behind our back, so they are read 
+ *              from the hardware while this is non-zero.
+ * @debugfs: debugfs directory of the device.
+ * @stats_enable: Debug knob; collect @stats. Off by default, because
+ *                timing every access costs a clock read on each side.
+ * @stats: Access statistics, shown in debugfs.
+ * @lock: seqlock protecting the hps_led_patterns registers. Writers take
+ *        its spinlock so their writes never interleave. Readers never
+ *        block; they retry if a writer ran while they were reading, so
+ *        they always get a consistent snapshot of the registers. The
+ *        sequencer writes from its timer, so writers disable interrupts.
+ * @irq: FPGA interrupt that signals register changes, or 0 if the device
+ *       tree doesn't provide one and @change_timer is used instead.
+ * @change_timer: hrtimer that periodically looks for register changes.
+ * @change_lock: Protects @last_regs.
+ * @last_regs: Register values when we last looked for changes.
+ * @events: Number of register changes seen so far.
+ * @wait: Wait queue for poll().
+ * @attr_kn: sysfs nodes of the misc device's attributes to notify when
+ *           a register changes, indexed by register number.
+ * @seq_timer: hrtimer that plays the LED pattern sequence.
+ * @seq_mutex: Serializes loading, starting and stopping the sequence,
+ *             and protects @removed.
+ * @seq_steps: The loaded LED pattern sequence, or NULL.
+ * @seq_count: Number of steps in @seq_steps.
+ * @seq_flags: HPS_LED_PATTERNS_SEQ_* flags of the loaded sequence.
+ * @seq_pos: Index of the step currently shown.
+ * @seq_loops: Number of times a looping sequence wrapped around.
+ * @seq_running: True while the sequence is being played.
+ * @ref: Reference count. Open files and register mappings hold a
+ *       reference, so the struct outlives an unbind while they exist.
+ * @unbind_lock: File operations that touch the registers hold it for
+ *               reading; remove() holds it for writing while it sets
+ *               @removed, so it waits for them to finish.
+ * @removed: Set when the device is unbound; the registers are gone, and
+ *           every file operation that would touch them fails with -ENODEV
+ *           from then on. Protected by both @seq_mutex and @unbind_lock.
+ *
+ * The seq_* fields the timer changes are protected by @lock.
  *
  * An hps_led_patterns_dev struct gets created for each hps_led_patterns 
- * component in the system.
+ * component in the system. Every instance has its own locks, so
+ * instances never contend with each other.
  */
 struct hps_led_patterns_dev {
 	struct miscdevice miscdev;
+	int id;
+	char name[32];
+	struct list_head node;
 	void __iomem *base_addr;
-	struct mutex lock;
+	resource_size_t phys_addr;
+	resource_size_t phys_size;
+	u32 shadow[NUM_REGS];
+	u32 volatile_mask;
+	bool force_hw_read;
+	atomic_t mmap_count;
+	struct dentry *debugfs;
+	bool stats_enable;
+	struct hps_led_patterns_stats stats;
+	seqlock_t lock;
+	int irq;
+	struct hrtimer change_timer;
+	spinlock_t change_lock;
+	u32 last_regs[NUM_REGS];
+	atomic_t events;
+	wait_queue_head_t wait;
+	struct kernfs_node *attr_kn[NUM_REGS];
+	struct hrtimer seq_timer;
+	struct mutex seq_mutex;
+	struct hps_led_patterns_step *seq_steps;
+	u32 seq_count;
+	u32 seq_flags;
+	u32 seq_pos;
+	u32 seq_loops;
+	bool seq_running;
+	struct kref ref;
+	struct rw_semaphore unbind_lock;
+	bool removed;
+};
+
+/*-----------------------------------------------------------------------*/
+/* Driver-wide State                                                     */
+/*-----------------------------------------------------------------------*/
+/* Instance numbers; instance N shows up as /dev/hps_led_patternsN       */
+static DEFINE_IDA(hps_led_patterns_ida);
+
+/* All probed instances, for grouped access and aggregate statistics     */
+static LIST_HEAD(hps_led_patterns_list);
+static DEFINE_MUTEX(hps_led_patterns_list_lock);
+
+/* debugfs directory holding one directory per instance                  */
+static struct dentry *hps_led_patterns_debugfs_root;
+
+/*
+ * struct hps_led_patterns_file - Per-open hps_led_patterns file data.
+ * @priv: The hps_led_patterns device the file belongs to.
+ * @seen_events: Value of @priv->events when the file was last read;
+ *               poll() reports the file readable when they differ.
+ */
+struct hps_led_patterns_file {
+	struct hps_led_patterns_dev *priv;
+	unsigned int seen_events;
 };
 
+/*
+ * Names of the sysfs attributes that get a sysfs_notify() when their
+ * register changes, indexed by register number.
+ */
+static const char * const hps_led_patterns_notify_attrs[NUM_REGS] = {
+	[REG0_HPS_LED_CONTROL_OFFSET / 4] = "hps_led_control",
+	[REG2_LED_REG_OFFSET / 4] = "led_reg",
+};
+
+/*-----------------------------------------------------------------------*/
+/* Access Statistics Helpers                                             */
+/*-----------------------------------------------------------------------*/
+/*
+ * hps_led_patterns_stats_on() - Are we collecting statistics?
+ * @priv: The hps_led_patterns device.
+ */
+static inline bool hps_led_patterns_stats_on(struct hps_led_patterns_dev *priv)
+{
+	return READ_ONCE(priv->stats_enable);
+}
+
+/*
+ * hps_led_patterns_hist_add() - Add a sample to a latency histogram
+ * @priv: The hps_led_patterns device.
+ * @hist: Which histogram.
+ * @ns: The latency in nanoseconds.
+ */
+static void hps_led_patterns_hist_add(struct hps_led_patterns_dev *priv,
+	enum hps_led_patterns_hist hist, u64 ns)
+{
+	unsigned int bucket = min_t(unsigned int, fls64(ns), HIST_BUCKETS - 1);
+
+	atomic64_inc(&priv->stats.hist[hist][bucket]);
+}
+
+/*
+ * hps_led_patterns_path_begin() - Note entry into a driver entry point
+ * @priv: The hps_led_patterns device.
+ *
+ * Return: The start time to hand to hps_led_patterns_path_end(), or 0 if
+ * we are not collecting statistics.
+ */
+static u64 hps_led_patterns_path_begin(struct hps_led_patterns_dev *priv)
+{
+	return hps_led_patterns_stats_on(priv) ? ktime_get_ns() : 0;
+}
+
+/*
+ * hps_led_patterns_path_end() - Account a call of a driver entry point
+ * @priv: The hps_led_patterns device.
+ * @path: The entry point.
+ * @start: What hps_led_patterns_path_begin() returned.
+ */
+static void hps_led_patterns_path_end(struct hps_led_patterns_dev *priv,
+	enum hps_led_patterns_path path, u64 start)
+{
+	if (!start) {
+		return;
+	}
+
+	atomic64_inc(&priv->stats.path_calls[path]);
+	atomic64_add(ktime_get_ns() - start, &priv->stats.path_ns[path]);
+}
+
+/*
+ * hps_led_patterns_lock() - Take the device lock as a writer
+ * @priv: The hps_led_patterns device.
+ *
+ * Same as write_seqlock_irqsave(), but accounts the time spent waiting
+ * for the lock. Release it with write_sequnlock_irqrestore().
+ *
+ * Return: The saved interrupt flags.
+ */
+static unsigned long hps_led_patterns_lock(struct hps_led_patterns_dev *priv)
+{
+	bool stats = hps_led_patterns_stats_on(priv);
+	bool timed = stats || trace_hps_led_patterns_lock_wait_enabled();
+	unsigned long flags;
+	u64 start = 0;
+	u64 ns;
+
+	if (timed) {
+		start = ktime_get_ns();
+	}
+
+	write_seqlock_irqsave(&priv->lock, flags);
+
+	if (timed) {
+		ns = ktime_get_ns() - start;
+		if (stats) {
+			atomic64_add(ns, &priv->stats.lock_ns);
+			hps_led_patterns_hist_add(priv, HPS_LED_PATTERNS_HIST_LOCK_WAIT, ns);
+		}
+		trace_hps_led_patterns_lock_wait(priv->phys_addr, ns);
+	}
+
+	return flags;
+}
+
+/*
+ * hps_led_patterns_stats_reset() - Clear all statistics
+ * @priv: The hps_led_patterns device.
+ */
+static void hps_led_patterns_stats_reset(struct hps_led_patterns_dev *priv)
+{
+	struct hps_led_patterns_stats *st = &priv->stats;
+	int i;
+	int j;
+
+	for (i = 0; i < NUM_REGS; i++) {
+		atomic64_set(&st->reg_reads[i], 0);
+		atomic64_set(&st->reg_hw_reads[i], 0);
+		atomic64_set(&st->reg_writes[i], 0);
+	}
+	for (i = 0; i < HPS_LED_PATTERNS_NUM_PATHS; i++) {
+		atomic64_set(&st->path_calls[i], 0);
+		atomic64_set(&st->path_ns[i], 0);
+	}
+	atomic64_set(&st->lock_ns, 0);
+	for (i = 0; i < HPS_LED_PATTERNS_NUM_HISTS; i++) {
+		for (j = 0; j < HIST_BUCKETS; j++) {
+			atomic64_set(&st->hist[i][j], 0);
+		}
+	}
+}
+
+
+/*-----------------------------------------------------------------------*/
+/* Register Access                                                       */
+/*-----------------------------------------------------------------------*/
+/*
+ * hps_led_patterns_hw_read() - Read a register across the bridge
+ * @priv: The hps_led_patterns device.
+ * @offset: Byte offset of the register.
+ *
+ * Return: The register value.
+ */
+static u32 hps_led_patterns_hw_read(struct hps_led_patterns_dev *priv,
+	unsigned int offset)
+{
+	bool stats = hps_led_patterns_stats_on(priv);
+	u64 start;
+	u64 ns;
+	u32 val;
+
+	if (!stats && !trace_hps_led_patterns_mmio_read_enabled()) {
+		return ioread32(priv->base_addr + offset);
+	}
+
+	start = ktime_get_ns();
+	val = ioread32(priv->base_addr + offset);
+	ns = ktime_get_ns() - start;
+
+	if (stats) {
+		atomic64_inc(&priv->stats.reg_hw_reads[offset / sizeof(u32)]);
+		hps_led_patterns_hist_add(priv, HPS_LED_PATTERNS_HIST_MMIO_READ, ns);
+	}
+	trace_hps_led_patterns_mmio_read(priv->phys_addr, offset, val, ns);
+
+	return val;
+}
+
+/*
+ * hps_led_patterns_reg_read() - Read a register
+ * @priv: The hps_led_patterns device.
+ * @offset: Byte offset of the register.
+ *
+ * Registers only software writes are served from the shadow copy, which
+ * saves a trip across the bridge. The caller must either hold @priv->lock
+ * or be inside a read_seqbegin()/read_seqretry() section.
+ *
+ * Return: The register value.
+ */
+static u32 hps_led_patterns_reg_read(struct hps_led_patterns_dev *priv,
+	unsigned int offset)
+{
+	unsigned int i = offset / sizeof(u32);
+	u32 val;
+
+	if (hps_led_patterns_stats_on(priv)) {
+		atomic64_inc(&priv->stats.reg_reads[i]);
+	}
+
+	if ((READ_ONCE(priv->volatile_mask) & BIT(i)) ||
+	    READ_ONCE(priv->force_hw_read) || atomic_read(&priv->mmap_count)) {
+		return hps_led_patterns_hw_read(priv, offset);
+	}
+
+	val = priv->shadow[i];
+	trace_hps_led_patterns_shadow_read(priv->phys_addr, offset, val);
+
+	return val;
+}
+
+/*
+ * hps_led_patterns_reg_write() - Write a register
+ * @priv: The hps_led_patterns device; the caller holds @priv->lock.
+ * @offset: Byte offset of the register.
+ * @val: The value to write.
+ */
+static void hps_led_patterns_reg_write(struct hps_led_patterns_dev *priv,
+	unsigned int offset, u32 val)
+{
+	bool stats = hps_led_patterns_stats_on(priv);
+	u64 start;
+	u64 ns;
+
+	priv->shadow[offset / sizeof(u32)] = val;
+
+	if (!stats && !trace_hps_led_patterns_mmio_write_enabled()) {
+		iowrite32(val, priv->base_addr + offset);
+		return;
+	}
+
+	start = ktime_get_ns();
+	iowrite32(val, priv->base_addr + offset);
+	ns = ktime_get_ns() - start;
+
+	if (stats) {
+		atomic64_inc(&priv->stats.reg_writes[offset / sizeof(u32)]);
+		hps_led_patterns_hist_add(priv, HPS_LED_PATTERNS_HIST_MMIO_WRITE, ns);
+	}
+	trace_hps_led_patterns_mmio_write(priv->phys_addr, offset, val, ns);
+}
+
+/*
+ * hps_led_patterns_read_regs() - Read a consistent snapshot of registers
+ * @priv: The hps_led_patterns device.
+ * @offset: Byte offset of the first register.
+ * @vals: Where to store the register values.
+ * @count: Number of registers to read.
+ *
+ * If a writer changed the registers while we were reading them, they are
+ * read again, so the snapshot is never torn. Writers are never blocked.
+ */
+static void hps_led_patterns_read_regs(struct hps_led_patterns_dev *priv,
+	unsigned int offset, u32 *vals, unsigned int count)
+{
+	unsigned int seq;
+	unsigned int i;
+
+	do {
+		seq = read_seqbegin(&priv->lock);
+		for (i = 0; i < count; i++) {
+			vals[i] = hps_led_patterns_reg_read(priv,
+			                                    offset + i * sizeof(u32));
+		}
+	} while (read_seqretry(&priv->lock, seq));
+}
+
+/*
+ * hps_led_patterns_sync_shadow() - Reload the shadow copy from hardware
+ * @priv: The hps_led_patterns device.
+ */
+static void hps_led_patterns_sync_shadow(struct hps_led_patterns_dev *priv)
+{
+	unsigned long flags;
+	int i;
+
+	flags = hps_led_patterns_lock(priv);
+	for (i = 0; i < NUM_REGS; i++) {
+		priv->shadow[i] = hps_led_patterns_hw_read(priv, i * sizeof(u32));
+	}
+	write_sequnlock_irqrestore(&priv->lock, flags);
+}
+
+
+/*-----------------------------------------------------------------------*/
+/* Register Change Notification                                          */
+/*-----------------------------------------------------------------------*/
+/*
+ * hps_led_patterns_note_changes() - Notify anyone waiting for changes of
+ *                                   some registers
+ * @priv: The hps_led_patterns device; the caller holds @priv->change_lock.
+ * @vals: Current values of all registers.
+ * @mask: The registers (bit n is register n) @vals is valid for.
+ *
+ * Compares the registers with the values we saw last time. If anything
+ * changed, poll()ers on the char device are woken up and the matching
+ * sysfs attributes are notified (so poll() on them returns too).
+ * Everything in here is safe to call from interrupt context.
+ */
+static void hps_led_patterns_note_changes(struct hps_led_patterns_dev *priv,
+	const u32 *vals, u32 mask)
+{
+	bool changed = false;
+	int i;
+
+	for (i = 0; i < NUM_REGS; i++) {
+		if (!(mask & BIT(i)) || vals[i] == priv->last_regs[i]) {
+			continue;
+		}
+
+		priv->last_regs[i] = vals[i];
+		changed = true;
+
+		if (priv->attr_kn[i]) {
+			sysfs_notify_dirent(priv->attr_kn[i]);
+		}
+	}
+
+	if (changed) {
+		atomic_inc(&priv->events);
+		wake_up_interruptible(&priv->wait);
+	}
+}
+
+/*
+ * hps_led_patterns_check_changes() - Look for register changes and 
+ *                                    notify anyone waiting for them
+ * @priv: The hps_led_patterns device.
+ *
+ * The registers are always read from the hardware here, never from the
+ * shadow copy: this is how we find out about changes the FPGA or a
+ * user-space mapping made behind our back. Software writes through the
+ * driver notify on their own, see hps_led_patterns_written().
+ */
+static void hps_led_patterns_check_changes(struct hps_led_patterns_dev *priv)
+{
+	u32 vals[NUM_REGS];
+	unsigned long flags;
+	unsigned int seq;
+	int i;
+
+	spin_lock_irqsave(&priv->change_lock, flags);
+
+	do {
+		seq = read_seqbegin(&priv->lock);
+		for (i = 0; i < NUM_REGS; i++) {
+			vals[i] = hps_led_patterns_hw_read(priv, i * sizeof(u32));
+		}
+	} while (read_seqretry(&priv->lock, seq));
+
+	hps_led_patterns_note_changes(priv, vals, GENMASK(NUM_REGS - 1, 0));
+
+	spin_unlock_irqrestore(&priv->change_lock, flags);
+}
+
+/*
+ * hps_led_patterns_put_attr_nodes() - Drop our references to the sysfs
+ *                                     nodes we notify
+ * @priv: The hps_led_patterns device.
+ */
+static void hps_led_patterns_put_attr_nodes(struct hps_led_patterns_dev *priv)
+{
+	int i;
+
+	for (i = 0; i < NUM_REGS; i++) {
+		if (priv->attr_kn[i]) {
+			sysfs_put(priv->attr_kn[i]);
+			priv->attr_kn[i] = NULL;
+		}
+	}
+}
+
+/*
+ * hps_led_patterns_free() - Free an hps_led_patterns device once the
+ *                           last reference is gone
+ * @ref: The device's reference count.
+ */
+static void hps_led_patterns_free(struct kref *ref)
+{
+	kfree(container_of(ref, struct hps_led_patterns_dev, ref));
+}
+
+/*
+ * hps_led_patterns_put() - Drop a reference to an hps_led_patterns device
+ * @priv: The hps_led_patterns device.
+ */
+static void hps_led_patterns_put(struct hps_led_patterns_dev *priv)
+{
+	kref_put(&priv->ref, hps_led_patterns_free);
+}
+
+/*
+ * hps_led_patterns_put_action() - devm action dropping probe's reference
+ * @data: The hps_led_patterns device.
+ */
+static void hps_led_patterns_put_action(void *data)
+{
+	hps_led_patterns_put(data);
+}
+
+/*
+ * hps_led_patterns_begin_access() - Start a file operation that touches
+ *                                   the registers
+ * @priv: The hps_led_patterns device.
+ *
+ * An open file can outlive an unbind, but the registers can't. On
+ * success the registers stay mapped until hps_led_patterns_end_access().
+ *
+ * Return: 0 on success, or -ENODEV if the device was removed.
+ */
+static int hps_led_patterns_begin_access(struct hps_led_patterns_dev *priv)
+{
+	down_read(&priv->unbind_lock);
+	if (priv->removed) {
+		up_read(&priv->unbind_lock);
+		return -ENODEV;
+	}
+
+	return 0;
+}
+
+/*
+ * hps_led_patterns_end_access() - End a file operation that touches the
+ *                                 registers
+ * @priv: The hps_led_patterns device.
+ */
+static void hps_led_patterns_end_access(struct hps_led_patterns_dev *priv)
+{
+	up_read(&priv->unbind_lock);
+}
+
+/*
+ * hps_led_patterns_written() - Called after software wrote the registers
+ * @priv: The hps_led_patterns device.
+ * @mask: The registers (bit n is register n) that were written.
+ *
+ * Notifies waiters right away, without waiting for the change detector
+ * and without going across the bridge: what we wrote is in the shadow
+ * copy. Only the written registers are looked at, because the shadow copy
+ * of a volatile register may be out of date.
+ */
+static void hps_led_patterns_written(struct hps_led_patterns_dev *priv,
+	u32 mask)
+{
+	u32 vals[NUM_REGS];
+	unsigned long flags;
+	unsigned int seq;
+
+	spin_lock_irqsave(&priv->change_lock, flags);
+
+	do {
+		seq = read_seqbegin(&priv->lock);
+		memcpy(vals, priv->shadow, sizeof(vals));
+	} while (read_seqretry(&priv->lock, seq));
+
+	hps_led_patterns_note_changes(priv, vals, mask);
+
+	spin_unlock_irqrestore(&priv->change_lock, flags);
+}
+
+/*
+ * hps_led_patterns_irq() - FPGA interrupt handler
+ * @irq: Unused.
+ * @dev_id: The hps_led_patterns device.
+ *
+ * Return: IRQ_HANDLED
+ */
+static irqreturn_t hps_led_patterns_irq(int irq, void *dev_id)
+{
+	hps_led_patterns_check_changes(dev_id);
+
+	return IRQ_HANDLED;
+}
+
+/*
+ * hps_led_patterns_change_timer() - Change detector timer callback
+ * @timer: The change_timer in the hps_led_patterns device.
+ *
+ * Return: HRTIMER_RESTART, so the timer keeps running.
+ */
+static enum hrtimer_restart hps_led_patterns_change_timer(struct hrtimer *timer)
+{
+	struct hps_led_patterns_dev *priv = container_of(timer,
+	                              struct hps_led_patterns_dev, change_timer);
+
+	hps_led_patterns_check_changes(priv);
+
+	hrtimer_forward_now(timer, us_to_ktime(change_poll_us));
+
+	return HRTIMER_RESTART;
+}
+
+
 /*-----------------------------------------------------------------------*/
 /* REG0: HPS_LED_control register read function show()                   */
 /*-----------------------------------------------------------------------*/
@@ -73,11 +763,16 @@ static ssize_t hps_led_control_show(struct device *dev,
 	struct device_attribute *attr, char *buf)
 {
 	bool hps_control;
+	u32 val;
+	u64 start;
 
 	// Get the private hps_led_patterns data out of the dev struct
 	struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
 
-	hps_control = ioread32(priv->base_addr + REG0_HPS_LED_CONTROL_OFFSET);
+	start = hps_led_patterns_path_begin(priv);
+	hps_led_patterns_read_regs(priv, REG0_HPS_LED_CONTROL_OFFSET, &val, 1);
+	hps_led_patterns_path_end(priv, HPS_LED_PATTERNS_PATH_SHOW, start);
+	hps_control = val;
 
 	return scnprintf(buf, PAGE_SIZE, "%u\n", hps_control);
 }
@@ -99,6 +794,8 @@ static ssize_t hps_led_control_store(struct device *dev,
 	struct device_attribute *attr, const char *buf, size_t size)
 {
 	bool hps_control;
+	unsigned long flags;
+	u64 start;
 	int ret;
 	struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
 
@@ -110,7 +807,13 @@ static ssize_t hps_led_control_store(struct device *dev,
 		return ret;
 	}
 
-	iowrite32(hps_control, priv->base_addr + REG0_HPS_LED_CONTROL_OFFSET);
+	start = hps_led_patterns_path_begin(priv);
+	flags = hps_led_patterns_lock(priv);
+	hps_led_patterns_reg_write(priv, REG0_HPS_LED_CONTROL_OFFSET, hps_control);
+	write_sequnlock_irqrestore(&priv->lock, flags);
+	hps_led_patterns_path_end(priv, HPS_LED_PATTERNS_PATH_STORE, start);
+
+	hps_led_patterns_written(priv, BIT(REG0_HPS_LED_CONTROL_OFFSET / 4));
 
 	// Write was succesful, so we return the number of bytes we wrote.
 	return size;
@@ -119,14 +822,14 @@ static ssize_t hps_led_control_store(struct device *dev,
 
 /*-----------------------------------------------------------------------*/
 /* TODO: Add show() and store() functions for                            */
-/* Registers REG1 (SYS_CLKs_sec) and REG2 (Base_rate)                    */
+/* Registers REG1 (SYS_CLKs_sec) and REG3 (Base_rate)                    */
 /* in component hps_led_patterns                                         */
 /*-----------------------------------------------------------------------*/
 /* Add here...                                                           */
 
 
 /*-----------------------------------------------------------------------*/
-/* REG3: LED_reg register read function show()                           */
+/* REG2: LED_reg register read function show()                           */
 /*-----------------------------------------------------------------------*/
 /*
  * led_reg_show() - Return the led_reg value to user-space via sysfs.
@@ -142,14 +845,19 @@ static ssize_t led_reg_show(struct device *dev,
 	struct device_attribute *attr, char *buf)
 {
 	u8 led_reg;
+	u32 val;
+	u64 start;
 	struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
 
-	led_reg = ioread32(priv->base_addr + REG3_LED_REG_OFFSET);
+	start = hps_led_patterns_path_begin(priv);
+	hps_led_patterns_read_regs(priv, REG2_LED_REG_OFFSET, &val, 1);
+	hps_led_patterns_path_end(priv, HPS_LED_PATTERNS_PATH_SHOW, start);
+	led_reg = val;
 
 	return scnprintf(buf, PAGE_SIZE, "%u\n", led_reg);
 }
 /*-----------------------------------------------------------------------*/
-/* REG3: LED_reg register write function store()                         */
+/* REG2: LED_reg register write function store()                         */
 /*-----------------------------------------------------------------------*/
 /*
  * led_reg_store() - Store the led_reg value.
@@ -166,6 +874,8 @@ static ssize_t led_reg_store(struct device *dev,
 	struct device_attribute *attr, const char *buf, size_t size)
 {
 	u8 led_reg;
+	unsigned long flags;
+	u64 start;
 	int ret;
 	struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
 
@@ -177,7 +887,13 @@ static ssize_t led_reg_store(struct device *dev,
 		return ret;
 	}
 
-	iowrite32(led_reg, priv->base_addr + REG3_LED_REG_OFFSET);
+	start = hps_led_patterns_path_begin(priv);
+	flags = hps_led_patterns_lock(priv);
+	hps_led_patterns_reg_write(priv, REG2_LED_REG_OFFSET, led_reg);
+	write_sequnlock_irqrestore(&priv->lock, flags);
+	hps_led_patterns_path_end(priv, HPS_LED_PATTERNS_PATH_STORE, start);
+
+	hps_led_patterns_written(priv, BIT(REG2_LED_REG_OFFSET / 4));
 
 	// Write was succesful, so we return the number of bytes we wrote.
 	return size;
@@ -185,172 +901,1020 @@ static ssize_t led_reg_store(struct device *dev,
 
 
 /*-----------------------------------------------------------------------*/
-/* sysfs Attributes                                                      */
+/* LED pattern sequencer position function show()                        */
 /*-----------------------------------------------------------------------*/
-// Define sysfs attributes
-static DEVICE_ATTR_RW(hps_led_control);    // Attribute for REG0
-/* TODO: Add the attributes for REG1 and REG2 using register names       */
-static DEVICE_ATTR_RW(led_reg);            // Attribute for REG3
+/*
+ * seq_position_show() - Return the sequencer position to user-space 
+ *                       via sysfs.
+ * @dev: Device structure for the hps_led_patterns component.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * The position is shown as "<step>/<number of steps>".
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t seq_position_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u/%u\n",
+	                 READ_ONCE(priv->seq_pos), READ_ONCE(priv->seq_count));
+}
+
+
+/*-----------------------------------------------------------------------*/
+/* Register file binary attribute read()                                 */
+/*-----------------------------------------------------------------------*/
+/*
+ * registers_read() - Return raw register values to user-space via sysfs.
+ * @filp: Unused.
+ * @kobj: kobject of the device the attribute belongs to.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ * @off: Byte offset of the first register being read.
+ * @count: The number of bytes being read.
+ *
+ * The attribute holds the little-endian register file at the registers'
+ * native offsets, so the whole file can be snapshot with a single pread()
+ * and no string conversions. The sysfs core keeps @off and @count within
+ * SPAN; we only accept whole, 32-bit-aligned registers.
+ *
+ * Return: The number of bytes read, or a negative error value.
+ */
+static ssize_t registers_read(struct file *filp, struct kobject *kobj,
+	struct bin_attribute *attr, char *buf, loff_t off, size_t count)
+{
+	u32 vals[NUM_REGS];
+	__le32 le;
+	unsigned int i;
+	u64 start;
+	struct hps_led_patterns_dev *priv = dev_get_drvdata(kobj_to_dev(kobj));
+
+	if ((off % 0x4) != 0 || (count % 0x4) != 0) {
+		return -EINVAL;
+	}
+
+	start = hps_led_patterns_path_begin(priv);
+	hps_led_patterns_read_regs(priv, off, vals, count / sizeof(u32));
+	hps_led_patterns_path_end(priv, HPS_LED_PATTERNS_PATH_SHOW, start);
+
+	for (i = 0; i < count / sizeof(u32); i++) {
+		le = cpu_to_le32(vals[i]);
+		memcpy(buf + i * sizeof(u32), &le, sizeof(le));
+	}
+
+	return count;
+}
+/*-----------------------------------------------------------------------*/
+/* Register file binary attribute write()                                */
+/*-----------------------------------------------------------------------*/
+/*
+ * registers_write() - Store raw register values.
+ * @filp: Unused.
+ * @kobj: kobject of the device the attribute belongs to.
+ * @attr: Unused.
+ * @buf: Buffer that contains the little-endian register values.
+ * @off: Byte offset of the first register being written.
+ * @count: The number of bytes being written.
+ *
+ * All registers given are written under a single acquisition of the
+ * device lock, so a whole register file can be restored atomically.
+ *
+ * Return: The number of bytes stored, or a negative error value.
+ */
+static ssize_t registers_write(struct file *filp, struct kobject *kobj,
+	struct bin_attribute *attr, char *buf, loff_t off, size_t count)
+{
+	unsigned long flags;
+	__le32 le;
+	unsigned int i;
+	u32 mask = 0;
+	u64 start;
+	struct hps_led_patterns_dev *priv = dev_get_drvdata(kobj_to_dev(kobj));
+
+	if ((off % 0x4) != 0 || (count % 0x4) != 0) {
+		return -EINVAL;
+	}
+
+	start = hps_led_patterns_path_begin(priv);
+	flags = hps_led_patterns_lock(priv);
+	for (i = 0; i < count / sizeof(u32); i++) {
+		memcpy(&le, buf + i * sizeof(u32), sizeof(le));
+		hps_led_patterns_reg_write(priv, off + i * sizeof(u32),
+		                           le32_to_cpu(le));
+		mask |= BIT(off / sizeof(u32) + i);
+	}
+	write_sequnlock_irqrestore(&priv->lock, flags);
+	hps_led_patterns_path_end(priv, HPS_LED_PATTERNS_PATH_STORE, start);
+
+	hps_led_patterns_written(priv, mask);
+
+	return count;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/* sysfs Attributes                                                      */
+/*-----------------------------------------------------------------------*/
+// Define sysfs attributes
+static DEVICE_ATTR_RW(hps_led_control);    // Attribute for REG0
+/* TODO: Add the attributes for REG1 and REG3 using register names       */
+static DEVICE_ATTR_RW(led_reg);            // Attribute for REG2
+static DEVICE_ATTR_RO(seq_position);       // LED pattern sequencer
+static BIN_ATTR_RW(registers, SPAN);       // Raw register file
+
+// Create an atribute group so the device core can 
+// export the attributes for us.
+static struct attribute *hps_led_patterns_attrs[] = {
+	&dev_attr_hps_led_control.attr,
+/* TODO: Add the attribute entries for REG1 and REG3 using register names*/
+	&dev_attr_led_reg.attr,
+	&dev_attr_seq_position.attr,
+	NULL,
+};
+static struct bin_attribute *hps_led_patterns_bin_attrs[] = {
+	&bin_attr_registers,
+	NULL,
+};
+static const struct attribute_group hps_led_patterns_group = {
+	.attrs = hps_led_patterns_attrs,
+	.bin_attrs = hps_led_patterns_bin_attrs,
+};
+__ATTRIBUTE_GROUPS(hps_led_patterns);
+
+
+/*-----------------------------------------------------------------------*/
+/* File Operations open() and release()                                  */
+/*-----------------------------------------------------------------------*/
+/*
+ * hps_led_patterns_open() - Open method for the hps_led_patterns char device
+ * @inode: Unused.
+ * @file: Pointer to the char device file struct.
+ *
+ * The misc device core sets the file's private_data to our miscdev before
+ * calling us. We swap it for per-open file data, which remembers which 
+ * register changes this file has already seen (for poll()).
+ *
+ * Return: 0 on success, or a negative error value.
+ */
+static int hps_led_patterns_open(struct inode *inode, struct file *file)
+{
+	struct hps_led_patterns_file *hfile;
+
+	/*
+	 * Get the device's private data from the file struct's private_data
+	 * field. The private_data field is equal to the miscdev field in the
+	 * hps_led_patterns_dev struct. container_of returns the 
+	 * hps_led_patterns_dev struct that contains the miscdev in private_data.
+	 */
+	struct hps_led_patterns_dev *priv = container_of(file->private_data,
+	                              struct hps_led_patterns_dev, miscdev);
+
+	hfile = kzalloc(sizeof(*hfile), GFP_KERNEL);
+	if (!hfile) {
+		return -ENOMEM;
+	}
+
+	kref_get(&priv->ref);
+	hfile->priv = priv;
+	hfile->seen_events = atomic_read(&priv->events);
+	file->private_data = hfile;
+
+	return 0;
+}
+
+/*
+ * hps_led_patterns_release() - Release method for the hps_led_patterns 
+ *                              char device
+ * @inode: Unused.
+ * @file: Pointer to the char device file struct.
+ *
+ * Return: 0
+ */
+static int hps_led_patterns_release(struct inode *inode, struct file *file)
+{
+	struct hps_led_patterns_file *hfile = file->private_data;
+
+	hps_led_patterns_put(hfile->priv);
+	kfree(hfile);
+
+	return 0;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/* File Operations read()                                                */
+/*-----------------------------------------------------------------------*/
+/*
+ * hps_led_patterns_read() - Read method for the hps_led_patterns char device
+ * @file: Pointer to the char device file struct.
+ * @buf: User-space buffer to read the value into.
+ * @count: The number of bytes being requested.
+ * @offset: The byte offset in the file being read from.
+ *
+ * Any run of whole registers starting at a 32-bit-aligned offset can be
+ * read with a single call, up to the end of the register span. @count is
+ * rounded down to a whole number of registers.
+ *
+ * Return: On success, the number of bytes written is returned and the
+ * offset @offset is advanced by this number. On error, a negative error
+ * value is returned.
+ */
+static ssize_t hps_led_patterns_read(struct file *file, char __user *buf,
+	size_t count, loff_t *offset)
+{
+	u32 vals[SPAN / sizeof(u32)];
+	u64 start;
+	int ret;
+
+	loff_t pos = *offset;
+
+	/*
+	 * Get the device's private data from the per-open file data that
+	 * hps_led_patterns_open() stored in the file struct's private_data.
+	 */
+	struct hps_led_patterns_file *hfile = file->private_data;
+	struct hps_led_patterns_dev *priv = hfile->priv;
+
+	start = hps_led_patterns_path_begin(priv);
+
+	// Check file offset to make sure we are reading to a valid location.
+	if (pos < 0) {
+		// We can't read from a negative file position.
+		return -EINVAL;
+	}
+	if (pos >= SPAN) {
+		// We can't read from a position past the end of our device.
+		return 0;
+	}
+	if ((pos % 0x4) != 0) {
+		/*
+		 * Prevent unaligned access. Even though the hardware
+		 * technically supports unaligned access, we want to
+		 * ensure that we only access 32-bit-aligned addresses
+		 * because our registers are 32-bit-aligned.
+		 */
+		pr_warn("hps_led_patterns_read: unaligned access\n");
+		return -EFAULT;
+	}
+
+	// If the user didn't request any bytes, don't return any bytes :)
+	if (count == 0) {
+		return 0;
+	}
+
+	// Only hand out whole registers, and stop at the end of our device.
+	count = min_t(size_t, count, SPAN - pos) & ~(size_t)0x3;
+	if (count == 0) {
+		// The user's buffer can't hold even a single register.
+		return -EINVAL;
+	}
+
+	ret = hps_led_patterns_begin_access(priv);
+	if (ret) {
+		return ret;
+	}
+
+	// Anything that changes from here on makes poll() report us again.
+	hfile->seen_events = atomic_read(&priv->events);
+
+	/*
+	 * Read all the requested registers in one go, from the shadow copy
+	 * where we can. The snapshot is never torn by concurrent writers.
+	 */
+	hps_led_patterns_read_regs(priv, pos, vals, count / sizeof(u32));
+
+	hps_led_patterns_end_access(priv);
+
+	if (copy_to_user(buf, vals, count)) {
+		pr_warn("hps_led_patterns_read: copy to user space failed\n");
+		return -EFAULT;
+	}
+
+	// Increment the file offset by the number of bytes we read.
+	*offset = pos + count;
+
+	hps_led_patterns_path_end(priv, HPS_LED_PATTERNS_PATH_READ, start);
+
+	return count;
+}
+/*-----------------------------------------------------------------------*/
+/* File Operations write()                                               */
+/*-----------------------------------------------------------------------*/
+/*
+ * hps_led_patterns_write() - Write method for the hps_led_patterns char device
+ * @file: Pointer to the char device file struct.
+ * @buf: User-space buffer to read the value from.
+ * @count: The number of bytes being written.
+ * @offset: The byte offset in the file being written to.
+ *
+ * Any run of whole registers starting at a 32-bit-aligned offset can be
+ * written with a single call, up to the end of the register span. @count
+ * is rounded down to a whole number of registers.
+ *
+ * Return: On success, the number of bytes written is returned and the
+ * offset @offset is advanced by this number. On error, a negative error
+ * value is returned.
+ */
+static ssize_t hps_led_patterns_write(struct file *file, const char __user *buf,
+	size_t count, loff_t *offset)
+{
+	u32 vals[SPAN / sizeof(u32)];
+	unsigned long flags;
+	unsigned int i;
+	u32 mask = 0;
+	u64 start;
+	int ret;
+
+	loff_t pos = *offset;
+
+	/*
+	 * Get the device's private data from the per-open file data that
+	 * hps_led_patterns_open() stored in the file struct's private_data.
+	 */
+	struct hps_led_patterns_file *hfile = file->private_data;
+	struct hps_led_patterns_dev *priv = hfile->priv;
+
+	start = hps_led_patterns_path_begin(priv);
+
+	// Check file offset to make sure we are writing to a valid location.
+	if (pos < 0) {
+		// We can't write to a negative file position.
+		return -EINVAL;
+	}
+	if (pos >= SPAN) {
+		// We can't write to a position past the end of our device.
+		return 0;
+	}
+	if ((pos % 0x4) != 0) {
+		/*
+		 * Prevent unaligned access. Even though the hardware
+		 * technically supports unaligned access, we want to
+		 * ensure that we only access 32-bit-aligned addresses
+		 * because our registers are 32-bit-aligned.
+		 */
+		pr_warn("hps_led_patterns_write: unaligned access\n");
+		return -EFAULT;
+	}
+
+	// If the user didn't request to write anything, return 0.
+	if (count == 0) {
+		return 0;
+	}
+
+	// Only accept whole registers, and stop at the end of our device.
+	count = min_t(size_t, count, SPAN - pos) & ~(size_t)0x3;
+	if (count == 0) {
+		// The user didn't give us even a single register.
+		return -EINVAL;
+	}
+
+	/*
+	 * Copy the values in before taking the lock; copy_from_user() can
+	 * fault and sleep, which we must never do while holding a spinlock.
+	 */
+	if (copy_from_user(vals, buf, count)) {
+		pr_warn("hps_led_patterns_write: copy from user space failed\n");
+		return -EFAULT;
+	}
+
+	/*
+	 * Write the values we were given starting at the offset given by pos.
+	 * Each register gets a single 32-bit store; the component has no byte
+	 * enables, so the byte accesses memcpy_toio() may use would corrupt it.
+	 */
+	ret = hps_led_patterns_begin_access(priv);
+	if (ret) {
+		return ret;
+	}
+
+	flags = hps_led_patterns_lock(priv);
+	for (i = 0; i < count / sizeof(u32); i++) {
+		hps_led_patterns_reg_write(priv, pos + i * sizeof(u32), vals[i]);
+		mask |= BIT(pos / sizeof(u32) + i);
+	}
+	write_sequnlock_irqrestore(&priv->lock, flags);
+
+	hps_led_patterns_written(priv, mask);
+
+	hps_led_patterns_end_access(priv);
+
+	// Increment the file offset by the number of bytes we wrote.
+	*offset = pos + count;
+
+	hps_led_patterns_path_end(priv, HPS_LED_PATTERNS_PATH_WRITE, start);
+
+	// Return the number of bytes we wrote.
+	return count;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/* Register Transactions                                                 */
+/*-----------------------------------------------------------------------*/
+/*
+ * hps_led_patterns_apply_op() - Apply one register operation
+ * @priv: The hps_led_patterns device; the caller holds @priv->lock.
+ * @offset: Byte offset of the register.
+ * @op: HPS_LED_PATTERNS_OP_* operation.
+ * @value: Operand of @op.
+ */
+static void hps_led_patterns_apply_op(struct hps_led_patterns_dev *priv,
+	u32 offset, u32 op, u32 value)
+{
+	u32 val;
+
+	switch (op) {
+	case HPS_LED_PATTERNS_OP_WRITE:
+		hps_led_patterns_reg_write(priv, offset, value);
+		break;
+	case HPS_LED_PATTERNS_OP_SET:
+		val = hps_led_patterns_reg_read(priv, offset);
+		hps_led_patterns_reg_write(priv, offset, val | value);
+		break;
+	case HPS_LED_PATTERNS_OP_CLEAR:
+		val = hps_led_patterns_reg_read(priv, offset);
+		hps_led_patterns_reg_write(priv, offset, val & ~value);
+		break;
+	default:
+		break;
+	}
+}
+
+/*
+ * hps_led_patterns_transaction() - Apply a batch of register operations
+ * @priv: The hps_led_patterns device.
+ * @arg: User-space pointer to a struct hps_led_patterns_transaction.
+ *
+ * The whole batch is copied in and validated before anything touches
+ * the hardware. The operations are then applied in order under a single
+ * acquisition of the device lock, and each register is read back into
+ * the entry's result field. Finally the batch is copied back out, so a
+ * complete reconfiguration costs a single system call.
+ *
+ * Return: 0 on success, or a negative error value.
+ */
+static long hps_led_patterns_transaction(struct hps_led_patterns_dev *priv,
+	void __user *arg)
+{
+	struct hps_led_patterns_transaction tr;
+	struct hps_led_patterns_reg_op *ops;
+	void __user *uops;
+	size_t size;
+	unsigned long flags;
+	u32 mask = 0;
+	long ret = 0;
+	u32 i;
+
+	if (copy_from_user(&tr, arg, sizeof(tr))) {
+		return -EFAULT;
+	}
+	if (tr.reserved != 0 || tr.count == 0 ||
+	    tr.count > HPS_LED_PATTERNS_MAX_OPS) {
+		return -EINVAL;
+	}
+
+	uops = u64_to_user_ptr(tr.ops);
+	size = tr.count * sizeof(*ops);
+
+	// Get the whole batch before we touch the hardware.
+	ops = memdup_user(uops, size);
+	if (IS_ERR(ops)) {
+		return PTR_ERR(ops);
+	}
+
+	// Validate every entry so we never apply half a transaction.
+	for (i = 0; i < tr.count; i++) {
+		if (ops[i].offset >= SPAN || (ops[i].offset % 0x4) != 0 ||
+		    ops[i].op > HPS_LED_PATTERNS_OP_CLEAR) {
+			ret = -EINVAL;
+			goto out;
+		}
+	}
+
+	ret = hps_led_patterns_begin_access(priv);
+	if (ret) {
+		goto out;
+	}
+
+	flags = hps_led_patterns_lock(priv);
+
+	for (i = 0; i < tr.count; i++) {
+		hps_led_patterns_apply_op(priv, ops[i].offset, ops[i].op,
+		                          ops[i].value);
+
+		// Read the register back so user-space sees what stuck.
+		ops[i].result = hps_led_patterns_reg_read(priv, ops[i].offset);
+
+		if (ops[i].op != HPS_LED_PATTERNS_OP_READ) {
+			mask |= BIT(ops[i].offset / sizeof(u32));
+		}
+	}
+
+	write_sequnlock_irqrestore(&priv->lock, flags);
+
+	hps_led_patterns_written(priv, mask);
+
+	hps_led_patterns_end_access(priv);
+
+	if (copy_to_user(uops, ops, size)) {
+		ret = -EFAULT;
+	}
+
+out:
+	kfree(ops);
+	return ret;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/* Grouped Access                                                        */
+/*-----------------------------------------------------------------------*/
+/*
+ * hps_led_patterns_find() - Look up an instance by number
+ * @id: The instance number.
+ *
+ * The caller holds hps_led_patterns_list_lock.
+ *
+ * Return: The instance, or NULL if there is no such instance.
+ */
+static struct hps_led_patterns_dev *hps_led_patterns_find(u32 id)
+{
+	struct hps_led_patterns_dev *priv;
+
+	list_for_each_entry(priv, &hps_led_patterns_list, node) {
+		if (priv->id == id) {
+			return priv;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * hps_led_patterns_group_write() - Update one register on several 
+ *                                  instances
+ * @arg: User-space pointer to a struct hps_led_patterns_group_write.
+ *
+ * All instances are looked up before any of them is touched, so an
+ * unknown instance number changes nothing. Holding the instance list
+ * lock keeps the instances from going away while we update them; each
+ * one is updated under its own device lock.
+ *
+ * Return: 0 on success, or a negative error value.
+ */
+static long hps_led_patterns_group_write(void __user *arg)
+{
+	struct hps_led_patterns_dev *targets[HPS_LED_PATTERNS_MAX_GROUP];
+	struct hps_led_patterns_group_write gw;
+	struct hps_led_patterns_dev *priv;
+	unsigned long flags;
+	long ret = 0;
+	u64 start;
+	u32 *ids;
+	u32 i;
+
+	if (copy_from_user(&gw, arg, sizeof(gw))) {
+		return -EFAULT;
+	}
+	if (gw.count == 0 || gw.count > HPS_LED_PATTERNS_MAX_GROUP ||
+	    gw.offset >= SPAN || (gw.offset % 0x4) != 0 ||
+	    gw.op < HPS_LED_PATTERNS_OP_WRITE || gw.op > HPS_LED_PATTERNS_OP_CLEAR) {
+		return -EINVAL;
+	}
+
+	ids = memdup_user(u64_to_user_ptr(gw.ids), gw.count * sizeof(*ids));
+	if (IS_ERR(ids)) {
+		return PTR_ERR(ids);
+	}
+
+	mutex_lock(&hps_led_patterns_list_lock);
+
+	for (i = 0; i < gw.count; i++) {
+		targets[i] = hps_led_patterns_find(ids[i]);
+		if (!targets[i]) {
+			ret = -ENODEV;
+			goto unlock;
+		}
+	}
+
+	for (i = 0; i < gw.count; i++) {
+		priv = targets[i];
+
+		start = hps_led_patterns_path_begin(priv);
+		flags = hps_led_patterns_lock(priv);
+		hps_led_patterns_apply_op(priv, gw.offset, gw.op, gw.value);
+		write_sequnlock_irqrestore(&priv->lock, flags);
+		hps_led_patterns_path_end(priv, HPS_LED_PATTERNS_PATH_GROUP, start);
+
+		hps_led_patterns_written(priv, BIT(gw.offset / sizeof(u32)));
+	}
+
+unlock:
+	mutex_unlock(&hps_led_patterns_list_lock);
+	kfree(ids);
+	return ret;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/* LED Pattern Sequencer                                                 */
+/*-----------------------------------------------------------------------*/
+/*
+ * hps_led_patterns_seq_timer() - Sequencer timer callback
+ * @timer: The seq_timer in the hps_led_patterns device.
+ *
+ * Moves on to the next step of the sequence and writes its value to
+ * LED_reg. The timer is forwarded from its previous expiry time, so step
+ * durations don't accumulate scheduling latency.
+ *
+ * Like every other register write, each step notifies poll() and sysfs
+ * waiters through hps_led_patterns_written(). This runs in hardirq
+ * context, which hps_led_patterns_check_changes() allows for (the change
+ * timer and the FPGA interrupt call it from there too), so the
+ * notification isn't deferred. It has to come after the seqlock is
+ * released, because it reads the registers as a seqlock reader.
+ *
+ * Return: HRTIMER_RESTART while the sequence is running.
+ */
+static enum hrtimer_restart hps_led_patterns_seq_timer(struct hrtimer *timer)
+{
+	struct hps_led_patterns_dev *priv = container_of(timer,
+	                              struct hps_led_patterns_dev, seq_timer);
+	const struct hps_led_patterns_step *step;
+	unsigned long flags;
+
+	flags = hps_led_patterns_lock(priv);
+
+	if (priv->seq_pos + 1 < priv->seq_count) {
+		priv->seq_pos++;
+	} else if (priv->seq_flags & HPS_LED_PATTERNS_SEQ_LOOP) {
+		priv->seq_pos = 0;
+		priv->seq_loops++;
+	} else {
+		// One-shot sequence is done; leave the last step showing.
+		priv->seq_running = false;
+		write_sequnlock_irqrestore(&priv->lock, flags);
+		return HRTIMER_NORESTART;
+	}
+
+	step = &priv->seq_steps[priv->seq_pos];
+	hps_led_patterns_reg_write(priv, REG2_LED_REG_OFFSET, step->led);
+	hrtimer_forward_now(timer, us_to_ktime(step->duration_us));
+
+	write_sequnlock_irqrestore(&priv->lock, flags);
+
+	hps_led_patterns_written(priv, BIT(REG2_LED_REG_OFFSET / 4));
+
+	return HRTIMER_RESTART;
+}
+
+/*
+ * hps_led_patterns_seq_stop() - Stop the LED pattern sequence
+ * @priv: The hps_led_patterns device; the caller holds seq_mutex.
+ */
+static void hps_led_patterns_seq_stop(struct hps_led_patterns_dev *priv)
+{
+	unsigned long flags;
+
+	hrtimer_cancel(&priv->seq_timer);
+
+	flags = hps_led_patterns_lock(priv);
+	priv->seq_running = false;
+	write_sequnlock_irqrestore(&priv->lock, flags);
+}
+
+/*
+ * hps_led_patterns_seq_start() - Play the loaded LED pattern sequence
+ *                                from its first step
+ * @priv: The hps_led_patterns device; the caller holds seq_mutex.
+ *
+ * Return: 0 on success, or -EINVAL if no sequence is loaded.
+ */
+static int hps_led_patterns_seq_start(struct hps_led_patterns_dev *priv)
+{
+	unsigned long flags;
+
+	if (!priv->seq_steps) {
+		return -EINVAL;
+	}
+
+	hps_led_patterns_seq_stop(priv);
+
+	flags = hps_led_patterns_lock(priv);
+	priv->seq_pos = 0;
+	priv->seq_loops = 0;
+	priv->seq_running = true;
+	hps_led_patterns_reg_write(priv, REG2_LED_REG_OFFSET,
+	                           priv->seq_steps[0].led);
+	write_sequnlock_irqrestore(&priv->lock, flags);
+
+	hps_led_patterns_written(priv, BIT(REG2_LED_REG_OFFSET / 4));
+
+	hrtimer_start(&priv->seq_timer,
+	              us_to_ktime(priv->seq_steps[0].duration_us),
+	              HRTIMER_MODE_REL);
+
+	return 0;
+}
+
+/*
+ * hps_led_patterns_seq_load() - Load a new LED pattern sequence
+ * @priv: The hps_led_patterns device.
+ * @arg: User-space pointer to a struct hps_led_patterns_sequence.
+ *
+ * The whole table is copied in with a single call. Any running sequence
+ * is stopped; use HPS_LED_PATTERNS_IOC_SEQ_START to play the new one.
+ *
+ * Return: 0 on success, -ENODEV if the device was removed, or another
+ * negative error value.
+ */
+static long hps_led_patterns_seq_load(struct hps_led_patterns_dev *priv,
+	void __user *arg)
+{
+	struct hps_led_patterns_sequence seq;
+	struct hps_led_patterns_step *steps;
+	struct hps_led_patterns_step *old_steps;
+	unsigned long flags;
+	u32 i;
+
+	if (copy_from_user(&seq, arg, sizeof(seq))) {
+		return -EFAULT;
+	}
+	if (seq.count == 0 || seq.count > HPS_LED_PATTERNS_MAX_STEPS ||
+	    (seq.flags & ~HPS_LED_PATTERNS_SEQ_LOOP)) {
+		return -EINVAL;
+	}
+
+	steps = vmemdup_user(u64_to_user_ptr(seq.steps),
+	                     seq.count * sizeof(*steps));
+	if (IS_ERR(steps)) {
+		return PTR_ERR(steps);
+	}
+
+	for (i = 0; i < seq.count; i++) {
+		if (steps[i].duration_us < HPS_LED_PATTERNS_MIN_STEP_US) {
+			kvfree(steps);
+			return -EINVAL;
+		}
+	}
+
+	mutex_lock(&priv->seq_mutex);
+
+	if (priv->removed) {
+		mutex_unlock(&priv->seq_mutex);
+		kvfree(steps);
+		return -ENODEV;
+	}
+
+	hps_led_patterns_seq_stop(priv);
+
+	flags = hps_led_patterns_lock(priv);
+	old_steps = priv->seq_steps;
+	priv->seq_steps = steps;
+	priv->seq_count = seq.count;
+	priv->seq_flags = seq.flags;
+	priv->seq_pos = 0;
+	priv->seq_loops = 0;
+	write_sequnlock_irqrestore(&priv->lock, flags);
+
+	mutex_unlock(&priv->seq_mutex);
+
+	kvfree(old_steps);
+
+	return 0;
+}
+
+/*
+ * hps_led_patterns_seq_status() - Return the sequencer status
+ * @priv: The hps_led_patterns device.
+ * @arg: User-space pointer to a struct hps_led_patterns_seq_status.
+ *
+ * Return: 0 on success, or -EFAULT.
+ */
+static long hps_led_patterns_seq_status(struct hps_led_patterns_dev *priv,
+	void __user *arg)
+{
+	struct hps_led_patterns_seq_status status;
+	unsigned int seq;
+
+	do {
+		seq = read_seqbegin(&priv->lock);
+		status.running = priv->seq_running;
+		status.position = priv->seq_pos;
+		status.count = priv->seq_count;
+		status.loops = priv->seq_loops;
+	} while (read_seqretry(&priv->lock, seq));
+
+	if (copy_to_user(arg, &status, sizeof(status))) {
+		return -EFAULT;
+	}
+
+	return 0;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/* File Operations ioctl()                                               */
+/*-----------------------------------------------------------------------*/
+/*
+ * hps_led_patterns_ioctl() - ioctl method for the hps_led_patterns 
+ *                            char device
+ * @file: Pointer to the char device file struct.
+ * @cmd: The ioctl command (see hps_led_patterns.h).
+ * @arg: The ioctl argument; a user-space pointer for all our commands.
+ *
+ * Return: 0 on success, or a negative error value.
+ */
+static long hps_led_patterns_ioctl(struct file *file, unsigned int cmd,
+	unsigned long arg)
+{
+	struct hps_led_patterns_file *hfile = file->private_data;
+	struct hps_led_patterns_dev *priv = hfile->priv;
+	long ret;
 
-// Create an atribute group so the device core can 
-// export the attributes for us.
-static struct attribute *hps_led_patterns_attrs[] = {
-	&dev_attr_hps_led_control.attr,
-/* TODO: Add the attribute entries for REG1 and REG2 using register names*/
-	&dev_attr_led_reg.attr,
-	NULL,
-};
-ATTRIBUTE_GROUPS(hps_led_patterns);
+	switch (cmd) {
+	case HPS_LED_PATTERNS_IOC_TRANSACTION:
+		return hps_led_patterns_transaction(priv, (void __user *)arg);
+	case HPS_LED_PATTERNS_IOC_SEQ_LOAD:
+		return hps_led_patterns_seq_load(priv, (void __user *)arg);
+	case HPS_LED_PATTERNS_IOC_SEQ_START:
+		mutex_lock(&priv->seq_mutex);
+		ret = priv->removed ? -ENODEV : hps_led_patterns_seq_start(priv);
+		mutex_unlock(&priv->seq_mutex);
+		return ret;
+	case HPS_LED_PATTERNS_IOC_SEQ_STOP:
+		mutex_lock(&priv->seq_mutex);
+		ret = priv->removed ? -ENODEV : 0;
+		if (!ret) {
+			hps_led_patterns_seq_stop(priv);
+		}
+		mutex_unlock(&priv->seq_mutex);
+		return ret;
+	case HPS_LED_PATTERNS_IOC_SEQ_STATUS:
+		return hps_led_patterns_seq_status(priv, (void __user *)arg);
+	case HPS_LED_PATTERNS_IOC_GROUP_WRITE:
+		return hps_led_patterns_group_write((void __user *)arg);
+	default:
+		return -ENOTTY;
+	}
+}
 
 
 /*-----------------------------------------------------------------------*/
-/* File Operations read()                                                */
+/* File Operations poll()                                                */
 /*-----------------------------------------------------------------------*/
 /*
- * hps_led_patterns_read() - Read method for the hps_led_patterns char device
+ * hps_led_patterns_poll() - Poll method for the hps_led_patterns char device
  * @file: Pointer to the char device file struct.
- * @buf: User-space buffer to read the value into.
- * @count: The number of bytes being requested.
- * @offset: The byte offset in the file being read from.
+ * @wait: Poll table to add our wait queue to.
  *
- * Return: On success, the number of bytes written is returned and the
- * offset @offset is advanced by this number. On error, a negative error
- * value is returned.
+ * The file is reported readable (and as having priority data) once any
+ * register changed since the file was last read(). User-space can block
+ * in poll()/epoll_wait() instead of polling the registers itself.
+ *
+ * Return: The poll event mask.
  */
-static ssize_t hps_led_patterns_read(struct file *file, char __user *buf,
-	size_t count, loff_t *offset)
+static __poll_t hps_led_patterns_poll(struct file *file, poll_table *wait)
 {
-	size_t ret;
-	u32 val;
-
-	loff_t pos = *offset;
+	struct hps_led_patterns_file *hfile = file->private_data;
+	struct hps_led_patterns_dev *priv = hfile->priv;
 
-	/*
-	 * Get the device's private data from the file struct's private_data
-	 * field. The private_data field is equal to the miscdev field in the
-	 * hps_led_patterns_dev struct. container_of returns the 
-     * hps_led_patterns_dev struct that contains the miscdev in private_data.
-	 */
-	struct hps_led_patterns_dev *priv = container_of(file->private_data,
-	                            struct hps_led_patterns_dev, miscdev);
+	poll_wait(file, &priv->wait, wait);
 
-	// Check file offset to make sure we are reading to a valid location.
-	if (pos < 0) {
-		// We can't read from a negative file position.
-		return -EINVAL;
-	}
-	if (pos >= SPAN) {
-		// We can't read from a position past the end of our device.
-		return 0;
-	}
-	if ((pos % 0x4) != 0) {
-		/*
-		 * Prevent unaligned access. Even though the hardware
-		 * technically supports unaligned access, we want to
-		 * ensure that we only access 32-bit-aligned addresses
-		 * because our registers are 32-bit-aligned.
-		 */
-		pr_warn("hps_led_patterns_read: unaligned access\n");
-		return -EFAULT;
+	if (atomic_read(&priv->events) != hfile->seen_events) {
+		return EPOLLIN | EPOLLRDNORM | EPOLLPRI;
 	}
 
-	// If the user didn't request any bytes, don't return any bytes :)
-	if (count == 0) {
-		return 0;
-	}
+	return 0;
+}
 
-	// Read the value at offset pos.
-	val = ioread32(priv->base_addr + pos);
 
-	ret = copy_to_user(buf, &val, sizeof(val));
-	if (ret == sizeof(val)) {
-		// Nothing was copied to the user.
-		pr_warn("hps_led_patterns_read: nothing copied\n");
-		return -EFAULT;
-	}
+/*-----------------------------------------------------------------------*/
+/* File Operations mmap()                                                */
+/*-----------------------------------------------------------------------*/
+/*
+ * hps_led_patterns_vm_open() - Called when a register mapping is copied
+ *                              (e.g. on fork())
+ * @vma: The new user-space virtual memory area.
+ */
+static void hps_led_patterns_vm_open(struct vm_area_struct *vma)
+{
+	struct hps_led_patterns_dev *priv = vma->vm_private_data;
 
-	// Increment the file offset by the number of bytes we read.
-	*offset = pos + sizeof(val);
+	kref_get(&priv->ref);
+	atomic_inc(&priv->mmap_count);
+}
 
-	return sizeof(val);
+/*
+ * hps_led_patterns_vm_close() - Called when a register mapping goes away
+ * @vma: The user-space virtual memory area.
+ *
+ * User-space may have written the registers through the mapping, so the
+ * shadow copy is reloaded once the last mapping is gone. A mapping can
+ * outlive an unbind; then the registers are gone and there is nothing
+ * left to reload.
+ */
+static void hps_led_patterns_vm_close(struct vm_area_struct *vma)
+{
+	struct hps_led_patterns_dev *priv = vma->vm_private_data;
+
+	mutex_lock(&priv->seq_mutex);
+	if (atomic_dec_and_test(&priv->mmap_count) && !priv->removed) {
+		hps_led_patterns_sync_shadow(priv);
+	}
+	mutex_unlock(&priv->seq_mutex);
+
+	hps_led_patterns_put(priv);
 }
-/*-----------------------------------------------------------------------*/
-/* File Operations write()                                               */
-/*-----------------------------------------------------------------------*/
+
+static const struct vm_operations_struct hps_led_patterns_vm_ops = {
+	.open = hps_led_patterns_vm_open,
+	.close = hps_led_patterns_vm_close,
+};
+
 /*
- * hps_led_patterns_write() - Write method for the hps_led_patterns char device
+ * hps_led_patterns_mmap() - Map the hps_led_patterns registers into 
+ *                           user-space
  * @file: Pointer to the char device file struct.
- * @buf: User-space buffer to read the value from.
- * @count: The number of bytes being written.
- * @offset: The byte offset in the file being written to.
+ * @vma: The user-space virtual memory area being mapped.
  *
- * Return: On success, the number of bytes written is returned and the
- * offset @offset is advanced by this number. On error, a negative error
- * value is returned.
+ * The register window is mapped uncached so that every load and store
+ * in user-space turns into a single bus access to the component, just
+ * like ioread32()/iowrite32() in the kernel. This lets user-space poke
+ * the registers without paying for a system call on every access.
+ *
+ * Only a shared mapping of the first page at offset 0 is allowed. The
+ * component must own that whole page: it has to start on a page boundary
+ * and its device tree "reg" entry must be at least PAGE_SIZE long.
+ * Otherwise the mapped page would also expose whatever else lives in it
+ * on the bridge. To allow mmap(), place the component on a page boundary
+ * in Platform Designer and give its device tree node a "reg" size of at
+ * least one page (0x1000).
+ *
+ * While the registers are mapped, the driver reads them from the hardware
+ * instead of its shadow copy. Once the device is unbound its memory region
+ * is released, and new mappings fail with -ENODEV.
+ *
+ * Return: 0 on success, or a negative error value.
  */
-static ssize_t hps_led_patterns_write(struct file *file, const char __user *buf,
-	size_t count, loff_t *offset)
+static int hps_led_patterns_mmap(struct file *file, struct vm_area_struct *vma)
 {
-	size_t ret;
-	u32 val;
-
-	loff_t pos = *offset;
+	unsigned long size = vma->vm_end - vma->vm_start;
+	int ret;
 
-	/*
-	 * Get the device's private data from the file struct's private_data
-	 * field. The private_data field is equal to the miscdev field in the
-	 * hps_led_patterns_dev struct. container_of returns the 
-     * hps_led_patterns_dev struct that contains the miscdev in private_data.
-	 */
-	struct hps_led_patterns_dev *priv = container_of(file->private_data,
-	                              struct hps_led_patterns_dev, miscdev);
+	struct hps_led_patterns_file *hfile = file->private_data;
+	struct hps_led_patterns_dev *priv = hfile->priv;
 
-	// Check file offset to make sure we are writing to a valid location.
-	if (pos < 0) {
-		// We can't write to a negative file position.
+	// The registers only live at the start of the file.
+	if (vma->vm_pgoff != 0) {
 		return -EINVAL;
 	}
-	if (pos >= SPAN) {
-		// We can't write to a position past the end of our device.
-		return 0;
+	// Don't map anything past the page holding our registers.
+	if (size > PAGE_ALIGN(SPAN)) {
+		return -EINVAL;
 	}
-	if ((pos % 0x4) != 0) {
-		/*
-		 * Prevent unaligned access. Even though the hardware
-		 * technically supports unaligned access, we want to
-		 * ensure that we only access 32-bit-aligned addresses
-		 * because our registers are 32-bit-aligned.
-		 */
-		pr_warn("hps_led_patterns_write: unaligned access\n");
-		return -EFAULT;
+	// A private (copy-on-write) mapping makes no sense for registers.
+	if (!(vma->vm_flags & VM_SHARED)) {
+		return -EINVAL;
 	}
-
-	// If the user didn't request to write anything, return 0.
-	if (count == 0) {
-		return 0;
+	if (offset_in_page(priv->phys_addr) != 0) {
+		pr_warn("hps_led_patterns_mmap: registers are not page aligned\n");
+		return -ENODEV;
+	}
+	if (priv->phys_size < PAGE_SIZE) {
+		pr_warn("hps_led_patterns_mmap: registers don't own a whole page\n");
+		return -ENODEV;
 	}
 
-	mutex_lock(&priv->lock);
+	// Registers must never be cached, and the mapping must never grow.
+	vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6,3,0)
+	vma->vm_flags |= VM_IO | VM_DONTEXPAND | VM_DONTDUMP;
+#else
+	vm_flags_set(vma, VM_IO | VM_DONTEXPAND | VM_DONTDUMP);
+#endif
 
-	ret = copy_from_user(&val, buf, sizeof(val));
-	if (ret == sizeof(val)) {
-		// Nothing was copied from the user.
-		pr_warn("hps_led_patterns_write: nothing copied from user space\n");
-		ret = -EFAULT;
-		goto unlock;
+	// Never map a region that remove() has handed back.
+	ret = hps_led_patterns_begin_access(priv);
+	if (ret) {
+		return ret;
 	}
 
-	// Write the value we were given at the address offset given by pos.
-	iowrite32(val, priv->base_addr + pos);
-
-	// Increment the file offset by the number of bytes we wrote.
-	*offset = pos + sizeof(val);
+	ret = io_remap_pfn_range(vma, vma->vm_start,
+	                         priv->phys_addr >> PAGE_SHIFT,
+	                         size, vma->vm_page_prot);
+	if (!ret) {
+		vma->vm_ops = &hps_led_patterns_vm_ops;
+		vma->vm_private_data = priv;
+		kref_get(&priv->ref);
+		atomic_inc(&priv->mmap_count);
+	}
 
-	// Return the number of bytes we wrote.
-	ret = sizeof(val);
+	hps_led_patterns_end_access(priv);
 
-unlock:
-	mutex_unlock(&priv->lock);
 	return ret;
 }
 
@@ -364,16 +1928,217 @@ unlock:
  * @owner: The hps_led_patterns driver owns the file operations; this 
  *         ensures that the driver can't be removed while the 
  *         character device is still in use.
- * @read: The read function.
- * @write: The write function.
+ * @open: The open function.
+ * @release: The release function.
+ * @read: The read function. The kernel calls it once per buffer for
+ *        readv(), so a whole scatter list is still a single system call.
+ * @write: The write function. The kernel calls it once per buffer for
+ *         writev().
  * @llseek: We use the kernel's default_llseek() function; this allows 
  *          users to change what position they are writing/reading to/from.
+ * @unlocked_ioctl: The ioctl function; see hps_led_patterns.h.
+ * @compat_ioctl: Our ioctl arguments are pointers to fixed-size structs,
+ *                so 32-bit callers can use the same handler.
+ * @poll: The poll function; reports register changes.
+ * @mmap: The mmap function; maps the registers directly into user-space.
  */
 static const struct file_operations  hps_led_patterns_fops = {
 	.owner = THIS_MODULE,
+	.open = hps_led_patterns_open,
+	.release = hps_led_patterns_release,
 	.read = hps_led_patterns_read,
 	.write = hps_led_patterns_write,
 	.llseek = default_llseek,
+	.unlocked_ioctl = hps_led_patterns_ioctl,
+	.compat_ioctl = compat_ptr_ioctl,
+	.poll = hps_led_patterns_poll,
+	.mmap = hps_led_patterns_mmap,
+};
+
+
+/*-----------------------------------------------------------------------*/
+/* debugfs Statistics                                                    */
+/*-----------------------------------------------------------------------*/
+/*
+ * hps_led_patterns_stats_print() - Print access statistics
+ * @s: seq_file to print into.
+ * @st: The statistics.
+ *
+ * Histogram buckets are printed as "<lower bound in ns>: <count>", and
+ * only if they are not empty.
+ */
+static void hps_led_patterns_stats_print(struct seq_file *s,
+	struct hps_led_patterns_stats *st)
+{
+	u64 count;
+	int i;
+	int j;
+
+	seq_puts(s, "\npath        calls          total_ns\n");
+	for (i = 0; i < HPS_LED_PATTERNS_NUM_PATHS; i++) {
+		seq_printf(s, "%-8s %12llu %17llu\n", hps_led_patterns_path_names[i],
+		           (u64)atomic64_read(&st->path_calls[i]),
+		           (u64)atomic64_read(&st->path_ns[i]));
+	}
+
+	seq_puts(s, "\nregister       reads     hw_reads       writes\n");
+	for (i = 0; i < NUM_REGS; i++) {
+		seq_printf(s, "0x%02zx     %12llu %12llu %12llu\n", i * sizeof(u32),
+		           (u64)atomic64_read(&st->reg_reads[i]),
+		           (u64)atomic64_read(&st->reg_hw_reads[i]),
+		           (u64)atomic64_read(&st->reg_writes[i]));
+	}
+
+	seq_printf(s, "\nlock_wait_ns: %llu\n", (u64)atomic64_read(&st->lock_ns));
+
+	for (i = 0; i < HPS_LED_PATTERNS_NUM_HISTS; i++) {
+		seq_printf(s, "\n%s latency (ns):\n", hps_led_patterns_hist_names[i]);
+		for (j = 0; j < HIST_BUCKETS; j++) {
+			count = atomic64_read(&st->hist[i][j]);
+			if (count) {
+				seq_printf(s, "%12llu: %llu\n",
+				           j ? 1ULL << (j - 1) : 0ULL, count);
+			}
+		}
+	}
+}
+
+/*
+ * hps_led_patterns_stats_sum() - Add one instance's statistics to a total
+ * @sum: The total.
+ * @st: The instance's statistics.
+ */
+static void hps_led_patterns_stats_sum(struct hps_led_patterns_stats *sum,
+	struct hps_led_patterns_stats *st)
+{
+	int i;
+	int j;
+
+	for (i = 0; i < NUM_REGS; i++) {
+		atomic64_add(atomic64_read(&st->reg_reads[i]), &sum->reg_reads[i]);
+		atomic64_add(atomic64_read(&st->reg_hw_reads[i]),
+		             &sum->reg_hw_reads[i]);
+		atomic64_add(atomic64_read(&st->reg_writes[i]), &sum->reg_writes[i]);
+	}
+	for (i = 0; i < HPS_LED_PATTERNS_NUM_PATHS; i++) {
+		atomic64_add(atomic64_read(&st->path_calls[i]), &sum->path_calls[i]);
+		atomic64_add(atomic64_read(&st->path_ns[i]), &sum->path_ns[i]);
+	}
+	atomic64_add(atomic64_read(&st->lock_ns), &sum->lock_ns);
+	for (i = 0; i < HPS_LED_PATTERNS_NUM_HISTS; i++) {
+		for (j = 0; j < HIST_BUCKETS; j++) {
+			atomic64_add(atomic64_read(&st->hist[i][j]), &sum->hist[i][j]);
+		}
+	}
+}
+
+/*
+ * hps_led_patterns_stats_show() - Print an instance's access statistics
+ * @s: seq_file to print into; its private data is the instance.
+ * @unused: Unused.
+ *
+ * Return: 0
+ */
+static int hps_led_patterns_stats_show(struct seq_file *s, void *unused)
+{
+	struct hps_led_patterns_dev *priv = s->private;
+
+	seq_printf(s, "enabled: %u\n", hps_led_patterns_stats_on(priv));
+	hps_led_patterns_stats_print(s, &priv->stats);
+
+	return 0;
+}
+
+/*
+ * hps_led_patterns_all_stats_show() - Print the statistics of all 
+ *                                     instances added together
+ * @s: seq_file to print into.
+ * @unused: Unused.
+ *
+ * Return: 0 on success, or -ENOMEM.
+ */
+static int hps_led_patterns_all_stats_show(struct seq_file *s, void *unused)
+{
+	struct hps_led_patterns_stats *sum;
+	struct hps_led_patterns_dev *priv;
+	unsigned int instances = 0;
+	unsigned int enabled = 0;
+
+	sum = kzalloc(sizeof(*sum), GFP_KERNEL);
+	if (!sum) {
+		return -ENOMEM;
+	}
+
+	mutex_lock(&hps_led_patterns_list_lock);
+	list_for_each_entry(priv, &hps_led_patterns_list, node) {
+		hps_led_patterns_stats_sum(sum, &priv->stats);
+		instances++;
+		enabled += hps_led_patterns_stats_on(priv);
+	}
+	mutex_unlock(&hps_led_patterns_list_lock);
+
+	seq_printf(s, "instances: %u\nenabled: %u\n", instances, enabled);
+	hps_led_patterns_stats_print(s, sum);
+
+	kfree(sum);
+	return 0;
+}
+
+/*
+ * hps_led_patterns_stats_open() - Open method for the debugfs stats files
+ * @inode: inode of the file; i_private is the hps_led_patterns device,
+ *         or NULL for the file that adds up all instances.
+ * @file: Pointer to the file struct.
+ *
+ * Return: 0 on success, or a negative error value.
+ */
+static int hps_led_patterns_stats_open(struct inode *inode, struct file *file)
+{
+	if (!inode->i_private) {
+		return single_open(file, hps_led_patterns_all_stats_show, NULL);
+	}
+
+	return single_open(file, hps_led_patterns_stats_show, inode->i_private);
+}
+
+/*
+ * hps_led_patterns_stats_write() - Clear the statistics
+ * @file: Pointer to the file struct.
+ * @buf: Unused; writing anything clears the statistics.
+ * @count: The number of bytes being written.
+ * @offset: Unused.
+ *
+ * Writing to the file that adds up all instances clears every instance.
+ *
+ * Return: @count
+ */
+static ssize_t hps_led_patterns_stats_write(struct file *file,
+	const char __user *buf, size_t count, loff_t *offset)
+{
+	struct seq_file *s = file->private_data;
+	struct hps_led_patterns_dev *priv;
+
+	if (s->private) {
+		hps_led_patterns_stats_reset(s->private);
+		return count;
+	}
+
+	mutex_lock(&hps_led_patterns_list_lock);
+	list_for_each_entry(priv, &hps_led_patterns_list, node) {
+		hps_led_patterns_stats_reset(priv);
+	}
+	mutex_unlock(&hps_led_patterns_list_lock);
+
+	return count;
+}
+
+static const struct file_operations hps_led_patterns_stats_fops = {
+	.owner = THIS_MODULE,
+	.open = hps_led_patterns_stats_open,
+	.read = seq_read,
+	.write = hps_led_patterns_stats_write,
+	.llseek = seq_lseek,
+	.release = single_release,
 };
 
 
@@ -394,19 +2159,28 @@ static const struct file_operations  hps_led_patterns_fops = {
 static int hps_led_patterns_probe(struct platform_device *pdev)
 {
 	struct hps_led_patterns_dev *priv;
+	struct resource *res;
 	int ret;
+	int i;
 
 	/*
 	 * Allocate kernel memory for the hps_led_patterns device and set it to 0.
 	 * GFP_KERNEL specifies that we are allocating normal kernel RAM;
-	 * see the kmalloc documentation for more info. The allocated memory
-	 * is automatically freed when the device is removed.
+	 * see the kmalloc documentation for more info. The memory is freed
+	 * when the last reference is dropped: the device's own reference goes
+	 * away when the device is removed, but open files and register
+	 * mappings can keep the struct around for longer.
 	 */
-	priv = devm_kzalloc(&pdev->dev, sizeof(struct hps_led_patterns_dev), GFP_KERNEL);
+	priv = kzalloc(sizeof(struct hps_led_patterns_dev), GFP_KERNEL);
 	if (!priv) {
 		pr_err("Failed to allocate kernel memory for hps_led_pattern\n");
 		return -ENOMEM;
 	}
+	kref_init(&priv->ref);
+	ret = devm_add_action_or_reset(&pdev->dev, hps_led_patterns_put_action, priv);
+	if (ret) {
+		return ret;
+	}
 
 	/*
 	 * Request and remap the device's memory region. Requesting the region
@@ -414,34 +2188,127 @@ static int hps_led_patterns_probe(struct platform_device *pdev)
 	 * into the kernel's virtual address space becuase we don't have access
 	 * to physical memory locations.
 	 */
-	priv->base_addr = devm_platform_ioremap_resource(pdev, 0);
+	priv->base_addr = devm_platform_get_and_ioremap_resource(pdev, 0, &res);
 	if (IS_ERR(priv->base_addr)) {
 		pr_err("Failed to request/remap platform device resource (hps_led_patterns)\n");
 		return PTR_ERR(priv->base_addr);
 	}
+	priv->phys_addr = res->start;
+	priv->phys_size = resource_size(res);
+
+	seqlock_init(&priv->lock);
+	spin_lock_init(&priv->change_lock);
+	init_waitqueue_head(&priv->wait);
+	/* One 32-bit read per register; the bus has no byte enables */
+	hps_led_patterns_sync_shadow(priv);
+	memcpy(priv->last_regs, priv->shadow, SPAN);
+	priv->volatile_mask = volatile_regs;
+	hrtimer_init(&priv->change_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	priv->change_timer.function = hps_led_patterns_change_timer;
+	mutex_init(&priv->seq_mutex);
+	init_rwsem(&priv->unbind_lock);
+	hrtimer_init(&priv->seq_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	priv->seq_timer.function = hps_led_patterns_seq_timer;
+
+	/*
+	 * The FPGA can tell us when it changes the registers through an
+	 * (optional) interrupt in the device tree node. Without one, we
+	 * fall back to a timer that periodically looks for changes.
+	 */
+	priv->irq = platform_get_irq_optional(pdev, 0);
+	if (priv->irq == -EPROBE_DEFER) {
+		return -EPROBE_DEFER;
+	}
+	if (priv->irq < 0) {
+		priv->irq = 0;
+	}
+
+	/*
+	 * Give every instance its own number, so any number of 
+	 * hps_led_patterns components can live side by side.
+	 */
+	priv->id = ida_alloc(&hps_led_patterns_ida, GFP_KERNEL);
+	if (priv->id < 0) {
+		pr_err("Failed to allocate an hps_led_patterns instance number\n");
+		return priv->id;
+	}
+	snprintf(priv->name, sizeof(priv->name), "hps_led_patterns%d", priv->id);
 
 	// Initialize the misc device parameters
 	priv->miscdev.minor = MISC_DYNAMIC_MINOR;
-	priv->miscdev.name = "hps_led_patterns";
+	priv->miscdev.name = priv->name;
 	priv->miscdev.fops = &hps_led_patterns_fops;
 	priv->miscdev.parent = &pdev->dev;
 	priv->miscdev.groups = hps_led_patterns_groups;
 
 	// Register the misc device; this creates a char dev at 
-    // /dev/hps_led_patterns
+    // /dev/hps_led_patterns<id>
 	ret = misc_register(&priv->miscdev);
 	if (ret) {
-		pr_err("Failed to register misc device for hps_led_patterns\n");
-		return ret;
+		pr_err("Failed to register misc device for %s\n", priv->name);
+		goto err_free_id;
 	}
 
 	// Attach the hps_led_patterns' private data to the 
     // platform device's struct.
 	platform_set_drvdata(pdev, priv);
 
-	pr_info("hps_led_patterns_probe successful\n");
+	// Look up the sysfs attributes we notify when registers change.
+	for (i = 0; i < NUM_REGS; i++) {
+		if (hps_led_patterns_notify_attrs[i]) {
+			priv->attr_kn[i] = sysfs_get_dirent(
+				priv->miscdev.this_device->kobj.sd,
+				hps_led_patterns_notify_attrs[i]);
+		}
+	}
+
+	// Start watching for register changes.
+	if (priv->irq > 0) {
+		ret = devm_request_irq(&pdev->dev, priv->irq, hps_led_patterns_irq,
+		                       0, priv->name, priv);
+		if (ret) {
+			pr_err("Failed to request IRQ for %s\n", priv->name);
+			goto err_put_attr_nodes;
+		}
+	} else if (change_poll_us > 0) {
+		hrtimer_start(&priv->change_timer, us_to_ktime(change_poll_us),
+		              HRTIMER_MODE_REL);
+	}
+
+	/*
+	 * debugfs knobs for the shadow registers:
+	 *   force_hw_read - read every register from the hardware
+	 *   volatile_mask - registers that are always read from the hardware
+	 * and the access statistics:
+	 *   stats_enable  - collect statistics
+	 *   stats         - the statistics; write anything to clear them
+	 */
+	priv->debugfs = debugfs_create_dir(priv->name,
+	                                   hps_led_patterns_debugfs_root);
+	debugfs_create_bool("force_hw_read", 0644, priv->debugfs,
+	                    &priv->force_hw_read);
+	debugfs_create_x32("volatile_mask", 0644, priv->debugfs,
+	                   &priv->volatile_mask);
+	debugfs_create_bool("stats_enable", 0644, priv->debugfs,
+	                    &priv->stats_enable);
+	debugfs_create_file("stats", 0644, priv->debugfs, priv,
+	                    &hps_led_patterns_stats_fops);
+
+	// Make the instance available for grouped access.
+	mutex_lock(&hps_led_patterns_list_lock);
+	list_add_tail(&priv->node, &hps_led_patterns_list);
+	mutex_unlock(&hps_led_patterns_list_lock);
+
+	pr_info("hps_led_patterns_probe successful (%s)\n", priv->name);
 
 	return 0;
+
+err_put_attr_nodes:
+	hps_led_patterns_put_attr_nodes(priv);
+	misc_deregister(&priv->miscdev);
+err_free_id:
+	ida_free(&hps_led_patterns_ida, priv->id);
+	return ret;
 }
 
 /*-----------------------------------------------------------------------*/
@@ -459,9 +2326,40 @@ static int hps_led_patterns_remove(struct platform_device *pdev)
 	// Get thehps_led_patterns' private data from the platform device.
 	struct hps_led_patterns_dev *priv = platform_get_drvdata(pdev);
 
-	// Deregister the misc device and remove the /dev/hps_led_patterns file.
+	// Remove the /dev/hps_led_patterns<id> file so nobody new can open it.
 	misc_deregister(&priv->miscdev);
 
+	/*
+	 * Files and mappings that are still open keep priv alive, but every
+	 * file operation that touches the registers fails from here on; wait
+	 * for the ones already running to finish. Then stop the LED pattern
+	 * sequencer and free its sequence; nothing can start it again.
+	 */
+	down_write(&priv->unbind_lock);
+	mutex_lock(&priv->seq_mutex);
+	priv->removed = true;
+	hps_led_patterns_seq_stop(priv);
+	kvfree(priv->seq_steps);
+	priv->seq_steps = NULL;
+	mutex_unlock(&priv->seq_mutex);
+	up_write(&priv->unbind_lock);
+
+	// Wait for grouped accesses to this instance to finish.
+	mutex_lock(&hps_led_patterns_list_lock);
+	list_del(&priv->node);
+	mutex_unlock(&hps_led_patterns_list_lock);
+
+	debugfs_remove_recursive(priv->debugfs);
+
+	// Stop watching for register changes before we drop the sysfs nodes.
+	hrtimer_cancel(&priv->change_timer);
+	if (priv->irq > 0) {
+		devm_free_irq(&pdev->dev, priv->irq, priv);
+	}
+	hps_led_patterns_put_attr_nodes(priv);
+
+	ida_free(&hps_led_patterns_ida, priv->id);
+
 	pr_info("hps_led_patterns_remove successful\n");
 
 	return 0;
@@ -510,11 +2408,45 @@ static struct platform_driver hps_led_patterns_driver = {
 	},
 };
 
+/*-----------------------------------------------------------------------*/
+/* Module Init and Exit                                                  */
+/*-----------------------------------------------------------------------*/
+/*
+ * hps_led_patterns_init() - Register the hps_led_patterns driver
+ *
+ * The instances' debugfs directories live under a common 
+ * hps_led_patterns directory, whose stats file adds up all instances.
+ *
+ * Return: 0 on success, or a negative error value.
+ */
+static int __init hps_led_patterns_init(void)
+{
+	int ret;
+
+	hps_led_patterns_debugfs_root = debugfs_create_dir("hps_led_patterns", NULL);
+	debugfs_create_file("stats", 0644, hps_led_patterns_debugfs_root, NULL,
+	                    &hps_led_patterns_stats_fops);
+
+	ret = platform_driver_register(&hps_led_patterns_driver);
+	if (ret) {
+		debugfs_remove_recursive(hps_led_patterns_debugfs_root);
+	}
+
+	return ret;
+}
+
 /*
- * We don't need to do anything special in module init/exit.
- * This macro automatically handles module init/exit.
+ * hps_led_patterns_exit() - Unregister the hps_led_patterns driver
  */
-module_platform_driver(hps_led_patterns_driver);
+static void __exit hps_led_patterns_exit(void)
+{
+	platform_driver_unregister(&hps_led_patterns_driver);
+	debugfs_remove_recursive(hps_led_patterns_debugfs_root);
+	ida_destroy(&hps_led_patterns_ida);
+}
+
+module_init(hps_led_patterns_init);
+module_exit(hps_led_patterns_exit);
 
 MODULE_LICENSE("Dual MIT/GPL");
 MODULE_AUTHOR("Ross Snider");  // Adapted from Trevor Vannoy's Echo Driver
@@ -0,0 +1,168 @@
+/* SPDX-License-Identifier: GPL-2.0 or MIT                               */
+/* Copyright(c) 2021 Ross K.Snider. All rights reserved.                 */
+/*-------------------------------------------------------------------------
+ * Description:  User-space interface of the hps_led_patterns
+ *               Linux Platform Device Driver (register offsets and
+ *               ioctl definitions). Included by both the driver and
+ *               user-space programs.
+ * ------------------------------------------------------------------------
+ * Authors : Ross K. Snider and Trevor Vannoy
+ * Company : Montana State University
+ * Create Date : November 10, 2021
+ * Revision : 1.0
+ * License : GPL-2.0 or MIT (opensource.org / licenses / MIT, GPL-2.0)
+-------------------------------------------------------------------------*/
+#ifndef HPS_LED_PATTERNS_H
+#define HPS_LED_PATTERNS_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/*-----------------------------------------------------------------------*/
+/* Component Register Offsets                                            */
+/*-----------------------------------------------------------------------*/
+#define REG0_HPS_LED_CONTROL_OFFSET 0x0
+#define REG1_SYS_CLKS_SEC_OFFSET 0x04
+#define REG2_LED_REG_OFFSET 0x08
+#define REG3_BASE_RATE_OFFSET 0x0C
+
+/*-----------------------------------------------------------------------*/
+/* Register Transactions                                                 */
+/*-----------------------------------------------------------------------*/
+/* Operations that can be performed on a register in a transaction       */
+#define HPS_LED_PATTERNS_OP_READ   0  /* Only read the register          */
+#define HPS_LED_PATTERNS_OP_WRITE  1  /* Write value to the register     */
+#define HPS_LED_PATTERNS_OP_SET    2  /* Set the bits given in value     */
+#define HPS_LED_PATTERNS_OP_CLEAR  3  /* Clear the bits given in value   */
+
+/* Maximum number of operations in a single transaction                  */
+#define HPS_LED_PATTERNS_MAX_OPS   32
+
+/*
+ * struct hps_led_patterns_reg_op - One register operation
+ * @offset: Byte offset of the register (32-bit aligned).
+ * @op: One of the HPS_LED_PATTERNS_OP_* operations.
+ * @value: Value (or bit mask) used by the operation.
+ * @result: Filled in by the driver with the register value read back
+ *          after the operation was applied.
+ */
+struct hps_led_patterns_reg_op {
+	__u32 offset;
+	__u32 op;
+	__u32 value;
+	__u32 result;
+};
+
+/*
+ * struct hps_led_patterns_transaction - A batch of register operations
+ * @ops: User-space pointer to an array of struct hps_led_patterns_reg_op.
+ * @count: Number of entries in @ops (at most HPS_LED_PATTERNS_MAX_OPS).
+ * @reserved: Must be zero.
+ *
+ * All operations are applied in order while the device is locked, so
+ * other writers never see (or cause) a half-applied configuration.
+ */
+struct hps_led_patterns_transaction {
+	__u64 ops;
+	__u32 count;
+	__u32 reserved;
+};
+
+/*-----------------------------------------------------------------------*/
+/* LED Pattern Sequencer                                                 */
+/*-----------------------------------------------------------------------*/
+/* Maximum number of steps in a sequence                                 */
+#define HPS_LED_PATTERNS_MAX_STEPS    4096
+/* Shortest step duration (in microseconds) the sequencer accepts        */
+#define HPS_LED_PATTERNS_MIN_STEP_US  10
+
+/* Sequence flags                                                        */
+#define HPS_LED_PATTERNS_SEQ_LOOP     0x1  /* Repeat until stopped       */
+
+/*
+ * struct hps_led_patterns_step - One step of an LED pattern sequence
+ * @led: Value written to LED_reg when the step starts.
+ * @duration_us: How long the step lasts, in microseconds.
+ */
+struct hps_led_patterns_step {
+	__u32 led;
+	__u32 duration_us;
+};
+
+/*
+ * struct hps_led_patterns_sequence - An LED pattern sequence
+ * @steps: User-space pointer to an array of struct hps_led_patterns_step.
+ * @count: Number of entries in @steps (at most HPS_LED_PATTERNS_MAX_STEPS).
+ * @flags: HPS_LED_PATTERNS_SEQ_* flags.
+ *
+ * Loading a sequence stops the one that is running (if any). The driver
+ * replays it from a timer, so no system calls are needed per step.
+ */
+struct hps_led_patterns_sequence {
+	__u64 steps;
+	__u32 count;
+	__u32 flags;
+};
+
+/*
+ * struct hps_led_patterns_seq_status - Sequencer status
+ * @running: Non-zero while the sequence is being played.
+ * @position: Index of the step currently shown.
+ * @count: Number of steps in the loaded sequence.
+ * @loops: Number of times a looping sequence wrapped around.
+ */
+struct hps_led_patterns_seq_status {
+	__u32 running;
+	__u32 position;
+	__u32 count;
+	__u32 loops;
+};
+
+/*-----------------------------------------------------------------------*/
+/* Grouped Access                                                        */
+/*-----------------------------------------------------------------------*/
+/* Maximum number of instances in a grouped write                        */
+#define HPS_LED_PATTERNS_MAX_GROUP    64
+
+/*
+ * struct hps_led_patterns_group_write - Update one register on several
+ *                                       hps_led_patterns instances
+ * @ids: User-space pointer to an array of __u32 instance numbers (the N
+ *       in /dev/hps_led_patternsN).
+ * @count: Number of entries in @ids (at most HPS_LED_PATTERNS_MAX_GROUP).
+ * @offset: Byte offset of the register.
+ * @op: HPS_LED_PATTERNS_OP_WRITE, _SET or _CLEAR.
+ * @value: Operand of @op.
+ *
+ * The ioctl can be issued on any instance's file. All instances are
+ * looked up before any is touched; each one is then updated under its
+ * own lock, one after the other, so the instances are not updated at
+ * the same instant.
+ */
+struct hps_led_patterns_group_write {
+	__u64 ids;
+	__u32 count;
+	__u32 offset;
+	__u32 op;
+	__u32 value;
+};
+
+/*-----------------------------------------------------------------------*/
+/* ioctl Commands                                                        */
+/*-----------------------------------------------------------------------*/
+#define HPS_LED_PATTERNS_IOC_MAGIC 'h'
+
+#define HPS_LED_PATTERNS_IOC_TRANSACTION \
+	_IOW(HPS_LED_PATTERNS_IOC_MAGIC, 0x01, struct hps_led_patterns_transaction)
+#define HPS_LED_PATTERNS_IOC_SEQ_LOAD \
+	_IOW(HPS_LED_PATTERNS_IOC_MAGIC, 0x02, struct hps_led_patterns_sequence)
+#define HPS_LED_PATTERNS_IOC_SEQ_START \
+	_IO(HPS_LED_PATTERNS_IOC_MAGIC, 0x03)
+#define HPS_LED_PATTERNS_IOC_SEQ_STOP \
+	_IO(HPS_LED_PATTERNS_IOC_MAGIC, 0x04)
+#define HPS_LED_PATTERNS_IOC_SEQ_STATUS \
+	_IOR(HPS_LED_PATTERNS_IOC_MAGIC, 0x05, struct hps_led_patterns_seq_status)
+#define HPS_LED_PATTERNS_IOC_GROUP_WRITE \
+	_IOW(HPS_LED_PATTERNS_IOC_MAGIC, 0x06, struct hps_led_patterns_group_write)
+
+#endif
@@ -3,18 +3,24 @@
 #include <stdint.h>
 #include <errno.h>
 #include <string.h>
-
-#define REG0_HPS_LED_CONTROL_OFFSET 0x0
-/* #define REG1 (Add offset for SYS_CLKs_sec) */
-#define REG2_LED_REG_OFFSET 0x08
-/* #define REG3 (Add offset for Base_rate) */
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include "hps_led_patterns.h"
 
 int main () {
 	FILE *file;
+	FILE *file2;
+	uint32_t snapshot[4];
 	size_t ret;	
 	uint32_t val;
-
-	file = fopen ("/dev/hps_led_patterns" , "rb+" );
+	volatile uint32_t *regs;
+	struct hps_led_patterns_reg_op ops[4];
+	struct hps_led_patterns_transaction tr;
+	struct hps_led_patterns_group_write gw;
+	uint32_t ids[1];
+	int i;
+
+	file = fopen ("/dev/hps_led_patterns0" , "rb+" );
 	if (file == NULL) {
 		printf("failed to open file\n");
 		exit(1);
@@ -46,7 +52,7 @@ int main () {
 
     // Example
 	val = 0x55;
-    ret = fseek(file, REG3_LED_REG_OFFSET, SEEK_SET);
+    ret = fseek(file, REG2_LED_REG_OFFSET, SEEK_SET);
 	ret = fwrite(&val, 4, 1, file);
    // todo: printf() with message writing val to register LED_reg
 
@@ -63,6 +69,74 @@ int main () {
 
     
 
+	// The registers can also be mapped into our address space; every
+	// load/store through regs is then a direct register access. The driver
+	// only allows this when the component starts on a page boundary and its
+	// device tree "reg" entry spans a whole page (0x1000). With a smaller
+	// span, like the 0x10 of the example device tree, mmap() fails with
+	// ENODEV and this part is skipped.
+	printf("\n***************\n* register values through mmap\n***************\n\n");
+
+	regs = mmap(NULL, 4096, PROT_READ | PROT_WRITE, MAP_SHARED, fileno(file), 0);
+	if (regs == MAP_FAILED) {
+		printf("mmap not available (%s), skipping\n", strerror(errno));
+	} else {
+		printf("HPS_LED_control = 0x%x\n", regs[REG0_HPS_LED_CONTROL_OFFSET / 4]);
+		printf("LED_reg = 0x%x\n", regs[REG2_LED_REG_OFFSET / 4]);
+		munmap((void *)regs, 4096);
+	}
+
+	// All registers can be updated together with a single transaction.
+	printf("\n***************\n* register transaction\n***************\n\n");
+
+	ops[0] = (struct hps_led_patterns_reg_op){ REG0_HPS_LED_CONTROL_OFFSET, HPS_LED_PATTERNS_OP_WRITE, 0x1, 0 };
+	ops[1] = (struct hps_led_patterns_reg_op){ REG1_SYS_CLKS_SEC_OFFSET, HPS_LED_PATTERNS_OP_READ, 0, 0 };
+	ops[2] = (struct hps_led_patterns_reg_op){ REG2_LED_REG_OFFSET, HPS_LED_PATTERNS_OP_WRITE, 0xAA, 0 };
+	ops[3] = (struct hps_led_patterns_reg_op){ REG3_BASE_RATE_OFFSET, HPS_LED_PATTERNS_OP_READ, 0, 0 };
+	tr.ops = (uintptr_t)ops;
+	tr.count = 4;
+	tr.reserved = 0;
+
+	if (ioctl(fileno(file), HPS_LED_PATTERNS_IOC_TRANSACTION, &tr) < 0) {
+		printf("transaction failed: %s\n", strerror(errno));
+	} else {
+		for (i = 0; i < 4; i++) {
+			printf("register 0x%x = 0x%x\n", ops[i].offset, ops[i].result);
+		}
+	}
+
+	// The raw register file is also a sysfs binary attribute; one pread()
+	// takes a snapshot of all registers without any string conversions.
+	printf("\n***************\n* register snapshot through sysfs\n***************\n\n");
+
+	file2 = fopen("/sys/class/misc/hps_led_patterns0/registers", "rb");
+	if (file2 == NULL) {
+		printf("failed to open registers attribute\n");
+	} else {
+		ret = fread(snapshot, sizeof(snapshot), 1, file2);
+		for (i = 0; i < 4; i++) {
+			printf("register 0x%x = 0x%x\n", i * 4, snapshot[i]);
+		}
+		fclose(file2);
+	}
+
+	// One register can be updated on several instances with one call;
+	// list every hps_led_patternsN in the design in ids[].
+	printf("\n***************\n* grouped write\n***************\n\n");
+
+	ids[0] = 0;
+	gw.ids = (uintptr_t)ids;
+	gw.count = 1;
+	gw.offset = REG2_LED_REG_OFFSET;
+	gw.op = HPS_LED_PATTERNS_OP_WRITE;
+	gw.value = 0x0F;
+
+	if (ioctl(fileno(file), HPS_LED_PATTERNS_IOC_GROUP_WRITE, &gw) < 0) {
+		printf("grouped write failed: %s\n", strerror(errno));
+	} else {
+		printf("LED_reg = 0x%x on %u instance(s)\n", gw.value, gw.count);
+	}
+
 	fclose(file);
 	return 0;
 }
@@ -0,0 +1,109 @@
+/* SPDX-License-Identifier: GPL-2.0 or MIT                               */
+/*-------------------------------------------------------------------------
+ * Description:  Tracepoints for the hps_led_patterns driver
+ * ------------------------------------------------------------------------
+ * The events show up under events/hps_led_patterns/ in tracefs, so that
+ * perf and trace-cmd can attribute time to the bridge, the shadow copy
+ * and the device lock, e.g.
+ *
+ *   trace-cmd record -e hps_led_patterns
+ *   perf record -e 'hps_led_patterns:*' -a
+ *
+ * Every event carries the physical base address of the component so
+ * several hps_led_patterns components can be told apart. Durations are
+ * in nanoseconds.
+-------------------------------------------------------------------------*/
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM hps_led_patterns
+
+#if !defined(_HPS_LED_PATTERNS_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _HPS_LED_PATTERNS_TRACE_H
+
+#include <linux/tracepoint.h>
+
+/* A single ioread32()/iowrite32() across the bridge                     */
+DECLARE_EVENT_CLASS(hps_led_patterns_mmio,
+
+	TP_PROTO(u64 base, u32 offset, u32 val, u64 ns),
+
+	TP_ARGS(base, offset, val, ns),
+
+	TP_STRUCT__entry(
+		__field(u64, base)
+		__field(u32, offset)
+		__field(u32, val)
+		__field(u64, ns)
+	),
+
+	TP_fast_assign(
+		__entry->base = base;
+		__entry->offset = offset;
+		__entry->val = val;
+		__entry->ns = ns;
+	),
+
+	TP_printk("base=0x%llx offset=0x%02x val=0x%08x ns=%llu",
+	          __entry->base, __entry->offset, __entry->val, __entry->ns)
+);
+
+DEFINE_EVENT(hps_led_patterns_mmio, hps_led_patterns_mmio_read,
+	TP_PROTO(u64 base, u32 offset, u32 val, u64 ns),
+	TP_ARGS(base, offset, val, ns)
+);
+
+DEFINE_EVENT(hps_led_patterns_mmio, hps_led_patterns_mmio_write,
+	TP_PROTO(u64 base, u32 offset, u32 val, u64 ns),
+	TP_ARGS(base, offset, val, ns)
+);
+
+/* A register read served from the shadow copy                           */
+TRACE_EVENT(hps_led_patterns_shadow_read,
+
+	TP_PROTO(u64 base, u32 offset, u32 val),
+
+	TP_ARGS(base, offset, val),
+
+	TP_STRUCT__entry(
+		__field(u64, base)
+		__field(u32, offset)
+		__field(u32, val)
+	),
+
+	TP_fast_assign(
+		__entry->base = base;
+		__entry->offset = offset;
+		__entry->val = val;
+	),
+
+	TP_printk("base=0x%llx offset=0x%02x val=0x%08x",
+	          __entry->base, __entry->offset, __entry->val)
+);
+
+/* Time spent waiting for the device lock                                */
+TRACE_EVENT(hps_led_patterns_lock_wait,
+
+	TP_PROTO(u64 base, u64 ns),
+
+	TP_ARGS(base, ns),
+
+	TP_STRUCT__entry(
+		__field(u64, base)
+		__field(u64, ns)
+	),
+
+	TP_fast_assign(
+		__entry->base = base;
+		__entry->ns = ns;
+	),
+
+	TP_printk("base=0x%llx ns=%llu", __entry->base, __entry->ns)
+);
+
+#endif /* _HPS_LED_PATTERNS_TRACE_H */
+
+/* The header lives next to the driver rather than in include/trace/     */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE hps_led_patterns_trace
+#include <trace/define_trace.h>
@@ -0,0 +1,73 @@
+-- SPDX-License-Identifier: MIT
+-- Copyright (c) 2026 Ross K. Snider.  All rights reserved.
+---------------------------------------------------------------------------
+-- This file is used in the book: Advanced Digital System Design using
+-- System-on-Chip Field Programmable Gate Arrays
+-- An Integrated Hardware/Software Approach
+-- by Ross K. Snider
+---------------------------------------------------------------------------
+-- Authors:          Ross K. Snider, Trevor Vannoy
+-- Company:          Montana State University
+-- Create Date:      October 17, 2026
+-- Revision:         1.0
+-- License: MIT      (opensource.org/licenses/MIT)
+-- Target Device(s): Terasic D1E0-Nano Board
+-- Tool versions:    Quartus Prime 20.1
+---------------------------------------------------------------------------
+--
+-- Design Name:      ast2channels.vhd
+--
+-- Description:      Converts the Avalon Streaming (Avalon-ST) interface
+--                   to num_channels individual audio channels, e.g. the
+--                   slots of an ad1939 TDM frame.
+--                   Channel n is held in
+--                     data_channels((n+1)*data_width-1 downto n*data_width)
+--                   Samples with a channel number of num_channels or more
+--                   are ignored.  ast2lr does the same for a stereo
+--                   stream and doesn't depend on this file.
+--
+---------------------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+entity ast2channels is
+  generic (
+    num_channels  : positive := 2;  -- number of audio channels
+    channel_width : positive := 1;  -- width of the Avalon-ST channel field
+    data_width    : positive := 24  -- width of a sample
+  );
+  port (
+    clk                 : in    std_logic;
+    avalon_sink_data    : in    std_logic_vector(data_width - 1 downto 0);
+    avalon_sink_channel : in    std_logic_vector(channel_width - 1 downto 0);
+    avalon_sink_valid   : in    std_logic;
+    data_channels       : out   std_logic_vector(num_channels * data_width - 1 downto 0)
+  );
+end entity ast2channels;
+
+architecture behavioral of ast2channels is
+
+begin
+
+  avalon_streaming_to_samples : process (clk) is
+  begin
+
+    if rising_edge(clk) then
+      if avalon_sink_valid = '1' then
+
+        for n in 0 to num_channels - 1 loop
+
+          if avalon_sink_channel = std_logic_vector(to_unsigned(n, channel_width)) then
+            data_channels((n + 1) * data_width - 1 downto n * data_width) <= avalon_sink_data;
+          end if;
+
+        end loop;
+
+      end if;
+    end if;
+
+  end process avalon_streaming_to_samples;
+
+end architecture behavioral;
@@ -0,0 +1,234 @@
+-- SPDX-License-Identifier: MIT
+-- Copyright (c) 2026 Ross K. Snider.  All rights reserved.
+---------------------------------------------------------------------------
+-- This file is used in the book: Advanced Digital System Design using
+-- System-on-Chip Field Programmable Gate Arrays
+-- An Integrated Hardware/Software Approach
+-- by Ross K. Snider
+---------------------------------------------------------------------------
+-- Authors:          Ross K. Snider, Trevor Vannoy
+-- Company:          Montana State University
+-- Create Date:      October 17, 2026
+-- Revision:         1.0
+-- License: MIT      (opensource.org/licenses/MIT)
+---------------------------------------------------------------------------
+--
+-- Design Name:      ast2channels_tb.vhd
+--
+-- Description:      Self-checking test bench for ast2channels and
+--                   channels2ast with 8 channels (an ad1939 DAC TDM frame)
+--                   at full throughput: a new sample is valid on every
+--                   clock cycle, channels 0..7 in order, frame after frame.
+--                   Checks that
+--                     1. every sample lands in its own channel slot and
+--                        leaves the other slots alone,
+--                     2. channels2ast puts out one sample per input sample,
+--                        one clock later, in the same channel order, with
+--                        the data of that channel's slot,
+--                     3. samples for channels that don't exist are ignored.
+--
+--                   Run with GHDL:
+--                     ghdl -a ast2channels.vhd channels2ast.vhd ast2channels_tb.vhd
+--                     ghdl -e ast2channels_tb
+--                     ghdl -r ast2channels_tb
+--                   The simulation stops on its own; a failed check ends it
+--                   with an error.
+--
+---------------------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+entity ast2channels_tb is
+  -- nothing here to see, i.e. no signal i/o
+end entity ast2channels_tb;
+
+architecture behavioral of ast2channels_tb is
+
+  constant num_channels    : positive := 8;
+  constant channel_width   : positive := 4;   -- wider than needed, to test unused channels
+  constant data_width      : positive := 24;
+  constant num_frames      : positive := 16;
+  constant clk_half_period : time     := 10 ns;
+
+  signal clk      : std_logic := '0';
+  signal sim_done : boolean   := false;
+
+  signal sink_data      : std_logic_vector(data_width - 1 downto 0)    := (others => '0');
+  signal sink_channel   : std_logic_vector(channel_width - 1 downto 0) := (others => '0');
+  signal sink_valid     : std_logic := '0';
+  signal data_channels  : std_logic_vector(num_channels * data_width - 1 downto 0);
+  signal source_data    : std_logic_vector(data_width - 1 downto 0);
+  signal source_channel : std_logic_vector(channel_width - 1 downto 0);
+  signal source_valid   : std_logic;
+
+  component ast2channels is
+    generic (
+      num_channels  : positive;
+      channel_width : positive;
+      data_width    : positive
+    );
+    port (
+      clk                 : in    std_logic;
+      avalon_sink_data    : in    std_logic_vector(data_width - 1 downto 0);
+      avalon_sink_channel : in    std_logic_vector(channel_width - 1 downto 0);
+      avalon_sink_valid   : in    std_logic;
+      data_channels       : out   std_logic_vector(num_channels * data_width - 1 downto 0)
+    );
+  end component ast2channels;
+
+  component channels2ast is
+    generic (
+      num_channels  : positive;
+      channel_width : positive;
+      data_width    : positive
+    );
+    port (
+      clk                   : in    std_logic;
+      avalon_sink_channel   : in    std_logic_vector(channel_width - 1 downto 0);
+      avalon_sink_valid     : in    std_logic;
+      data_channels         : in    std_logic_vector(num_channels * data_width - 1 downto 0);
+      avalon_source_data    : out   std_logic_vector(data_width - 1 downto 0);
+      avalon_source_channel : out   std_logic_vector(channel_width - 1 downto 0);
+      avalon_source_valid   : out   std_logic
+    );
+  end component channels2ast;
+
+  -- A different sample for every frame and channel
+  function sample (frame : natural; channel : natural) return std_logic_vector is
+  begin
+    return std_logic_vector(to_unsigned(frame * 4096 + channel * 257 + 1, data_width));
+  end function sample;
+
+  -- The slot of one channel in data_channels
+  function slot (data : std_logic_vector; channel : natural) return std_logic_vector is
+  begin
+    return data((channel + 1) * data_width - 1 downto channel * data_width);
+  end function slot;
+
+begin
+
+  dut_ast2channels : component ast2channels
+    generic map (
+      num_channels  => num_channels,
+      channel_width => channel_width,
+      data_width    => data_width
+    )
+    port map (
+      clk                 => clk,
+      avalon_sink_data    => sink_data,
+      avalon_sink_channel => sink_channel,
+      avalon_sink_valid   => sink_valid,
+      data_channels       => data_channels
+    );
+
+  dut_channels2ast : component channels2ast
+    generic map (
+      num_channels  => num_channels,
+      channel_width => channel_width,
+      data_width    => data_width
+    )
+    port map (
+      clk                   => clk,
+      avalon_sink_channel   => sink_channel,
+      avalon_sink_valid     => sink_valid,
+      data_channels         => data_channels,
+      avalon_source_data    => source_data,
+      avalon_source_channel => source_channel,
+      avalon_source_valid   => source_valid
+    );
+
+  -- The clock stops when the test is done, which ends the simulation
+  clk <= not clk after clk_half_period when not sim_done else '0';
+
+  ---------------------------------------------------------------------------
+  -- Drive the inputs on the falling edge and check the outputs of the
+  -- rising edge in between on the next falling edge
+  ---------------------------------------------------------------------------
+  stimulus_and_check : process is
+    variable errors : natural := 0;
+  begin
+
+    wait until falling_edge(clk);
+
+    for frame in 0 to num_frames - 1 loop
+      for channel in 0 to num_channels - 1 loop
+
+        sink_data    <= sample(frame, channel);
+        sink_channel <= std_logic_vector(to_unsigned(channel, channel_width));
+        sink_valid   <= '1';
+        wait until falling_edge(clk);
+
+        -- 1. The sample is in its slot, and the other slots hold the
+        --    latest sample of their channel
+        for k in 0 to num_channels - 1 loop
+          if k <= channel then
+            if slot(data_channels, k) /= sample(frame, k) then
+              report "frame " & integer'image(frame) & " channel " & integer'image(channel) &
+                     ": slot " & integer'image(k) & " holds the wrong sample" severity error;
+              errors := errors + 1;
+            end if;
+          elsif frame > 0 then
+            if slot(data_channels, k) /= sample(frame - 1, k) then
+              report "frame " & integer'image(frame) & " channel " & integer'image(channel) &
+                     ": slot " & integer'image(k) & " changed" severity error;
+              errors := errors + 1;
+            end if;
+          end if;
+        end loop;
+
+        -- 2. One output sample per input sample, same channel, in order. It
+        --    carries the slot as it was before this clock edge, i.e. the
+        --    previous frame of the channel.
+        if source_valid /= '1' or to_integer(unsigned(source_channel)) /= channel then
+          report "frame " & integer'image(frame) & " channel " & integer'image(channel) &
+                 ": output sample missing or out of order" severity error;
+          errors := errors + 1;
+        elsif frame > 0 and source_data /= sample(frame - 1, channel) then
+          report "frame " & integer'image(frame) & " channel " & integer'image(channel) &
+                 ": output sample has the wrong data" severity error;
+          errors := errors + 1;
+        end if;
+
+      end loop;
+    end loop;
+
+    -- 3. A sample for a channel that doesn't exist changes nothing
+    sink_data    <= (others => '1');
+    sink_channel <= std_logic_vector(to_unsigned(num_channels + 4, channel_width));
+    sink_valid   <= '1';
+    wait until falling_edge(clk);
+
+    if source_valid /= '0' then
+      report "sample for a missing channel was passed on" severity error;
+      errors := errors + 1;
+    end if;
+    for k in 0 to num_channels - 1 loop
+      if slot(data_channels, k) /= sample(num_frames - 1, k) then
+        report "sample for a missing channel changed slot " & integer'image(k) severity error;
+        errors := errors + 1;
+      end if;
+    end loop;
+
+    -- Nothing comes out without valid samples
+    sink_valid <= '0';
+    wait until falling_edge(clk);
+    wait until falling_edge(clk);
+
+    if source_valid /= '0' then
+      report "output valid without an input sample" severity error;
+      errors := errors + 1;
+    end if;
+
+    assert errors = 0
+      report integer'image(errors) & " errors" severity failure;
+    report "ast2channels_tb passed: " & integer'image(num_frames * num_channels) &
+           " samples in " & integer'image(num_channels) & " channels";
+
+    sim_done <= true;
+    wait;
+
+  end process stimulus_and_check;
+
+end architecture behavioral;
@@ -0,0 +1,81 @@
+-- SPDX-License-Identifier: MIT
+-- Copyright (c) 2026 Ross K. Snider.  All rights reserved.
+---------------------------------------------------------------------------
+-- This file is used in the book: Advanced Digital System Design using
+-- System-on-Chip Field Programmable Gate Arrays
+-- An Integrated Hardware/Software Approach
+-- by Ross K. Snider
+---------------------------------------------------------------------------
+-- Authors:          Ross K. Snider, Trevor Vannoy
+-- Company:          Montana State University
+-- Create Date:      October 17, 2026
+-- Revision:         1.0
+-- License: MIT      (opensource.org/licenses/MIT)
+-- Target Device(s): Terasic D1E0-Nano Board
+-- Tool versions:    Quartus Prime 20.1
+---------------------------------------------------------------------------
+--
+-- Design Name:      channels2ast.vhd
+--
+-- Description:      Converts num_channels individual audio channels
+--                   back to the Avalon Streaming (Avalon-ST) interface.
+--                   Channel n is taken from
+--                     data_channels((n+1)*data_width-1 downto n*data_width)
+--                   lr2ast does the same for a stereo stream and
+--                   doesn't depend on this file.
+--
+---------------------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+-- Note: We have access to the avalon sink signals,
+--       so just use them to generate the avalon source signals.
+--       Every valid sink sample produces one source sample one clock
+--       later, on the same channel, so the channel order and the
+--       throughput of the sink are kept.
+entity channels2ast is
+  generic (
+    num_channels  : positive := 2;  -- number of audio channels
+    channel_width : positive := 1;  -- width of the Avalon-ST channel field
+    data_width    : positive := 24  -- width of a sample
+  );
+  port (
+    clk                   : in    std_logic;
+    avalon_sink_channel   : in    std_logic_vector(channel_width - 1 downto 0);
+    avalon_sink_valid     : in    std_logic;
+    data_channels         : in    std_logic_vector(num_channels * data_width - 1 downto 0);
+    avalon_source_data    : out   std_logic_vector(data_width - 1 downto 0);
+    avalon_source_channel : out   std_logic_vector(channel_width - 1 downto 0);
+    avalon_source_valid   : out   std_logic
+  );
+end entity channels2ast;
+
+architecture behavioral of channels2ast is
+
+begin
+
+  samples_to_avalon_streaming : process (clk) is
+  begin
+
+    if rising_edge(clk) then
+      avalon_source_valid <= '0';
+      if avalon_sink_valid = '1' then
+
+        for n in 0 to num_channels - 1 loop
+
+          if avalon_sink_channel = std_logic_vector(to_unsigned(n, channel_width)) then
+            avalon_source_data    <= data_channels((n + 1) * data_width - 1 downto n * data_width);
+            avalon_source_channel <= avalon_sink_channel;
+            avalon_source_valid   <= '1';
+          end if;
+
+        end loop;
+
+      end if;
+    end if;
+
+  end process samples_to_avalon_streaming;
+
+end architecture behavioral;